@@ -12,6 +12,13 @@ endif
 # extra flags for valgrind
 #FLAGS += -O0
 
+# optimization: set OPTIMIZE=1 to let the compiler vectorize loops, such
+# as those in `Kinematics::CalculateHadronKinematicsBatch`
+OPTIMIZE = 0
+ifeq ($(OPTIMIZE),1)
+FLAGS += -O3
+endif
+
 # ROOT
 DEPS = -I$(shell root-config --incdir)
 LIBS = $(shell root-config --glibs)
@@ -33,6 +40,13 @@ DEPS+= -I${DELPHES_HOME}/external/fastjet/plugins/Centauro
 endif
 FLAGS += -DINCCENTAURO=$(INCCENTAURO)
 
+# RNTuple output for SimpleTree: set INCRNTUPLE=1 to enable (requires ROOT 6.30 or newer)
+INCRNTUPLE = 0
+ifeq ($(INCRNTUPLE),1)
+LIBS += -lROOTNTuple
+endif
+FLAGS += -DINCRNTUPLE=$(INCRNTUPLE)
+
 # shared object name and source directory
 SIDIS-EIC = Sidis-eic
 SIDIS-EIC-OBJ := lib$(SIDIS-EIC).so
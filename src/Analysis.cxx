@@ -3,6 +3,10 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "TEnv.h"
 
 ClassImp(Analysis)
 
@@ -29,6 +33,8 @@ Analysis::Analysis(
   , crossingAngle(crossingAngle_)
   , outfilePrefix(outfilePrefix_)
   , reconMethod("")
+  , histosDepsRec(0)
+  , histosDepsTrue(0)
 {
   // available variables for binning
   // - availableBinSchemes is a map from variable name to variable title
@@ -79,8 +85,10 @@ Analysis::Analysis(
 
 
   // kinematics reconstruction methods
-  // - choose one of these methods using `SetReconMethod(TString name)`
+  // - choose one of these methods using `SetReconMethod(TString name)`, or more
+  //   than one using `AddReconMethod(TString name)`
   // - if you specify none, a default method will be chosen
+  availableBinSchemes.insert(std::pair<TString,TString>("recon","recon method"));
   reconMethodToTitle.insert(std::pair<TString,TString>("Ele","Electron method"));
   reconMethodToTitle.insert(std::pair<TString,TString>("DA","Double Angle method"));
   reconMethodToTitle.insert(std::pair<TString,TString>("JB","Jacquet-Blondel method"));
@@ -91,8 +99,48 @@ Analysis::Analysis(
   // common settings defaults
   // - these settings can be set at the macro level
   writeSimpleTree = false;
+  simpleTreeColumns = "";
+  simpleTreeFormat = SimpleTree::fTTree;
+  simpleTreeLayout = SimpleTree::lTrack;
+  simpleTreeAsync = false;
   maxEvents = 0;
+  checkpointEvents = 0;
+  checkpointSeconds = 0;
+  resume = false;
   useBreitJets = false;
+  jetRadius = 0.8;
+  jetStrategy = fastjet::Best;
+  jetCacheFile = "";
+  inputMetadataCache = "out/input_metadata.cache";
+  inputThreads = 0;
+  readCacheMB = 50;
+  readPrefetch = false;
+  useZoneMap = false;
+  zoneMapDir = "";
+  entryListFile = "";
+  eventCacheMB = 0;
+  skimFile = "";
+  writeConsolidated = false;
+  memoryBudget = 0;
+  memoryDowngrade = false;
+  maxResidentHistos = 0;
+  scratchDir = "";
+  writeSparse = false;
+  // - fine-grained THnSparse axes (for `writeSparse`); bin edges of the coarse BinSets
+  //   applied to them later should coincide with these fine bin edges
+  SetSparseAxis("x",    100, 1e-4,         1,            true);
+  SetSparseAxis("q2",   100, 1,            1e4,          true);
+  SetSparseAxis("y",    50,  0,            1);
+  SetSparseAxis("z",    50,  0,            1);
+  SetSparseAxis("pt",   60,  0,            3);
+  SetSparseAxis("phiH", 32,  -TMath::Pi(), TMath::Pi());
+  SetSparseAxis("phiS", 32,  -TMath::Pi(), TMath::Pi());
+  SetSparseAxis("eta",  50,  -5,           5);
+  useMoments = false;
+  useAsymMoments = false;
+  calculateAllObservables = false;
+  histosFamilies = hAll;
+  batchHadronKinematics = false;
 
   weight = new WeightsUniform();
   weightJet = new WeightsUniform();
@@ -100,6 +148,26 @@ Analysis::Analysis(
   // miscellaneous
   infiles.clear();
   entriesTot = 0;
+  inputMetadata = nullptr;
+  skimOut = nullptr;
+  zoneMap = nullptr;
+  zoneMapBuild = false;
+  zoneMapSkipped = 0;
+  entryListIn = nullptr;
+  entryListOut = nullptr;
+  eventCacheOut = nullptr;
+  eventCacheHit = false;
+  checkpointCount = 0;
+  checkpointTime = 0;
+  readTreeNum = -1;
+  readCalls = 0;
+  readBytes = 0;
+  readPrefetchPrev = -1;
+  hadronBatchIdx = 0;
+  eventFileID = 0;
+  eventEntry = 0;
+  eventTree = nullptr;
+  eventRecorded = false;
 };
 
 
@@ -112,6 +180,10 @@ bool Analysis::AddFile(std::vector<std::string> fileNames, std::vector<Long64_t>
       cout << fileName << ", ";
   }
   cout << endl;
+  // count entries, if not given
+  if (!CountEntries(fileNames, entries)) {
+    return false;
+  }
   // insert in order of Q2min
   std::size_t insertIdx = 0;
   for (std::size_t idx = 0; idx < infiles.size(); ++idx) {
@@ -156,10 +228,37 @@ bool Analysis::AddFile(std::vector<std::string> fileNames, std::vector<Long64_t>
   return true;
 }
 
+// count entries of files with `entries<=0`; files that are not yet known to `inputMetadata`
+// are fetched together, so they are opened in parallel, unless found in the cache
+Bool_t Analysis::CountEntries(std::vector<std::string> fileNames, std::vector<Long64_t> &entries) {
+  if (inputMetadata == nullptr) {
+    inputMetadata = new InputMetadata(inputMetadataCache);
+  }
+  std::vector<std::string> unknown;
+  for (std::size_t idx = 0; idx < fileNames.size(); ++idx) {
+    if (entries[idx] <= 0 && !inputMetadata->Has(fileNames[idx])) {
+      unknown.push_back(fileNames[idx]);
+    }
+  }
+  if (!unknown.empty() && !inputMetadata->Fetch(unknown, inputThreads)) {
+    return false;
+  }
+  for (std::size_t idx = 0; idx < fileNames.size(); ++idx) {
+    if (entries[idx] <= 0) {
+      entries[idx] = inputMetadata->GetEntries(fileNames[idx]);
+    }
+  }
+  return true;
+}
+
 
-// prepare for the analysis
+// read the config file, and add its input files
 //------------------------------------
-void Analysis::Prepare() {
+Bool_t Analysis::LoadInputs() {
+  // read the config file
+  std::vector<std::vector<string>> cfgFileNames;
+  std::vector<std::vector<Long64_t>> cfgEntries;
+  std::vector<Double_t> cfgXs, cfgQ2min;
   ifstream fin(infileName);
   string line;
   while (std::getline(fin, line)) {
@@ -182,39 +281,51 @@ void Analysis::Prepare() {
         break;
       }
     }
-    for (std::size_t idx = 0; idx < fileNames.size(); ++idx) {
-      if (entries[idx] <= 0) {
-        TFile* file = TFile::Open(fileNames[idx].c_str());
-        if (file->IsZombie()) {
-          cerr << "ERROR: Couldn't open input file '" << fileNames[idx] << "'" << endl;
-          return;
-        }
-        TTree* tree = file->Get<TTree>("Delphes");
-        if (tree == nullptr) tree = file->Get<TTree>("events");
-        if (tree == nullptr) tree = file->Get<TTree>("event_tree");
-        if (tree == nullptr) {
-          cerr << "ERROR: Couldn't find Delphes or events tree in file '" << fileNames[idx] << "'" << endl;
-          return;
-        }
-        entries[idx] = tree->GetEntries();
-      }
-    }
-    if (!AddFile(fileNames, entries, xs, Q2min)) {
+    cfgFileNames.push_back(fileNames);
+    cfgEntries.push_back(entries);
+    cfgXs.push_back(xs);
+    cfgQ2min.push_back(Q2min);
+  }
+  // count entries of all files where not given at once, so they are opened in parallel
+  std::vector<std::string> allFileNames;
+  std::vector<Long64_t> allEntries;
+  for (std::size_t cfgIdx = 0; cfgIdx < cfgFileNames.size(); ++cfgIdx) {
+    allFileNames.insert(allFileNames.end(), cfgFileNames[cfgIdx].begin(), cfgFileNames[cfgIdx].end());
+    allEntries.insert(allEntries.end(), cfgEntries[cfgIdx].begin(), cfgEntries[cfgIdx].end());
+  }
+  if (!CountEntries(allFileNames, allEntries)) {
+    return false;
+  }
+  // add files, in order of Q2min
+  for (std::size_t cfgIdx = 0; cfgIdx < cfgFileNames.size(); ++cfgIdx) {
+    std::vector<string> &fileNames = cfgFileNames[cfgIdx];
+    if (!AddFile(fileNames, cfgEntries[cfgIdx], cfgXs[cfgIdx], cfgQ2min[cfgIdx])) {
       cerr << "ERROR: Couldn't add files ";
       for (std::string fileName : fileNames) {
         cerr << fileName << " ";
       }
       cerr << endl;
-      return;
+      return false;
     }
   }
+  return true;
+}
+
+
+// prepare for the analysis
+//------------------------------------
+Bool_t Analysis::Prepare() {
+  if (!LoadInputs()) {
+    return false;
+  }
   if (infiles.empty()) {
     cerr << "ERROR: no input files have been specified" << endl;
-    return;
+    return false;
   }
 
   // set output file name
   outfileName = "out/"+outfilePrefix+".root";
+  checkpointFileName = "out/"+outfilePrefix+".checkpoint.root";
 
   // open output file
   cout << "-- output file: " << outfileName << endl;
@@ -223,7 +334,15 @@ void Analysis::Prepare() {
   // instantiate shared objects
   kin = new Kinematics(eleBeamEn,ionBeamEn,crossingAngle);
   kinTrue = new Kinematics(eleBeamEn, ionBeamEn, crossingAngle);
-  ST = new SimpleTree("tree",kin,kinTrue);
+  // - if asynchronous, the tree is written to a file of its own, since its writer
+  //   thread cannot share `outFile` (see `SimpleTree::StartAsync`)
+  ST = new SimpleTree("tree",kin,kinTrue,simpleTreeColumns,
+      writeSimpleTree ? simpleTreeFormat : (Int_t)SimpleTree::fTTree,
+      writeSimpleTree ? simpleTreeLayout : (Int_t)SimpleTree::lTrack,
+      writeSimpleTree && simpleTreeAsync ? "out/"+outfilePrefix+".tree.root" : "");
+  if(writeSimpleTree && simpleTreeAsync) ST->StartAsync();
+  kin->jetR = jetRadius;
+  kin->jetStrategy = jetStrategy;
 
 
   // if there are no final states defined, default to definitions here:
@@ -234,148 +353,1358 @@ void Analysis::Prepare() {
 
 
   // if no reconstruction method is set, choose a default here
-  if(reconMethod=="") {
+  if(reconMethods.empty()) {
     std::cout << "NOTE: no recon method specified, default to electron method" << std::endl;
     SetReconMethod("Ele");
   };
+  reconMethod = reconMethods.front();
+  // if there is more than one reconstruction method, bin in reconstruction method
+  // - methods which already have a bin are skipped, since `Prepare` runs for each `Execute`
+  if(reconMethods.size()>1) {
+    AddBinScheme("recon");
+    BinSet *reconBins = BinScheme("recon");
+    for(TString reconMethodN : reconMethods) {
+      Bool_t hasBin = false;
+      for(Int_t b=0; b<reconBins->GetNumBins(); b++) hasBin = hasBin || reconBins->Cut(b)->GetCutID()==reconMethodN;
+      if(!hasBin) reconBins->BuildExternalBin(reconMethodN,reconMethodToTitle.at(reconMethodN));
+    };
+  };
 
 
   // build HistosDAG with specified binning
   HD = new HistosDAG();
   HD->Build(binSchemes);
+  if(maxResidentHistos>0) {
+    if(scratchDir=="") scratchDir = gSystem->TempDirectory();
+    HD->SetWorkingSet(
+        maxResidentHistos,
+        scratchDir+"/"+outfilePrefix+TString::Format(".%d.scratch.root",gSystem->GetPid())
+        );
+  };
+
 
+  // check memory needed for histograms, before booking them
+  if(!CheckMemoryBudget()) return false;
 
   // DEFINE HISTOGRAMS ------------------------------------
-  HD->Payload([this](Histos *HS){
+  // - also collect the observable groups they are filled with (see `PrepareObservables`)
+  histosDepsRec = histosDepsTrue = 0;
+  auto defineHistos = DefineHistos();
+  HD->Payload([this,defineHistos](Histos *HS){
+    defineHistos(HS);
+    histosDepsRec |= HS->GetObservableDeps();
+    histosDepsTrue |= HS->GetObservableDeps(true);
+  });
+  HD->ExecuteAndClearOps();
+
+
+  // book fine-grained THnSparse for each track final state
+  sparseMap.clear();
+  if(writeSparse && sparseAxes.empty()) {
+    cerr << "WARNING: writeSparse is ignored, since there are no THnSparse axes" << endl;
+    writeSparse = false;
+  };
+  if(writeSparse) {
+    for(TString finalStateN : activeFinalStates) {
+      if(finalStateN=="jet") continue;
+      for(TString reconMethodN : reconMethods)
+        sparseMap.insert(std::pair<TString,THnSparseD*>(
+              finalStateN+"__"+reconMethodN, BookSparse(finalStateN,reconMethodN)));
+    };
+  };
+
+
+  // find which observables are needed, so that only those are calculated
+  PrepareObservables();
+
+
+  // skim output
+  if(skimFile!="") {
+    skimOut = new SkimFile(skimFile);
+    if(!skimOut->OpenWrite(eleBeamEn,ionBeamEn,crossingAngle)) return false;
+    TString skimInfo = "recon:";
+    for(TString reconMethodN : reconMethods) skimInfo += " "+reconMethodN;
+    skimInfo += "; finalState:";
+    for(TString finalStateN : activeFinalStates) skimInfo += " "+finalStateN;
+    skimOut->SetInfo(skimInfo);
+    if(activeFinalStates.find("jet")!=activeFinalStates.end())
+      cerr << "WARNING: jets are not written to the skim file" << endl;
+    cout << "writing skim file " << skimFile << " (" << skimInfo << ")" << endl;
+  };
+
+
+  // event selection list
+  if(entryListFile!="") PrepareEntryList();
+
+
+  // zone maps
+  if(useZoneMap) PrepareZoneMap();
+
+
+  // event cache
+  if(eventCacheMB>0) PrepareEventCache();
+
+
+  // checkpoints
+  if(skimFile!="" && (checkpointEvents>0 || checkpointSeconds>0 || resume)) {
+    cerr << "WARNING: checkpoints are not used with skimFile, since the skim cannot be resumed" << endl;
+    checkpointEvents = 0;
+    checkpointSeconds = 0;
+    resume = false;
+  };
+
+
+  // initialize total weights
+  for(TString reconMethodN : reconMethods) {
+    wTrackTotal[reconMethodN] = 0.;
+    wJetTotal[reconMethodN] = 0.;
+  };
+  return true;
+};
+
+Int_t Analysis::ReconMethodIdx() {
+  auto it = std::find(reconMethods.begin(), reconMethods.end(), reconMethod);
+  return it - reconMethods.begin();
+};
+
+// total weights, of each recon method, for the checkpoints and event selection lists
+std::vector<Double_t> Analysis::GetWeightTotals() {
+  std::vector<Double_t> totals;
+  for(TString reconMethodN : reconMethods) totals.push_back(wTrackTotal[reconMethodN]);
+  for(TString reconMethodN : reconMethods) totals.push_back(wJetTotal[reconMethodN]);
+  return totals;
+};
+Bool_t Analysis::SetWeightTotals(std::vector<Double_t> const *totals) {
+  if(totals==nullptr || totals->size()!=2*reconMethods.size()) return false;
+  for(std::size_t r=0; r<reconMethods.size(); r++) {
+    wTrackTotal[reconMethods[r]] = totals->at(r);
+    wJetTotal[reconMethods[r]] = totals->at(reconMethods.size()+r);
+  };
+  return true;
+};
+
+
+// fine-grained THnSparse
+//------------------------------------
+// set the binning of an axis; the axes must be in the track `valueMap` (see `FillHistosTracks`)
+void Analysis::SetSparseAxis(TString varName, Int_t nBins, Double_t lower, Double_t upper, Bool_t logScale) {
+  if(availableBinSchemes.find(varName)==availableBinSchemes.end()
+      || varName=="finalState" || varName=="recon" || varName=="ptJet" || varName=="zJet") {
+    cerr << "ERROR: " << varName << " cannot be a THnSparse axis" << endl;
+    return;
+  };
+  auto it = std::find_if(sparseAxes.begin(), sparseAxes.end(),
+      [&varName](const SparseAxis &axis){ return axis.varName==varName; });
+  if(nBins<=0) {
+    if(it!=sparseAxes.end()) sparseAxes.erase(it);
+    return;
+  };
+  SparseAxis axis = { varName, nBins, lower, upper, logScale };
+  if(it!=sparseAxes.end()) *it = axis;
+  else sparseAxes.push_back(axis);
+};
+
+// book the THnSparse for a final state; axis names match the bin scheme names (see
+// `availableBinSchemes`), so that BinSets may be applied to them in `PostProcessor`
+// - the fine binning limits how coarser bins may be chosen later: bin edges of the coarse
+//   BinSets should coincide with these fine bin edges
+THnSparseD *Analysis::BookSparse(TString finalStateN, TString reconMethodN) {
+  const Int_t nDim = (Int_t)sparseAxes.size();
+  std::vector<Int_t> nBins;
+  std::vector<Double_t> lower, upper;
+  for(const SparseAxis &axis : sparseAxes) {
+    nBins.push_back(axis.nBins);
+    lower.push_back(axis.lower);
+    upper.push_back(axis.upper);
+  };
+  THnSparseD *sparse = new THnSparseD(
+      "sparse__"+finalStateN+"__"+reconMethodN,
+      finalStateToTitle.at(finalStateN)+", "+reconMethodToTitle.at(reconMethodN),
+      nDim, nBins.data(), lower.data(), upper.data()
+      );
+  for(Int_t d=0; d<nDim; d++) {
+    TAxis *ax = sparse->GetAxis(d);
+    ax->SetName(sparseAxes[d].varName);
+    ax->SetTitle(availableBinSchemes.at(sparseAxes[d].varName));
+    if(sparseAxes[d].logScale) BinSet::BinLog(ax);
+  };
+  sparse->Sumw2();
+  return sparse;
+};
+
+// fill the THnSparse for the current final state; the order matches `BookSparse`
+void Analysis::FillSparse() {
+  auto it = sparseMap.find(finalStateID+"__"+reconMethod);
+  if(it==sparseMap.end()) return;
+  sparseValues.resize(sparseAxes.size());
+  for(std::size_t d=0; d<sparseAxes.size(); d++) sparseValues[d] = valueMap.at(sparseAxes[d].varName);
+  it->second->Fill(sparseValues.data(),wTrack);
+};
+
+// LOWER BOUND of the THnSparse memory: each filled cell has its content, sum of weights
+// squared, compact coordinates, and hash table entry; the number of filled cells is at
+// most the number of cells and the number of fills, but there is one fill per selected
+// track (per recon method), and the number of selected tracks per event is not known
+// before reading, so this assumes at least one per event; it is therefore only printed,
+// and not included in the `memoryBudget` check
+Long64_t Analysis::EstimateSparseMemory() {
+  if(!writeSparse) return 0;
+  Long64_t nSparse = 0;
+  for(TString finalStateN : activeFinalStates) {
+    if(finalStateN!="jet") nSparse += reconMethods.size();
+  };
+  Double_t nCells = 1;
+  Int_t coordBits = 0;
+  for(const SparseAxis &axis : sparseAxes) {
+    nCells *= axis.nBins+2; // (including underflow and overflow)
+    coordBits += (Int_t)TMath::Ceil(TMath::Log2(axis.nBins+2));
+  };
+  Long64_t nEvents = 0;
+  for(Long64_t entries : Q2entries) nEvents += entries;
+  if(maxEvents>0) nEvents = TMath::Min(nEvents,maxEvents);
+  Double_t nFilled = TMath::Min(nCells,(Double_t)nEvents);
+  Long64_t cellBytes = 2*sizeof(Double_t) + (coordBits+7)/8 + 3*sizeof(Long64_t);
+  return (Long64_t)(nSparse*nFilled*cellBytes);
+};
+
+
+// batch hadron kinematics
+//------------------------------------
+void Analysis::ClearHadronBatch() {
+  hadronBatch.clear();
+  hadronBatchTrue.clear();
+};
+
+void Analysis::AddToHadronBatch() {
+  hadronBatch.push_back(kin->vecHadron, kin->hadPID);
+  hadronBatchTrue.push_back(kinTrue->vecHadron, kinTrue->hadPID);
+};
+
+void Analysis::CalculateHadronBatch() {
+  kin->CalculateHadronKinematicsBatch(hadronBatch, hadronObs);
+  kinTrue->CalculateHadronKinematicsBatch(hadronBatchTrue, hadronObsTrue);
+  hadronBatchIdx = 0;
+};
+
+void Analysis::CalculateHadronKinematics() {
+  if(batchHadronKinematics) {
+    if(hadronBatchIdx >= hadronObs.size()) {
+      cerr << "ERROR: more hadrons than in the batch; call `AddToHadronBatch` for each hadron" << endl;
+      return;
+    };
+    kin->SetHadronKinematics(hadronObs, hadronBatchIdx);
+    kinTrue->SetHadronKinematics(hadronObsTrue, hadronBatchIdx);
+    hadronBatchIdx++;
+  }
+  else {
+    kin->CalculateHadronKinematics();
+    kinTrue->CalculateHadronKinematics();
+  };
+};
+
+
+// random draws
+//------------------------------------
+// the file ID is not the index in the chain, so that sharded runs over subsets of the
+// files give the same draws
+void Analysis::SetRandomKey(TChain *chain) {
+  // - the file ID is a hash of the file UUID, which is unique to the file, unlike its
+  //   name, and does not change if it is moved or copied (e.g., for sharded runs)
+  UInt_t fileID = TString(chain->GetFile()->GetUUID().AsString()).Hash();
+  Long64_t entry = chain->GetTree()->GetReadEntry();
+  kin->SetRandomKey(fileID,entry);
+  kinTrue->SetRandomKey(fileID,entry);
+  eventFileID = fileID;
+  eventEntry = entry;
+  eventTree = chain->GetTree();
+  eventRecorded = false;
+};
+
+
+// checkpoints
+//------------------------------------
+// load the checkpoint, if resuming: the Histos contents and THnSparses replace the booked
+// ones, so that the following fills give the same result as without the interruption
+Long64_t Analysis::ResumeCheckpoint(std::vector<Long64_t*> counters) {
+  checkpointCounters = counters;
+  checkpointCount = 0;
+  checkpointTime = (Long64_t)gSystem->Now();
+  if(!resume) return 0;
+  if(gSystem->AccessPathName(checkpointFileName)) {
+    cout << "checkpoint: " << checkpointFileName << " not found; starting from the beginning" << endl;
+    return 0;
+  };
+  // - the SimpleTree is not in the checkpoint, so it would miss the events before it
+  if(writeSimpleTree) {
+    cerr << "ERROR: cannot resume from " << checkpointFileName << " with writeSimpleTree, since the"
+         << " SimpleTree is not checkpointed; remove the checkpoint, or set resume=false" << endl;
+    return -1;
+  };
+  TDirectory::TContext context;
+  TFile *cpFile = TFile::Open(checkpointFileName);
+  if(cpFile==nullptr || cpFile->IsZombie()) {
+    cerr << "ERROR: cannot open checkpoint " << checkpointFileName << endl;
+    if(cpFile) delete cpFile;
+    return -1;
+  };
+  auto key = cpFile->Get<TNamed>("checkpointKey");
+  auto where = cpFile->Get<TNamed>("position");
+  auto position = cpFile->Get<std::vector<Long64_t>>("counters");
+  auto totals = cpFile->Get<std::vector<Double_t>>("weightTotals");
+  TDirectory *histosDir = cpFile->GetDirectory("histos");
+  TDirectory *sparseDir = cpFile->GetDirectory("sparse");
+  Long64_t entry = -1;
+  if(key==nullptr || CheckpointKey()!=key->GetTitle()) {
+    cerr << "WARNING: checkpoint " << checkpointFileName << " was written with a different configuration;"
+         << " starting from the beginning" << endl;
+    entry = 0;
+  }
+  else if(where==nullptr || position==nullptr || position->size()!=2+counters.size()
+      || totals==nullptr || totals->size()!=2*reconMethods.size() || histosDir==nullptr || sparseDir==nullptr)
+    cerr << "ERROR: checkpoint " << checkpointFileName << " is incomplete" << endl;
+  else if(HD->ReadCheckpoint(histosDir)) {
+    entry = position->at(0);
+    for(auto &kv : sparseMap) {
+      auto sparse = sparseDir->Get<THnSparseD>(kv.first);
+      if(sparse==nullptr) {
+        cerr << "ERROR: " << kv.first << " is not in the checkpoint" << endl;
+        entry = -1;
+        break;
+      };
+      delete kv.second;
+      kv.second = sparse;
+    };
+    if(entry>=0) {
+      zoneMapSkipped = position->at(1);
+      for(std::size_t c=0; c<counters.size(); c++) *counters[c] = position->at(2+c);
+      SetWeightTotals(totals);
+      cout << "checkpoint: resuming from " << where->GetTitle() << endl;
+    };
+  };
+  cpFile->Close();
+  delete cpFile;
+
+  // outputs which need the events before the checkpoint, and are only caches for later runs
+  if(entry>0) {
+    if(entryListOut) {
+      cerr << "WARNING: the event selection list is not recorded, since the run is resumed" << endl;
+      delete entryListOut;
+      entryListOut = nullptr;
+    };
+    if(eventCacheOut) {
+      cerr << "WARNING: the event cache is not recorded, since the run is resumed" << endl;
+      ClearEventCache();
+      eventCacheOut = nullptr;
+    };
+  };
+  return entry;
+};
+
+// `entry` is about to be processed, so the checkpoint has the events before it
+void Analysis::Checkpoint(Long64_t entry) {
+  if(checkpointEvents<=0 && checkpointSeconds<=0) return;
+  if( (checkpointEvents>0 && checkpointCount>=checkpointEvents) ||
+      (checkpointSeconds>0 && checkpointCount%100==0 && (Long64_t)gSystem->Now()-checkpointTime >= 1000*checkpointSeconds) )
+    WriteCheckpoint(entry);
+  checkpointCount++;
+};
+
+// write to a temporary file, then rename, so that an interruption while writing
+// leaves the previous checkpoint
+void Analysis::WriteCheckpoint(Long64_t entry) {
+  TStopwatch timer;
+  timer.Start();
+  TString tmpName = TString::Format("%s.%d.tmp",checkpointFileName.Data(),gSystem->GetPid());
+  {
+    TDirectory::TContext context;
+    TFile *cpFile = new TFile(tmpName,"RECREATE","",404); // fast LZ4 compression
+    if(cpFile->IsZombie()) {
+      cerr << "ERROR: cannot write checkpoint " << tmpName << endl;
+      delete cpFile;
+      return;
+    };
+    TString where = TString::Format("entry %lld of the event loop",entry);
+    if(readFileName!="") where += ", in input file "+readFileName;
+    TNamed("checkpointKey",CheckpointKey()).Write();
+    TNamed("position",where).Write();
+    std::vector<Long64_t> position = { entry, zoneMapSkipped };
+    for(Long64_t *counter : checkpointCounters) position.push_back(*counter);
+    cpFile->WriteObject(&position,"counters");
+    std::vector<Double_t> totals = GetWeightTotals();
+    cpFile->WriteObject(&totals,"weightTotals");
+    HD->WriteCheckpoint(cpFile->mkdir("histos"));
+    TDirectory *sparseDir = cpFile->mkdir("sparse");
+    for(auto const &kv : sparseMap) sparseDir->WriteTObject(kv.second,kv.first);
+    cpFile->Close();
+    delete cpFile;
+  };
+  if(gSystem->Rename(tmpName,checkpointFileName)!=0) {
+    cerr << "ERROR: cannot write checkpoint " << checkpointFileName << endl;
+    gSystem->Unlink(tmpName);
+    return;
+  };
+  checkpointCount = 0;
+  checkpointTime = (Long64_t)gSystem->Now();
+  timer.Stop();
+  cout << "checkpoint: wrote entry " << entry << " to " << checkpointFileName
+       << Form(" (%.1f s)",timer.RealTime()) << endl;
+};
+
+TString Analysis::CheckpointKey() {
+  TString key = TString::Format("%s; sparse %d", ClassName(), (Int_t)writeSparse);
+  if(writeSparse) {
+    for(const SparseAxis &axis : sparseAxes)
+      key += TString::Format(" %s:%d:%.17g:%.17g:%d", axis.varName.Data(), axis.nBins, axis.lower, axis.upper, (Int_t)axis.logScale);
+  };
+  return key + TString::Format("; moments %d %d; histos %u; entryList %lld; ",
+      (Int_t)useMoments, (Int_t)useAsymMoments, histosFamilies,
+      entryListIn ? entryListIn->GetN() : (Long64_t)-1) + EntryListKey();
+};
+
+
+// input reading
+//------------------------------------
+// the used branches are added to the cache, and its learning phase is stopped, so that
+// the first entries are also read in a few large requests, and no other branches are read
+// - `TFile.AsyncPrefetching` is a global setting, so it is restored by `FinishRead`
+void Analysis::PrepareRead(TChain *chain, std::vector<TString> branches) {
+  readTreeNum = -1;
+  readStats.clear();
+  if(readPrefetch) {
+    if(readPrefetchPrev<0) readPrefetchPrev = gEnv->GetValue("TFile.AsyncPrefetching",0);
+    gEnv->SetValue("TFile.AsyncPrefetching",1);
+  };
+  if(readCacheMB<=0) return;
+  chain->SetCacheSize((Long64_t)(readCacheMB*1024*1024));
+  if(chain->LoadTree(0)<0) return;
+  for(TString branch : branches) {
+    if(chain->AddBranchToCache(branch,true)<0)
+      cerr << "WARNING: cannot add branch " << branch << " to the TTreeCache" << endl;
+  };
+  chain->StopCacheLearningPhase();
+  cout << "input reading: " << readCacheMB << " MB TTreeCache with " << branches.size() << " branches"
+       << (readPrefetch ? ", asynchronous prefetching" : "") << endl;
+};
+
+// when the chain moves to the next file, end the statistics of the previous one
+// - the statistics are the counters of the input file itself, so that other I/O (e.g.,
+//   checkpoints, skims, or the output) is not counted; they are copied for each event,
+//   since the file is closed when the chain moves to the next one
+void Analysis::MonitorRead(TChain *chain) {
+  Int_t treeNum = chain->GetTreeNumber();
+  if(treeNum!=readTreeNum) {
+    EndReadStats();
+    readTreeNum = treeNum;
+    readFileName = chain->GetListOfFiles()->At(treeNum)->GetTitle();
+    readTimer.Start(true);
+  };
+  TFile *file = chain->GetFile();
+  if(file) {
+    readCalls = file->GetReadCalls();
+    readBytes = file->GetBytesRead();
+  };
+};
+
+void Analysis::EndReadStats() {
+  if(readTreeNum<0) return;
+  readTimer.Stop();
+  InputReadStats stats;
+  stats.fileName = readFileName;
+  stats.readCalls = readCalls;
+  stats.bytesRead = readBytes;
+  stats.realTime = readTimer.RealTime();
+  readStats.push_back(stats);
+  readTreeNum = -1;
+  readCalls = 0;
+  readBytes = 0;
+};
+
+// print the read statistics, and restore `TFile.AsyncPrefetching`
+void Analysis::FinishRead() {
+  if(readPrefetchPrev>=0) {
+    gEnv->SetValue("TFile.AsyncPrefetching",readPrefetchPrev);
+    readPrefetchPrev = -1;
+  };
+  EndReadStats();
+  if(readStats.empty()) return;
+  Long64_t totCalls = 0;
+  Long64_t totBytes = 0;
+  Double_t totTime = 0;
+  cout << "input read statistics:" << endl;
+  for(const InputReadStats &stats : readStats) {
+    cout << "  " << stats.fileName << ": " << stats.readCalls << " read calls, "
+         << Form("%.2f MB, %.2f s",stats.bytesRead/1024./1024.,stats.realTime) << endl;
+    totCalls += stats.readCalls;
+    totBytes += stats.bytesRead;
+    totTime += stats.realTime;
+  };
+  cout << "  total: " << totCalls << " read calls, "
+       << Form("%.2f MB, %.2f s",totBytes/1024./1024.,totTime);
+  if(totCalls>0) cout << Form("; %.1f kB per read call",totBytes/1024./totCalls);
+  cout << endl;
+};
+
+
+// event selection lists
+//------------------------------------
+// read `entryListFile`, if its cut configuration matches; otherwise start recording
+void Analysis::PrepareEntryList() {
+  entryListIn = nullptr;
+  entryListOut = nullptr;
+  if(writeSparse || skimFile!="") {
+    cerr << "WARNING: entryListFile is ignored, since writeSparse or skimFile is set" << endl;
+    entryListFile = "";
+    return;
+  };
+  entryListKey = EntryListKey();
+  TFile *listFile = gSystem->AccessPathName(entryListFile) ? nullptr : TFile::Open(entryListFile);
+  if(listFile && !listFile->IsZombie()) {
+    auto key = listFile->Get<TNamed>("entryListKey");
+    auto list = listFile->Get<TEntryList>("entryList");
+    auto totals = listFile->Get<std::vector<Double_t>>("weightTotals");
+    if(key && list && totals && totals->size()==2*reconMethods.size() && entryListKey==key->GetTitle()) {
+      entryListIn = (TEntryList*) list->Clone();
+      entryListIn->SetDirectory(nullptr);
+      entryListWeightTotals = *totals;
+      cout << "event selection list: reading only the " << entryListIn->GetN()
+           << " selected entries of " << entryListFile << endl;
+    }
+    else cout << "event selection list: " << entryListFile << " was recorded with different cuts; recording it again" << endl;
+  };
+  if(listFile) {
+    listFile->Close();
+    delete listFile;
+  };
+  if(entryListIn==nullptr) {
+    entryListOut = new TEntryList("entryList","entries with at least one histogram fill");
+    entryListOut->SetDirectory(nullptr);
+    cout << "event selection list: recording selected entries to " << entryListFile << endl;
+  };
+};
+
+// everything which decides whether an event fills a histogram; the user observable
+// functions, weight parameters, and changes to `HD` after `Prepare` are not included
+TString Analysis::EntryListKey() {
+  TString key = TString::Format("beams %.17g %.17g %.17g; frame %d %d; jets %d %.17g %d; maxEvents %lld; weights %s %s;",
+      eleBeamEn, ionBeamEn, crossingAngle,
+      kin->mainFrame, kin->qComponentsMethod,
+      (Int_t)useBreitJets, jetRadius, (Int_t)jetStrategy,
+      (Long64_t)maxEvents, weight->ClassName(), weightJet->ClassName());
+  key += " recon:";
+  for(TString reconMethodN : reconMethods) key += " "+reconMethodN;
+  key += "; finalState:";
+  for(TString finalStateN : activeFinalStates) key += " "+finalStateN;
+  key += "; bins:";
+  for(auto const &kv : binSchemes) {
+    key += " "+kv.first+" {";
+    for(Int_t b=0; b<kv.second->GetNumBins(); b++) {
+      CutDef *cut = kv.second->Cut(b);
+      Double_t low, high;
+      if(!cut->GetInterval(low,high)) low = high = 0;
+      key += TString::Format(" %s:%s:%.17g:%.17g", cut->GetCutType().Data(), cut->GetCutID().Data(), low, high);
+    };
+    key += " }";
+  };
+  key += "; inputs:";
+  for(std::size_t idx=0; idx<infiles.size(); idx++) {
+    key += TString::Format(" Q2>%.17g xsec=%.17g", Q2mins[idx], Q2xsecs[idx]);
+    for(std::size_t idxF=0; idxF<infiles[idx].size(); idxF++)
+      key += TString::Format(" %s:%lld", infiles[idx][idxF].c_str(), inEntries[idx][idxF]);
+  };
+  return key;
+};
+
+TEntryList *Analysis::UseEntryList(TChain *chain) {
+  if(entryListIn==nullptr) return nullptr;
+  chain->SetEntryList(entryListIn);
+  return entryListIn;
+};
+
+// called for each fill; the entry is added once per event, to the sub-list of its file
+void Analysis::RecordSelectedEvent() {
+  if(entryListOut==nullptr || eventTree==nullptr || eventRecorded) return;
+  entryListOut->Enter(eventEntry, eventTree);
+  eventRecorded = true;
+};
+
+// write the recorded list, with the total weights of this run, which a run reading
+// the list does not see all of
+void Analysis::WriteEntryList() {
+  if(entryListOut==nullptr) return;
+  TDirectory *prevDir = gDirectory;
+  TFile *listFile = new TFile(entryListFile,"RECREATE");
+  if(listFile->IsZombie()) cerr << "ERROR: cannot write event selection list " << entryListFile << endl;
+  else {
+    entryListOut->Write("entryList");
+    TNamed("entryListKey",entryListKey).Write();
+    std::vector<Double_t> totals = GetWeightTotals();
+    listFile->WriteObject(&totals,"weightTotals");
+    cout << "event selection list: wrote " << entryListOut->GetN() << " entries to " << entryListFile << endl;
+  };
+  listFile->Close();
+  delete listFile;
+  prevDir->cd();
+};
+
+
+// zone maps
+//------------------------------------
+// quantities of each recon method, in the order filled by `ZoneMapFill`
+namespace {
+  const std::vector<TString> zoneMapNames = {
+    "q2", "x", "y", "w", "eleE", "q2True", "xTrue", "yTrue", "wTrue", "eleEtrue"
+  };
+}
+
+// find the range of the bins of each DIS bin scheme; a cluster may be skipped if, for every
+// recon method, the cluster's range of at least one of them is outside of it
+void Analysis::PrepareZoneMap() {
+  zoneMapEnvelope.clear();
+  zoneMapQuantities.clear();
+  for(TString reconMethodN : reconMethods) {
+    for(TString name : zoneMapNames) zoneMapQuantities.push_back(reconMethodN+":"+name);
+  };
+  zoneMapFileEntries.clear();
+  for(auto const &entries : inEntries) zoneMapFileEntries.insert(zoneMapFileEntries.end(), entries.begin(), entries.end());
+  zoneMap = nullptr;
+  zoneMapBuild = false;
+  zoneMapTreeStart = zoneMapTreeEnd = zoneMapCheckEnd = 0;
+  zoneMapLastEntry = -1;
+  zoneMapSkipped = 0;
+  if(writeSparse || skimFile!="") {
+    cerr << "WARNING: useZoneMap is ignored, since writeSparse or skimFile is set" << endl;
+    useZoneMap = false;
+    return;
+  };
+  if(entryListIn) {
+    cout << "zone map: not needed, since the event selection list is read" << endl;
+    useZoneMap = false;
+    return;
+  };
+  Bool_t useJets = activeFinalStates.find("jet")!=activeFinalStates.end();
+  for(TString varName : {"x","q2","y","w"}) {
+    if(varName=="w" && useJets) continue; // jets are not binned in `w` (see `FillHistosJets`)
+    auto it = binSchemes.find(varName);
+    if(it==binSchemes.end() || it->second->GetNumBins()==0) continue;
+    Double_t envLow = DBL_MAX;
+    Double_t envHigh = -DBL_MAX;
+    Bool_t bounded = true;
+    for(Int_t b=0; b<it->second->GetNumBins(); b++) {
+      Double_t low, high;
+      if(!it->second->Cut(b)->GetInterval(low,high)) { bounded = false; break; };
+      envLow = TMath::Min(envLow,low);
+      envHigh = TMath::Max(envHigh,high);
+    };
+    if(!bounded || (envLow==-DBL_MAX && envHigh==DBL_MAX)) continue;
+    zoneMapEnvelope.insert(std::pair<TString,std::pair<Double_t,Double_t>>(varName,{envLow,envHigh}));
+    cout << "zone map: skip clusters with no events in " << envLow << " <= " << varName << " <= " << envHigh << endl;
+  };
+  if(zoneMapEnvelope.empty()) cout << "zone map: no x, q2, y, or w bins to skip clusters with; zone maps are only built" << endl;
+};
+
+// next entry to read, starting from `e`
+Long64_t Analysis::ZoneMapNextEntry(TChain *chain, Long64_t e, Long64_t numEntries) {
+  if(!useZoneMap) return e;
+  while(e<numEntries) {
+    if(e<zoneMapTreeStart || e>=zoneMapTreeEnd) ZoneMapOpen(chain,e);
+    if(zoneMap==nullptr) return e;
+    if(zoneMapBuild) {
+      if(e!=zoneMapLastEntry) zoneMap->Count(e-zoneMapTreeStart);
+      zoneMapLastEntry = e;
+      return e;
+    };
+    if(e<zoneMapCheckEnd) return e;
+    Int_t c = zoneMap->FindCluster(e-zoneMapTreeStart);
+    if(c<0) return e;
+    Long64_t clusterEnd = TMath::Min(zoneMapTreeStart+zoneMap->GetClusterEnd(c), zoneMapTreeEnd);
+    // - only whole clusters are skipped, since their weights are only known in total
+    if(e!=zoneMapTreeStart+zoneMap->GetClusterStart(c) || clusterEnd>numEntries || !ZoneMapSkip(c)) {
+      zoneMapCheckEnd = clusterEnd;
+      return e;
+    };
+    zoneMapSkipped += clusterEnd - e;
+    // - add the weights of the skipped tracks and jets, with the Q2 weights of this run
+    for(std::size_t r=0; r<reconMethods.size(); r++) {
+      for(std::size_t q=0; q<Q2mins.size(); q++) {
+        Int_t b = ZoneMapWeightBin(r,q);
+        wTrackTotal[reconMethods[r]] += Q2weights[q] * zoneMap->GetWeight(c,false,b);
+        wJetTotal[reconMethods[r]] += Q2weights[q] * zoneMap->GetWeight(c,true,b);
+      };
+    };
+    e = clusterEnd;
+  };
+  return numEntries;
+};
+
+// load the zone map of the file of entry `e`, if it is valid, otherwise start building it
+void Analysis::ZoneMapOpen(TChain *chain, Long64_t e) {
+  ZoneMapClose();
+  Long64_t local = chain->LoadTree(e);
+  if(local<0) {
+    zoneMapTreeStart = e;
+    zoneMapTreeEnd = e+1;
+    return;
+  };
+  Int_t treeNum = chain->GetTreeNumber();
+  zoneMapTreeStart = e - local;
+  zoneMapTreeEnd = zoneMapTreeStart + zoneMapFileEntries.at(treeNum);
+  zoneMapCheckEnd = zoneMapTreeStart;
+
+  // the ID changes if the file is rewritten, or if the settings which change the quantities
+  // or the weights change
+  TFile *file = chain->GetFile();
+  TString id = TString::Format("%s %lld %.17g %.17g %.17g %d %d; weights %s %s; recon:",
+      file->GetUUID().AsString(), file->GetSize(),
+      eleBeamEn, ionBeamEn, crossingAngle, kin->mainFrame, kin->qComponentsMethod,
+      weight->ClassName(), weightJet->ClassName());
+  for(TString reconMethodN : reconMethods) id += " "+reconMethodN;
+  id += "; finalState:";
+  for(TString finalStateN : activeFinalStates) id += " "+finalStateN;
+  id += "; Q2min:";
+  for(Double_t Q2min : Q2mins) id += TString::Format(" %.17g",Q2min);
+  TString inputName = file->GetName();
+  TString zoneMapName = zoneMapDir=="" ?
+    inputName+".zonemap" :
+    zoneMapDir+"/"+gSystem->BaseName(inputName)+".zonemap";
+
+  zoneMap = new ZoneMap(zoneMapName);
+  if(zoneMap->Load() && zoneMap->GetID()==id && zoneMap->IsComplete(zoneMapFileEntries.at(treeNum))
+      && zoneMap->GetNumWeightBins()==(Int_t)(reconMethods.size()*Q2mins.size())) {
+    zoneMapBuild = std::any_of(zoneMapQuantities.begin(), zoneMapQuantities.end(),
+        [this](TString name){ return !zoneMap->HasQuantity(name); });
+  }
+  else zoneMapBuild = true;
+  if(zoneMapBuild) {
+    zoneMap->Init(id, chain->GetTree(), zoneMapQuantities, reconMethods.size()*Q2mins.size());
+    zoneMapLastEntry = -1;
+    cout << "zone map: building " << zoneMapName << endl;
+  }
+  else cout << "zone map: using " << zoneMapName << endl;
+};
+
+void Analysis::ZoneMapClose() {
+  if(zoneMap==nullptr) return;
+  if(zoneMapBuild && zoneMap->Save()) cout << "zone map: wrote " << zoneMap->GetName() << endl;
+  delete zoneMap;
+  zoneMap = nullptr;
+  zoneMapBuild = false;
+};
+
+// fill the zone map being built, for the current recon method
+void Analysis::ZoneMapFill() {
+  if(!zoneMapBuild) return;
+  Int_t q = ReconMethodIdx() * zoneMapNames.size();
+  const Double_t values[] = {
+    kin->Q2, kin->x, kin->y, kin->W, kin->vecElectron.E(),
+    kinTrue->Q2, kinTrue->x, kinTrue->y, kinTrue->W, kinTrue->vecElectron.E()
+  };
+  for(Double_t value : values) zoneMap->Fill(q++, value);
+};
+
+// add the weight of the current track, or of the current event's jets, to the zone map being
+// built; the Q2 weight is not included, since it depends on all the input files, so the
+// weights are summed in bins of the recon method and of the Q2 ranges instead
+void Analysis::ZoneMapFillWeight(Bool_t jet) {
+  if(!zoneMapBuild || Q2mins.empty()) return;
+  Int_t q2Idx = GetEventQ2Idx(kinTrue->Q2, 0);
+  if(q2Idx<0) return; // (the Q2 weight is zero)
+  zoneMap->FillWeight(jet, ZoneMapWeightBin(ReconMethodIdx(),q2Idx),
+      jet ? weightJet->GetWeight(*kinTrue) : weight->GetWeight(*kinTrue));
+};
+
+Bool_t Analysis::ZoneMapSkip(Int_t c) {
+  if(zoneMapEnvelope.empty() || !zoneMap->IsComplete(c)) return false;
+  for(TString reconMethodN : reconMethods) {
+    Bool_t outside = false;
+    for(auto const &kv : zoneMapEnvelope) {
+      Double_t min, max;
+      if(!zoneMap->GetRange(c, reconMethodN+":"+kv.first, min, max)) return false;
+      if(max < kv.second.first || min > kv.second.second) { outside = true; break; };
+    };
+    if(!outside) return false;
+  };
+  return true;
+};
+
+
+// skims
+//------------------------------------
+// write the event-level inputs of the current event; its hadrons are written by
+// `WriteSkimHadron`, before the recon method loop, so that they do not depend on
+// which recon methods accept the event
+void Analysis::WriteSkimEvent(TChain *chain) {
+  if(skimOut==nullptr && eventCacheOut==nullptr) return;
+  SkimEvent ev;
+  const TLorentzVector *vecs[] = {
+    &(kin->vecElectron), &(kinTrue->vecElectron), &(kinTrue->vecEleBeam), &(kinTrue->vecIonBeam) };
+  const Int_t offsets[] = {
+    SkimEvent::kEle, SkimEvent::kEleTrue, SkimEvent::kEleBeamTrue, SkimEvent::kIonBeamTrue };
+  for(Int_t v=0; v<4; v++) {
+    for(Int_t c=0; c<4; c++) ev.vec[offsets[v]+c] = (*vecs[v])[c];
+  };
+  Kinematics *kins[] = { kin, kinTrue };
+  const Int_t hfsOffsets[] = { SkimEvent::kHFS, SkimEvent::kHFSTrue };
+  for(Int_t k=0; k<2; k++) {
+    Double_t *hfs = ev.vec + hfsOffsets[k];
+    hfs[0] = kins[k]->sigmah;
+    hfs[1] = kins[k]->Pxh;
+    hfs[2] = kins[k]->Pyh;
+    for(Int_t c=0; c<4; c++) hfs[3+c] = kins[k]->hadronSumVec[c];
+  };
+  ev.entry = eventEntry;
+  ev.fileID = eventFileID;
+  ev.q2Idx = inLookup[chain->GetTreeNumber()];
+  if(skimOut) skimOut->BeginEvent(ev);
+  if(eventCacheOut) {
+    eventCacheOut->BeginEvent(ev);
+    if(eventCacheOut->GetMemorySize() > eventCacheMB*1024*1024) {
+      cerr << "WARNING: the event cache exceeds eventCacheMB=" << eventCacheMB << "; not caching this run" << endl;
+      ClearEventCache();
+      eventCacheOut = nullptr;
+    };
+  };
+};
+
+// write the current hadron
+void Analysis::WriteSkimHadron() {
+  if(!WritingSkim()) return;
+  SkimHadron had;
+  for(Int_t c=0; c<4; c++) {
+    had.vec[SkimHadron::kP4+c] = kin->vecHadron[c];
+    had.vec[SkimHadron::kP4True+c] = kinTrue->vecHadron[c];
+  };
+  had.pid = kin->hadPID;
+  had.pidTrue = kinTrue->hadPID;
+  had.index = kin->GetRandomHadron();
+  if(skimOut) skimOut->AddHadron(had);
+  if(eventCacheOut) eventCacheOut->AddHadron(had);
+};
+
+// replay event `e` of `skimIn`: the same as the recon method and track loops of
+// the readers, with the inputs from the skim
+void Analysis::ReplayEvent(SkimFile *skimIn, Long64_t e) {
+  SkimEvent ev;
+  if(!skimIn->ReadEvent(e,ev)) return;
+  const Double_t *v = ev.vec;
+  kin->vecElectron.SetPxPyPzE(v[SkimEvent::kEle], v[SkimEvent::kEle+1], v[SkimEvent::kEle+2], v[SkimEvent::kEle+3]);
+  kinTrue->vecElectron.SetPxPyPzE(v[SkimEvent::kEleTrue], v[SkimEvent::kEleTrue+1], v[SkimEvent::kEleTrue+2], v[SkimEvent::kEleTrue+3]);
+  kinTrue->vecEleBeam.SetPxPyPzE(v[SkimEvent::kEleBeamTrue], v[SkimEvent::kEleBeamTrue+1], v[SkimEvent::kEleBeamTrue+2], v[SkimEvent::kEleBeamTrue+3]);
+  kinTrue->vecIonBeam.SetPxPyPzE(v[SkimEvent::kIonBeamTrue], v[SkimEvent::kIonBeamTrue+1], v[SkimEvent::kIonBeamTrue+2], v[SkimEvent::kIonBeamTrue+3]);
+  Kinematics *kins[] = { kin, kinTrue };
+  const Int_t hfsOffsets[] = { SkimEvent::kHFS, SkimEvent::kHFSTrue };
+  for(Int_t k=0; k<2; k++) {
+    const Double_t *hfs = v + hfsOffsets[k];
+    kins[k]->sigmah = hfs[0];
+    kins[k]->Pxh = hfs[1];
+    kins[k]->Pyh = hfs[2];
+    kins[k]->hadronSumVec.SetPxPyPzE(hfs[3], hfs[4], hfs[5], hfs[6]);
+    kins[k]->SetRandomKey(ev.fileID, ev.entry);
+  };
+
+  SkimHadron had;
+  for(TString reconMethodN : reconMethods) {
+    reconMethod = reconMethodN;
+
+    // calculate DIS kinematics
+    if(!(kin->CalculateDIS(reconMethod))) continue; // reconstructed
+    if(!(kinTrue->CalculateDIS(reconMethod))) continue; // generated (truth)
+
+    // hadron loop
+    for(Long64_t j=0; j<ev.numHadrons; j++) {
+      skimIn->ReadHadron(j,had);
+
+      // final state cut
+      auto kv = PIDtoFinalState.find(had.pid);
+      if(kv!=PIDtoFinalState.end()) finalStateID = kv->second; else continue;
+      if(activeFinalStates.find(finalStateID)==activeFinalStates.end()) continue;
+
+      // calculate hadron kinematics
+      const Double_t *h = had.vec;
+      kin->hadPID = had.pid;
+      kin->vecHadron.SetPxPyPzE(h[SkimHadron::kP4], h[SkimHadron::kP4+1], h[SkimHadron::kP4+2], h[SkimHadron::kP4+3]);
+      kinTrue->hadPID = had.pidTrue;
+      kinTrue->vecHadron.SetPxPyPzE(h[SkimHadron::kP4True], h[SkimHadron::kP4True+1], h[SkimHadron::kP4True+2], h[SkimHadron::kP4True+3]);
+      kin->SetRandomHadron(had.index);
+      kinTrue->SetRandomHadron(had.index);
+      kin->CalculateHadronKinematics();
+      kinTrue->CalculateHadronKinematics();
+
+      // weighting
+      Double_t Q2weightFactor = GetEventQ2Weight(kinTrue->Q2, ev.q2Idx);
+      wTrack = Q2weightFactor * weight->GetWeight(*kinTrue);
+      wTrackTotal[reconMethod] += wTrack;
+
+      // fill track histograms in activated bins
+      FillHistosTracks();
+
+      // fill simple tree
+      if( writeSimpleTree && activeEvent && IsMainReconMethod() ) ST->FillTree(wTrack);
+    };
+  };
+};
+
+
+// in-memory event cache
+//------------------------------------
+// the cache outlives the `Analysis` which recorded it, so that the next one may use it
+namespace {
+  SkimFile *eventCache = nullptr;
+  Bool_t eventCacheComplete = false; // true once the run which recorded it has finished
+  TString eventCacheKey = "";
+  std::set<TString> eventCacheFinalStates; // final states of the run which recorded it
+  Long64_t eventCacheHits = 0;
+  Long64_t eventCacheMisses = 0;
+}
+
+void Analysis::ClearEventCache() {
+  if(eventCache) delete eventCache;
+  eventCache = nullptr;
+  eventCacheComplete = false;
+  eventCacheKey = "";
+};
+
+// use the cache if it has all the events this analysis needs: the hadrons of each event
+// are cached if they are in one of the final states of the recording run, for any recon
+// method; otherwise start recording
+void Analysis::PrepareEventCache() {
+  eventCacheOut = nullptr;
+  eventCacheHit = false;
+  if(writeSparse || skimFile!="" || useZoneMap || entryListFile!=""
+      || activeFinalStates.find("jet")!=activeFinalStates.end()) {
+    cerr << "WARNING: eventCacheMB is ignored, since jets, writeSparse, skimFile, useZoneMap, or entryListFile is used" << endl;
+    return;
+  };
+  TString key = EventCacheKey();
+  TString missReason = "";
+  if(eventCache==nullptr || !eventCacheComplete) missReason = "empty";
+  else if(key!=eventCacheKey) missReason = "different inputs";
+  else {
+    for(TString finalStateN : activeFinalStates) {
+      if(eventCacheFinalStates.find(finalStateN)==eventCacheFinalStates.end()) missReason = "final state "+finalStateN+" not cached";
+    };
+  };
+  if(missReason=="") {
+    eventCacheHit = true;
+    eventCacheHits++;
+    cout << "event cache: hit; replaying " << eventCache->GetNumEvents() << " events from memory" << endl;
+    return;
+  };
+  eventCacheMisses++;
+  cout << "event cache: miss (" << missReason << "); caching the events of this run" << endl;
+  ClearEventCache();
+  eventCache = new SkimFile("event cache");
+  if(!eventCache->OpenWrite(eleBeamEn, ionBeamEn, crossingAngle, 4096, true)) {
+    ClearEventCache();
+    return;
+  };
+  eventCacheKey = key;
+  eventCacheFinalStates = activeFinalStates;
+  eventCacheOut = eventCache;
+};
+
+// the reader class, beams, `maxEvents`, and input files (and their Q2 ranges) decide which
+// events are cached
+TString Analysis::EventCacheKey() {
+  TString key = TString::Format("%s; beams %.17g %.17g %.17g; maxEvents %lld; inputs:",
+      ClassName(), eleBeamEn, ionBeamEn, crossingAngle, (Long64_t)maxEvents);
+  for(std::size_t idx=0; idx<infiles.size(); idx++) {
+    key += TString::Format(" Q2>%.17g", Q2mins[idx]);
+    for(std::size_t idxF=0; idxF<infiles[idx].size(); idxF++)
+      key += TString::Format(" %s:%lld", infiles[idx][idxF].c_str(), inEntries[idx][idxF]);
+  };
+  return key;
+};
+
+Bool_t Analysis::ReplayEventCache() {
+  if(!eventCacheHit || eventCache==nullptr || !eventCache->OpenRead()) return false;
+  CalculateEventQ2Weights();
+  ENT = eventCache->GetNumEvents();
+
+  // event loop =========================================================
+  cout << "begin event loop (from the event cache)..." << endl;
+  TStopwatch loopTimer;
+  loopTimer.Start();
+  for(Long64_t e=0; e<ENT; e++) {
+    if(e>0&&e%100000==0) cout << (Double_t)e/ENT*100 << "%" << endl;
+    ReplayEvent(eventCache,e);
+  };
+  loopTimer.Stop();
+  cout << "end event loop" << endl;
+  // event loop end =========================================================
+
+  Double_t loopTime = loopTimer.RealTime();
+  if(loopTime>0)
+    cout << "event loop: " << ENT << " events in " << loopTime << " s ("
+         << ENT/loopTime << " events/s)" << endl;
+  eventCache->Close(); // (keeps the events in memory)
+  Finish();
+  return true;
+};
+
+// keep the cache recorded by this run, and report the cache use
+void Analysis::FinishEventCache() {
+  if(eventCacheOut) {
+    eventCacheOut->Close();
+    eventCacheComplete = true;
+    eventCacheOut = nullptr;
+  };
+  cout << "event cache: " << eventCacheHits << " hits, " << eventCacheMisses << " misses in this session; "
+       << Form("%.2f",eventCache ? eventCache->GetMemorySize()/1024./1024. : 0.) << " MB in memory" << endl;
+};
+
+
+// demand-driven observables
+//------------------------------------
+// add a user-defined observable
+void Analysis::AddObservable(
+    TString name, TString title,
+    std::function<Double_t(const Kinematics&)> func,
+    UInt_t deps
+    )
+{
+  if(availableBinSchemes.find(name)!=availableBinSchemes.end()) {
+    cerr << "ERROR: observable " << name << " already exists" << endl;
+    return;
+  };
+  availableBinSchemes.insert(std::pair<TString,TString>(name,title));
+  userObservables.insert(std::pair<TString,std::function<Double_t(const Kinematics&)>>(name,func));
+  userObservableDeps.insert(std::pair<TString,UInt_t>(name,deps));
+};
+
+UInt_t Analysis::ObservableDeps(TString obsName) {
+  auto it = userObservableDeps.find(obsName);
+  if(it!=userObservableDeps.end()) return it->second;
+  return Kinematics::ObservableDeps(obsName);
+};
+
+// find the observable groups needed for reconstructed (`kin`) and generated (`kinTrue`)
+// kinematics, from everything that reads them in the event loop
+void Analysis::PrepareObservables() {
+  using K = Kinematics;
+  UInt_t depsRec = K::oDIS;
+  UInt_t depsTrue = K::oDIS;
+
+  // bin schemes
+  for(auto kv : binSchemes) {
+    if(kv.first=="finalState" || kv.first=="recon") continue;
+    depsRec |= ObservableDeps(kv.first);
+  };
+
+  // histograms, moments, and asymmetries, as declared in `DefineHistos`
+  depsRec |= histosDepsRec;
+  depsTrue |= histosDepsTrue;
+
+  // SimpleTree branches
+  if(writeSimpleTree) {
+    for(TString column : ST->GetColumnNames()) {
+      if(column.BeginsWith("True")) depsTrue |= K::ObservableDeps(column(4,column.Length()));
+      else depsRec |= K::ObservableDeps(column);
+    };
+  };
+
+  // sparses (see `BookSparse`)
+  if(writeSparse) {
+    for(const SparseAxis &axis : sparseAxes) depsRec |= ObservableDeps(axis.varName);
+  };
+
+  // weights, which are calculated from generated kinematics
+  depsTrue |= weight->GetDeps() | weightJet->GetDeps();
+
+  // user-defined observables, which are always added to `valueMap`
+  for(auto kv : userObservableDeps) depsRec |= kv.second;
+
+  if(calculateAllObservables) depsRec = depsTrue = K::oAll;
+  kin->SetCalcMask(depsRec);
+  kinTrue->SetCalcMask(depsTrue);
+  cout << "observables calculated:" << endl;
+  cout << "  reconstructed: " << K::ObservableGroups(depsRec) << endl;
+  cout << "  generated:     " << K::ObservableGroups(depsTrue) << endl;
+};
+
+
+// histogram definitions, booked in every Histos object
+//------------------------------------
+std::function<void(Histos*)> Analysis::DefineHistos() {
+  // - each definition is preceded by `SetObservableDeps`, declaring the observable groups
+  //   it is filled with in `FillHistosTracks`, for reconstructed and generated kinematics;
+  //   keep these in sync with the fills (see `PrepareObservables`)
+  using K = Kinematics;
+  return [this](Histos *HS){
     // -- Full phase space histogram
-    HS->DefineHist4D(
-        "full_xsec",
-        "x","Q^{2}","z","p_{T}",
-        "","GeV^{2}","","GeV",
-        NBINS_FULL,1e-3,1,
-        NBINS_FULL,1,100,
-        NBINS_FULL,0,1,
-        NBINS_FULL,0,2,
-        true,true
-        );
+    if(histosFamilies & hFull) {
+      HS->SetObservableDeps(K::oPT|K::oZ);
+      HS->DefineHist4D(
+          "full_xsec",
+          "x","Q^{2}","z","p_{T}",
+          "","GeV^{2}","","GeV",
+          NBINS_FULL,1e-3,1,
+          NBINS_FULL,1,100,
+          NBINS_FULL,0,1,
+          NBINS_FULL,0,2,
+          true,true
+          );
+    };
     // -- DIS kinematics
-    HS->DefineHist2D("Q2vsX","x","Q^{2}","","GeV^{2}",
-        NBINS,1e-3,1,
-        NBINS,1,3000,
-        true,true
-        );
-    HS->DefineHist1D("Q","Q","GeV",NBINS,1.0,55.0,true,true);
-    HS->DefineHist1D("x","x","",NBINS,1e-3,1.0,true,true);
-    HS->DefineHist1D("y","y","",NBINS,1e-3,1,true);
-    HS->DefineHist1D("W","W","GeV",NBINS,0,50);
+    if(histosFamilies & hDIS) {
+      HS->SetObservableDeps(K::oDIS);
+      HS->DefineHist2D("Q2vsX","x","Q^{2}","","GeV^{2}",
+          NBINS,1e-3,1,
+          NBINS,1,3000,
+          true,true
+          );
+      HS->DefineHist1D("Q","Q","GeV",NBINS,1.0,55.0,true,true);
+      HS->DefineHist1D("x","x","",NBINS,1e-3,1.0,true,true);
+      HS->DefineHist1D("y","y","",NBINS,1e-3,1,true);
+      HS->DefineHist1D("W","W","GeV",NBINS,0,50);
+    };
     // -- hadron 4-momentum
-    HS->DefineHist1D("pLab","p_{lab}","GeV",NBINS,0,10);
-    HS->DefineHist1D("pTlab","p_{T}^{lab}","GeV",NBINS,1e-2,3,true);
-    HS->DefineHist1D("etaLab","#eta_{lab}","",NBINS,-5,5);
-    HS->DefineHist1D("phiLab","#phi_{lab}","",NBINS,-TMath::Pi(),TMath::Pi());
+    if(histosFamilies & hLab) {
+      HS->SetObservableDeps(K::oLab);
+      HS->DefineHist1D("pLab","p_{lab}","GeV",NBINS,0,10);
+      HS->DefineHist1D("pTlab","p_{T}^{lab}","GeV",NBINS,1e-2,3,true);
+      HS->DefineHist1D("etaLab","#eta_{lab}","",NBINS,-5,5);
+      HS->DefineHist1D("phiLab","#phi_{lab}","",NBINS,-TMath::Pi(),TMath::Pi());
+    };
     // -- hadron kinematics
-    HS->DefineHist1D("z","z","",NBINS,0,1);
-    HS->DefineHist1D("pT","p_{T}","GeV",NBINS,1e-2,3,true);
-    HS->DefineHist1D("qT","q_{T}","GeV",NBINS,1e-2,5,true);
-    HS->DefineHist1D("qTq","q_{T}/Q","",NBINS,1e-2,3,true);
-    HS->DefineHist1D("mX","m_{X}","GeV",NBINS,0,40);
-    HS->DefineHist1D("phiH","#phi_{h}","",NBINS,-TMath::Pi(),TMath::Pi());
-    HS->DefineHist1D("phiS","#phi_{S}","",NBINS,-TMath::Pi(),TMath::Pi());
-    HS->DefineHist2D("phiHvsPhiS","#phi_{S}","#phi_{h}","","",
-        25,-TMath::Pi(),TMath::Pi(),
-        25,-TMath::Pi(),TMath::Pi());
-    HS->DefineHist1D("phiSivers","#phi_{Sivers}","",NBINS,-TMath::Pi(),TMath::Pi());
-    HS->DefineHist1D("phiCollins","#phi_{Collins}","",NBINS,-TMath::Pi(),TMath::Pi());
-    HS->DefineHist2D("etaVsP","p","#eta","GeV","",
-        NBINS,0.1,100,
-        NBINS,-4,4,
-        true,false
-        );
-    Double_t etabinsCoarse[] = {-4.0,-1.0,1.0,4.0};
-    Double_t pbinsCoarse[] = {0.1,1,10,100};
-    HS->DefineHist2D("etaVsPcoarse","p","#eta","GeV","",
-        3, pbinsCoarse,
-        3, etabinsCoarse,
-        true,false
-        );
+    if(histosFamilies & hHadron) {
+      HS->SetObservableDeps(K::oZ);
+      HS->DefineHist1D("z","z","",NBINS,0,1);
+      HS->SetObservableDeps(K::oPT);
+      HS->DefineHist1D("pT","p_{T}","GeV",NBINS,1e-2,3,true);
+      HS->SetObservableDeps(K::oPT|K::oZ);
+      HS->DefineHist1D("qT","q_{T}","GeV",NBINS,1e-2,5,true);
+      HS->DefineHist1D("qTq","q_{T}/Q","",NBINS,1e-2,3,true);
+      HS->SetObservableDeps(K::oMX);
+      HS->DefineHist1D("mX","m_{X}","GeV",NBINS,0,40);
+      HS->SetObservableDeps(K::oPhiH);
+      HS->DefineHist1D("phiH","#phi_{h}","",NBINS,-TMath::Pi(),TMath::Pi());
+      HS->SetObservableDeps(K::oPhiS);
+      HS->DefineHist1D("phiS","#phi_{S}","",NBINS,-TMath::Pi(),TMath::Pi());
+      HS->SetObservableDeps(K::oPhiH|K::oPhiS);
+      HS->DefineHist2D("phiHvsPhiS","#phi_{S}","#phi_{h}","","",
+          25,-TMath::Pi(),TMath::Pi(),
+          25,-TMath::Pi(),TMath::Pi());
+      HS->DefineHist1D("phiSivers","#phi_{Sivers}","",NBINS,-TMath::Pi(),TMath::Pi());
+      HS->DefineHist1D("phiCollins","#phi_{Collins}","",NBINS,-TMath::Pi(),TMath::Pi());
+    };
+    if(histosFamilies & hLab) {
+      HS->SetObservableDeps(K::oLab);
+      HS->DefineHist2D("etaVsP","p","#eta","GeV","",
+          NBINS,0.1,100,
+          NBINS,-4,4,
+          true,false
+          );
+      Double_t etabinsCoarse[] = {-4.0,-1.0,1.0,4.0};
+      Double_t pbinsCoarse[] = {0.1,1,10,100};
+      HS->DefineHist2D("etaVsPcoarse","p","#eta","GeV","",
+          3, pbinsCoarse,
+          3, etabinsCoarse,
+          true,false
+          );
+    };
     // -- depolarization
-    HS->DefineHist2D("epsilonVsQ2", "Q^{2}", "#epsilon", "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 1.5, true, false);
-    HS->DefineHist2D("depolAvsQ2",  "Q^{2}", "A",        "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
-    HS->DefineHist2D("depolBAvsQ2", "Q^{2}", "B/A",      "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
-    HS->DefineHist2D("depolCAvsQ2", "Q^{2}", "C/A",      "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
-    HS->DefineHist2D("depolVAvsQ2", "Q^{2}", "V/A",      "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
-    HS->DefineHist2D("depolWAvsQ2", "Q^{2}", "W/A",      "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
+    if(histosFamilies & hDepol) {
+      HS->SetObservableDeps(K::oDepol);
+      HS->DefineHist2D("epsilonVsQ2", "Q^{2}", "#epsilon", "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 1.5, true, false);
+      HS->DefineHist2D("depolAvsQ2",  "Q^{2}", "A",        "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
+      HS->DefineHist2D("depolBAvsQ2", "Q^{2}", "B/A",      "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
+      HS->DefineHist2D("depolCAvsQ2", "Q^{2}", "C/A",      "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
+      HS->DefineHist2D("depolVAvsQ2", "Q^{2}", "V/A",      "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
+      HS->DefineHist2D("depolWAvsQ2", "Q^{2}", "W/A",      "GeV^{2}", "", NBINS, 1, 3000, NBINS, 0, 2.5, true, false);
+    };
      
     // -- single-hadron cross sections
-    //HS->DefineHist1D("Q_xsec","Q","GeV",10,0.5,10.5,false,true); // linear
-    HS->DefineHist1D("Q_xsec","Q","GeV",10,1.0,10.0,true,true); // log
-    HS->Hist("Q_xsec")->SetMinimum(1e-10);
-    // -- jet kinematics
-    HS->DefineHist1D("pT_jet","jet p_{T}","GeV", NBINS, 1e-2, 50);
-    HS->DefineHist1D("mT_jet","jet m_{T}","GeV", NBINS, 1e-2, 20);
-    HS->DefineHist1D("z_jet","jet z","", NBINS,0, 1);
-    HS->DefineHist1D("eta_jet","jet #eta_{lab}","", NBINS,-5,5);
-    HS->DefineHist1D("qT_jet","jet q_{T}", "GeV", NBINS, 0, 10.0);
-    HS->DefineHist1D("jperp","j_{#perp}","GeV", NBINS, 0, 3.0);
-    HS->DefineHist1D("qTQ_jet","jet q_{T}/Q","", NBINS, 0, 3.0);
+    if(histosFamilies & hXsec) {
+      HS->SetObservableDeps(K::oDIS);
+      //HS->DefineHist1D("Q_xsec","Q","GeV",10,0.5,10.5,false,true); // linear
+      HS->DefineHist1D("Q_xsec","Q","GeV",10,1.0,10.0,true,true); // log
+      HS->Hist("Q_xsec")->SetMinimum(1e-10);
+    };
+    // -- transverse single-spin asymmetries, by the method of moments
+    HS->SetObservableDeps(K::oSpin|K::oDepol|K::oPhiH|K::oPhiS);
+    if((histosFamilies & hAsym) && useAsymMoments)
+      HS->DefineAsymMoments("spin","A_{UT} moments",{"sivers","collins","pretzelosity"});
+    // -- jet kinematics (calculated separately, in `Kinematics::CalculateJetKinematics`)
+    if(histosFamilies & hJet) {
+      HS->SetObservableDeps(K::oDIS);
+      HS->DefineHist1D("pT_jet","jet p_{T}","GeV", NBINS, 1e-2, 50);
+      HS->DefineHist1D("mT_jet","jet m_{T}","GeV", NBINS, 1e-2, 20);
+      HS->DefineHist1D("z_jet","jet z","", NBINS,0, 1);
+      HS->DefineHist1D("eta_jet","jet #eta_{lab}","", NBINS,-5,5);
+      HS->DefineHist1D("qT_jet","jet q_{T}", "GeV", NBINS, 0, 10.0);
+      HS->DefineHist1D("jperp","j_{#perp}","GeV", NBINS, 0, 3.0);
+      HS->DefineHist1D("qTQ_jet","jet q_{T}/Q","", NBINS, 0, 3.0);
+    };
     // -- resolutions
-    HS->DefineHist1D("x_Res","x-x_{true}","", NBINS, -0.5, 0.5);
-    HS->DefineHist1D("y_Res","y-y_{true}","", NBINS, -0.2, 0.2);
-    HS->DefineHist1D("Q2_Res","Q2-Q2_{true}","GeV^{2}", NBINS, -20, 20);
-    HS->DefineHist1D("W_Res","W-W_{true}","GeV", NBINS, -20, 20);
-    HS->DefineHist1D("Nu_Res","#nu-#nu_{true}","GeV", NBINS, -100, 100);
-    HS->DefineHist1D("phiH_Res","#phi_{h}-#phi_{h}^{true}","", NBINS, -TMath::Pi(), TMath::Pi());
-    HS->DefineHist1D("phiS_Res","#phi_{S}-#phi_{S}^{true}","", NBINS, -TMath::Pi(), TMath::Pi());
-    HS->DefineHist1D("pT_Res","pT-pT^{true}","GeV", NBINS, -1.5, 1.5);
-    HS->DefineHist1D("z_Res","z-z^{true}","", NBINS, -1.5, 1.5);
-    HS->DefineHist1D("mX_Res","mX-mX^{true}","GeV", NBINS, -10, 10);
-    HS->DefineHist1D("xF_Res","xF-xF^{true}","", NBINS, -1.5, 1.5);
-    HS->DefineHist2D("Q2vsXtrue","x","Q^{2}","","GeV^{2}",
-        20,1e-4,1,
-        10,1,1e4,
-        true,true
-        );
-    HS->DefineHist2D("Q2vsXpurity","x","Q^{2}","","GeV^{2}",
-        20,1e-4,1,
-        10,1,1e4,
-        true,true
-        );
-    HS->DefineHist2D("Q2vsX_zres","x","Q^{2}","","GeV^{2}",
-        20,1e-4,1,
-        10,1,1e4,
-        true,true
-        );
-    HS->DefineHist2D("Q2vsX_pTres","x","Q^{2}","","GeV^{2}",
-        20,1e-4,1,
-        10,1,1e4,
-        true,true
-        );
-    HS->DefineHist2D("Q2vsX_phiHres","x","Q^{2}","","GeV^{2}",
-        20,1e-4,1,
-        10,1,1e4,
-        true,true
-        );
+    if(histosFamilies & hRes) {
+      if(useMoments) {
+        HS->SetObservableDeps(
+            K::oPhiH|K::oPhiS|K::oPT|K::oZ|K::oMX|K::oXF,
+            K::oPhiH|K::oPhiS|K::oPT|K::oZ|K::oMX|K::oXF
+            );
+        Moments *resMom = HS->DefineMoments("resolution","reconstructed - true",
+            {"x","y","Q2","W","Nu","phiH","phiS","pT","z","mX","xF"});
+        resMom->AddCovariance("x","Q2");
+        resMom->AddCovariance("z","pT");
+        HS->SetObservableDeps(K::oLab|K::oPhiH|K::oPhiS|K::oPT|K::oZ|K::oMX|K::oXF);
+        HS->DefineMoments("kinematics","averages",
+            {"x","Q2","y","W","z","pT","qT","mX","xF","phiH","phiS","etaLab","pLab"});
+      } else {
+        HS->SetObservableDeps(K::oDIS,K::oDIS);
+        HS->DefineHist1D("x_Res","x-x_{true}","", NBINS, -0.5, 0.5);
+        HS->DefineHist1D("y_Res","y-y_{true}","", NBINS, -0.2, 0.2);
+        HS->DefineHist1D("Q2_Res","Q2-Q2_{true}","GeV^{2}", NBINS, -20, 20);
+        HS->DefineHist1D("W_Res","W-W_{true}","GeV", NBINS, -20, 20);
+        HS->DefineHist1D("Nu_Res","#nu-#nu_{true}","GeV", NBINS, -100, 100);
+        HS->SetObservableDeps(K::oPhiH,K::oPhiH);
+        HS->DefineHist1D("phiH_Res","#phi_{h}-#phi_{h}^{true}","", NBINS, -TMath::Pi(), TMath::Pi());
+        HS->SetObservableDeps(K::oPhiS,K::oPhiS);
+        HS->DefineHist1D("phiS_Res","#phi_{S}-#phi_{S}^{true}","", NBINS, -TMath::Pi(), TMath::Pi());
+        HS->SetObservableDeps(K::oPT,K::oPT);
+        HS->DefineHist1D("pT_Res","pT-pT^{true}","GeV", NBINS, -1.5, 1.5);
+        HS->SetObservableDeps(K::oZ,K::oZ);
+        HS->DefineHist1D("z_Res","z-z^{true}","", NBINS, -1.5, 1.5);
+        HS->SetObservableDeps(K::oMX,K::oMX);
+        HS->DefineHist1D("mX_Res","mX-mX^{true}","GeV", NBINS, -10, 10);
+        HS->SetObservableDeps(K::oXF,K::oXF);
+        HS->DefineHist1D("xF_Res","xF-xF^{true}","", NBINS, -1.5, 1.5);
+      };
+      HS->SetObservableDeps(K::oDIS,K::oDIS);
+      HS->DefineHist2D("Q2vsXtrue","x","Q^{2}","","GeV^{2}",
+          20,1e-4,1,
+          10,1,1e4,
+          true,true
+          );
+      HS->DefineHist2D("Q2vsXpurity","x","Q^{2}","","GeV^{2}",
+          20,1e-4,1,
+          10,1,1e4,
+          true,true
+          );
+      HS->SetObservableDeps(K::oZ,K::oZ);
+      HS->DefineHist2D("Q2vsX_zres","x","Q^{2}","","GeV^{2}",
+          20,1e-4,1,
+          10,1,1e4,
+          true,true
+          );
+      HS->SetObservableDeps(K::oPT,K::oPT);
+      HS->DefineHist2D("Q2vsX_pTres","x","Q^{2}","","GeV^{2}",
+          20,1e-4,1,
+          10,1,1e4,
+          true,true
+          );
+      HS->SetObservableDeps(K::oPhiH,K::oPhiH);
+      HS->DefineHist2D("Q2vsX_phiHres","x","Q^{2}","","GeV^{2}",
+          20,1e-4,1,
+          10,1,1e4,
+          true,true
+          );
+    };
     // -- reconstructed vs. generated
-    HS->DefineHist2D("x_RvG","generated x","reconstructed x","","",
-        NBINS,1e-3,1,
-        NBINS,1e-3,1,
-        true,true
-        );
-    HS->DefineHist2D("phiH_RvG","generated #phi_{h}","reconstructed #phi_{h}","","",
-        NBINS,-TMath::Pi(),TMath::Pi(),
-        NBINS,-TMath::Pi(),TMath::Pi()
-        );
-    HS->DefineHist2D("phiS_RvG","generated #phi_{S}","reconstructed #phi_{S}","","",
-        NBINS,-TMath::Pi(),TMath::Pi(),
-        NBINS,-TMath::Pi(),TMath::Pi()
-        );
-  });
-  HD->ExecuteAndClearOps();
+    if(histosFamilies & hRvG) {
+      HS->SetObservableDeps(K::oDIS,K::oDIS);
+      HS->DefineHist2D("x_RvG","generated x","reconstructed x","","",
+          NBINS,1e-3,1,
+          NBINS,1e-3,1,
+          true,true
+          );
+      HS->SetObservableDeps(K::oPhiH,K::oPhiH);
+      HS->DefineHist2D("phiH_RvG","generated #phi_{h}","reconstructed #phi_{h}","","",
+          NBINS,-TMath::Pi(),TMath::Pi(),
+          NBINS,-TMath::Pi(),TMath::Pi()
+          );
+      HS->SetObservableDeps(K::oPhiS,K::oPhiS);
+      HS->DefineHist2D("phiS_RvG","generated #phi_{S}","reconstructed #phi_{S}","","",
+          NBINS,-TMath::Pi(),TMath::Pi(),
+          NBINS,-TMath::Pi(),TMath::Pi()
+          );
+    };
+  };
+};
 
 
-  // initialize total weights
-  wTrackTotal = 0.;
-  wJetTotal = 0.;
+// memory estimation
+//------------------------------------
+// estimate memory needed for all histograms, by booking them once in a prototype
+// `Histos` and multiplying by the number of leaf Histos; returns bytes
+Long64_t Analysis::EstimateMemory(Bool_t verbose) {
+  const Double_t MB = 1024.*1024.;
+  Histos *proto = new Histos("histos__memoryEstimate");
+  DefineHistos()(proto);
+  Long64_t nHistos = HD->GetNumHistos();
+  if(HD->GetMaxResident()>0) nHistos = TMath::Min(nHistos,HD->GetMaxResident()); // working set
+  Long64_t perHistos = proto->GetBytes(true); // weighted fills allocate Sumw2
+  if(verbose) {
+    cout << sep << endl;
+    cout << "Histogram memory estimate (NBINS=" << NBINS << ", NBINS_FULL=" << NBINS_FULL << "):" << endl;
+    cout << "  number of Histos (leaf bins): " << HD->GetNumHistos() << endl;
+    if(HD->GetMaxResident()>0) cout << "  number of resident Histos:    " << nHistos << endl;
+    cout << "  " << std::left << std::setw(20) << "family"
+         << std::right << std::setw(14) << "kB per Histos"
+         << std::setw(14) << "total MB" << endl;
+    for(TString varName : proto->VarNameList) {
+      Long64_t bytes = proto->HistBytes(varName,true);
+      cout << "  " << std::left << std::setw(20) << varName
+           << std::right << std::setw(14) << Form("%.2f",bytes/1024.)
+           << std::setw(14) << Form("%.2f",bytes*nHistos/MB) << endl;
+    };
+    cout << "  TOTAL: " << Form("%.2f",perHistos/1024.) << " kB per Histos, "
+         << Form("%.2f",perHistos*nHistos/MB) << " MB for all resident Histos" << endl;
+  };
+  if(verbose && writeSparse)
+    cout << "  THnSparse (writeSparse): at least " << Form("%.2f",EstimateSparseMemory()/MB)
+         << " MB (not included in the total)" << endl;
+  proto->DeleteHists();
+  delete proto;
+  return perHistos*nHistos;
+};
+
+// check the memory estimate against `memoryBudget`; if over budget, either
+// reduce the number of bins (if `memoryDowngrade`) or return false to abort
+Bool_t Analysis::CheckMemoryBudget() {
+  const Double_t MB = 1024.*1024.;
+  Double_t estimate = EstimateMemory(true)/MB;
+  if(memoryBudget<=0 || estimate<=memoryBudget) {
+    if(memoryBudget>0) cout << "  within memory budget of " << memoryBudget << " MB" << endl;
+    cout << sep << endl;
+    return true;
+  };
+  cerr << "WARNING: estimated histogram memory " << estimate
+       << " MB exceeds memoryBudget " << memoryBudget << " MB" << endl;
+  if(memoryDowngrade) {
+    while(estimate>memoryBudget && (NBINS>NBINS_MIN || NBINS_FULL>NBINS_FULL_MIN)) {
+      NBINS = TMath::Max(NBINS/2,NBINS_MIN);
+      NBINS_FULL = TMath::Max(NBINS_FULL/2,NBINS_FULL_MIN);
+      estimate = EstimateMemory(false)/MB;
+      cerr << "  downgrade to NBINS=" << NBINS << ", NBINS_FULL=" << NBINS_FULL
+           << ": estimate " << estimate << " MB" << endl;
+    };
+    if(estimate<=memoryBudget) {
+      EstimateMemory(true);
+      cout << sep << endl;
+      return true;
+    };
+  };
+  cerr << "ERROR: histograms do not fit in memoryBudget; reduce the number of bins, "
+       << "or increase `memoryBudget`" << endl;
+  return false;
+};
+
+// print measured memory usage of the histograms, and of this process
+void Analysis::PrintMemoryUsage() {
+  const Double_t MB = 1024.*1024.;
+  Long64_t bytes = 0;
+  Long64_t nHistos = 0;
+  HD->Payload([&bytes,&nHistos](Histos *H){ bytes += H->GetBytes(); nHistos++; });
+  HD->ExecuteAndClearOps();
+  ProcInfo_t procInfo;
+  gSystem->GetProcInfo(&procInfo);
+  cout << "Memory usage:" << endl;
+  cout << "  histograms:   " << Form("%.2f",bytes/MB) << " MB in " << nHistos << " Histos";
+  if(nHistos>0) cout << " (" << Form("%.2f",bytes/1024./nHistos) << " kB per Histos)";
+  cout << endl;
+  cout << "  resident:     " << Form("%.2f",procInfo.fMemResident/1024.) << " MB" << endl;
+  cout << "  resident max: " << Form("%.2f",procInfo.fMemResidentPeak/1024.) << " MB" << endl;
+  cout << sep << endl;
 };
 
 void Analysis::CalculateEventQ2Weights() {
@@ -437,29 +1766,62 @@ Int_t Analysis::GetEventQ2Idx(Double_t Q2, Int_t guess) {
 //-----------------------------------
 void Analysis::Finish() {
 
+  // write the zone map being built
+  if(useZoneMap) {
+    ZoneMapClose();
+    cout << "zone map: skipped " << zoneMapSkipped << " entries" << endl;
+  };
+
+  // input read statistics
+  FinishRead();
+
+  // event selection list: write the recorded list, or use the total weights of the
+  // run which recorded it, since the entries which were not read have weights too
+  WriteEntryList();
+  if(entryListIn) {
+    SetWeightTotals(&entryListWeightTotals);
+  };
+
+  // event cache: keep the events recorded by this run
+  if(eventCacheMB>0) FinishEventCache();
+
   // reset HD, to clean up after the event loop
   HD->ActivateAllNodes();
   HD->ClearOps();
 
-  // calculate integrated luminosity
-  Double_t lumi = wTrackTotal/xsecTot; // [nb^-1]
-  cout << "Integrated Luminosity:       " << lumi << "/nb" << endl;
+  // calculate integrated luminosity, of each recon method
+  std::map<TString,Double_t> lumi;
+  for(TString reconMethodN : reconMethods) {
+    lumi[reconMethodN] = wTrackTotal[reconMethodN]/xsecTot; // [nb^-1]
+    cout << "Integrated Luminosity:       " << lumi[reconMethodN] << "/nb";
+    if(reconMethods.size()>1) cout << " (" << reconMethodN << ")";
+    cout << endl;
+  };
   cout << sep << endl;
 
+  // print memory usage
+  PrintMemoryUsage();
+
   // calculate cross sections, and print yields
   HD->Initial([this](){ cout << sep << endl << "Histogram Entries:" << endl; });
   HD->Final([this](){ cout << sep << endl; });
-  HD->Payload([&lumi](Histos *H){
-    cout << H->GetSetTitle() << " ::: "
-         << H->Hist("Q2vsX")->GetEntries()
-         << endl;
-    // calculate cross sections
-    H->Hist("Q_xsec")->Scale(1./lumi); // TODO: generalize (`if (name contains "xsec") ...`)
+  HD->Payload([this,&lumi](Histos *H, NodePath *P){
+    if(histosFamilies & hDIS)
+      cout << H->GetSetTitle() << " ::: "
+           << H->Hist("Q2vsX")->GetEntries()
+           << endl;
+    // calculate cross sections, with the luminosity of the recon method of `H`
+    if(histosFamilies & hXsec) {
+      TString reconMethodN = reconMethods.size()>1 ? P->GetBinNode("recon")->GetCut()->GetCutID() : reconMethods.front();
+      H->Hist("Q_xsec")->Scale(1./lumi[reconMethodN]); // TODO: generalize (`if (name contains "xsec") ...`)
+    };
     // divide resolution plots by true counts per x-Q2 bin
-    H->Hist("Q2vsXpurity")->Divide(H->Hist("Q2vsXtrue"));
-    H->Hist("Q2vsX_zres")->Divide(H->Hist("Q2vsXtrue"));
-    H->Hist("Q2vsX_pTres")->Divide(H->Hist("Q2vsXtrue"));
-    H->Hist("Q2vsX_phiHres")->Divide(H->Hist("Q2vsXtrue"));        
+    if(histosFamilies & hRes) {
+      H->Hist("Q2vsXpurity")->Divide(H->Hist("Q2vsXtrue"));
+      H->Hist("Q2vsX_zres")->Divide(H->Hist("Q2vsXtrue"));
+      H->Hist("Q2vsX_pTres")->Divide(H->Hist("Q2vsXtrue"));
+      H->Hist("Q2vsX_phiHres")->Divide(H->Hist("Q2vsXtrue"));        
+    };
   });
   HD->ExecuteAndClearOps();
 
@@ -468,10 +1830,24 @@ void Analysis::Finish() {
   cout << "writing ROOT file..." << endl;
   outFile->cd();
   if(writeSimpleTree) ST->WriteTree();
-  HD->Payload([this](Histos *H){ H->WriteHists(outFile); }); HD->ExecuteAndClearOps();
-  HD->Payload([this](Histos *H){ H->Write(); }); HD->ExecuteAndClearOps();
-  std::vector<Double_t> vec_wTrackTotal { wTrackTotal };
-  std::vector<Double_t> vec_wJetTotal { wJetTotal };
+  if(writeConsolidated) {
+    HistosStore store;
+    Bool_t storeOK = true;
+    store.BeginWrite(outFile);
+    HD->Payload([&store,&storeOK](Histos *H){ storeOK &= store.Append(H); }); HD->ExecuteAndClearOps();
+    store.EndWrite();
+    if(!storeOK) cerr << "ERROR: some Histos were not written to the consolidated store" << endl;
+  } else {
+    HD->Payload([this](Histos *H){ H->WriteHists(outFile); }); HD->ExecuteAndClearOps();
+    HD->Payload([this](Histos *H){ H->Write(); }); HD->ExecuteAndClearOps();
+  };
+  for(auto const &kv : sparseMap) kv.second->Write();
+  // - total weights, of each recon method, in the order of `reconMethods`
+  std::vector<Double_t> vec_wTrackTotal, vec_wJetTotal;
+  for(TString reconMethodN : reconMethods) {
+    vec_wTrackTotal.push_back(wTrackTotal[reconMethodN]);
+    vec_wJetTotal.push_back(wJetTotal[reconMethodN]);
+  };
   outFile->WriteObject(&Q2xsecsTot, "XsTotal");
   outFile->WriteObject(&vec_wTrackTotal, "WeightTotal");
   outFile->WriteObject(&vec_wJetTotal, "WeightJetTotal");
@@ -481,9 +1857,25 @@ void Analysis::Finish() {
     if(kv.second->GetNumBins()>0) kv.second->Write("binset__"+kv.first);
   };
 
+  // remove scratch file, if the working set was used
+  HD->CloseWorkingSet();
+
+  // close skim output
+  if(skimOut) {
+    skimOut->SetQ2Table(Q2mins, Q2xsecsTot, Q2entries);
+    delete skimOut;
+    skimOut = nullptr;
+  };
+
   // close output
   outFile->Close();
   cout << outfileName << " written." << endl;
+
+  // the analysis is complete, so its checkpoint is no longer needed
+  if((checkpointEvents>0 || checkpointSeconds>0 || resume) && !gSystem->AccessPathName(checkpointFileName)) {
+    gSystem->Unlink(checkpointFileName);
+    cout << "checkpoint " << checkpointFileName << " removed" << endl;
+  };
 };
 
 
@@ -534,13 +1926,26 @@ void Analysis::AddFinalState(TString finalStateN) {
 };
 
 
+// add a reconstruction method
+//------------------------------------
+void Analysis::AddReconMethod(TString reconMethod_) {
+  if(reconMethodToTitle.find(reconMethod_)==reconMethodToTitle.end()) {
+    cerr << "ERROR: recon method "
+         << reconMethod_ << " not available... skipping..." << endl;
+    return;
+  };
+  if(std::find(reconMethods.begin(),reconMethods.end(),reconMethod_)!=reconMethods.end()) return;
+  reconMethods.push_back(reconMethod_);
+};
+
+
 // access HistosDAG
 //------------------------------------
 HistosDAG *Analysis::GetHistosDAG() { return HD; };
 
 
 // lambda to check which bins an observable is in, during DAG breadth
-// traversal; it requires `finalStateID`, `valueMap`, and will
+// traversal; it requires `finalStateID`, `reconMethod`, `valueMap`, and will
 // activate/deactivate bin nodes accoding to values in `valuMap`
 //--------------------------------------------------------------------
 std::function<void(Node*)> Analysis::CheckBin() {
@@ -549,6 +1954,7 @@ std::function<void(Node*)> Analysis::CheckBin() {
       Bool_t active;
       Double_t val;
       if(N->GetVarName()=="finalState") active = (N->GetCut()->GetCutID()==finalStateID);
+      else if(N->GetVarName()=="recon") active = (N->GetCut()->GetCutID()==reconMethod);
       else {
         try {
           // get value associated to this variable, and check cut
@@ -612,78 +2018,135 @@ void Analysis::FillHistosTracks() {
   valueMap.insert(std::pair<TString,Double_t>( "phiS", kin->phiS ));
   valueMap.insert(std::pair<TString,Double_t>( "tSpin", (Double_t)kin->tSpin ));
   valueMap.insert(std::pair<TString,Double_t>( "lSpin", (Double_t)kin->lSpin ));
+  /* user-defined */
+  for(auto kv : userObservables)
+    valueMap.insert(std::pair<TString,Double_t>( kv.first, kv.second(*kin) ));
 
   // check bins
   // - activates HistosDAG bin nodes which contain this track
   HD->TraverseBreadth(CheckBin());
   // - set `activeEvent` if there is at least one multidimensional bin to fill
   activeEvent = false;
-  HD->Payload(CheckActive());
+  HD->LeafOp(CheckActive()); // (not `Payload`, which would page in spilled Histos)
   HD->ExecuteOps(true);
   if(!activeEvent) return;
+  RecordSelectedEvent();
+
+  // fill fine-grained THnSparse, for tracks in at least one bin
+  if(writeSparse) FillSparse();
   
   // fill histograms, for activated bins only
   HD->Payload([this](Histos *H){
     // Full phase space.
-    H->Hist4("full_xsec")->Fill(kin->x,kin->Q2,kin->pT,kin->z,wTrack);
+    if(histosFamilies & hFull) {
+      H->Hist4("full_xsec")->Fill(kin->x,kin->Q2,kin->pT,kin->z,wTrack);
+    };
     // DIS kinematics
-    dynamic_cast<TH2*>(H->Hist("Q2vsX"))->Fill(kin->x,kin->Q2,wTrack);
-    H->Hist("Q")->Fill(TMath::Sqrt(kin->Q2),wTrack);
-    H->Hist("x")->Fill(kin->x,wTrack);
-    H->Hist("W")->Fill(kin->W,wTrack);
-    H->Hist("y")->Fill(kin->y,wTrack);
+    if(histosFamilies & hDIS) {
+      dynamic_cast<TH2*>(H->Hist("Q2vsX"))->Fill(kin->x,kin->Q2,wTrack);
+      H->Hist("Q")->Fill(TMath::Sqrt(kin->Q2),wTrack);
+      H->Hist("x")->Fill(kin->x,wTrack);
+      H->Hist("W")->Fill(kin->W,wTrack);
+      H->Hist("y")->Fill(kin->y,wTrack);
+    };
     // hadron 4-momentum
-    H->Hist("pLab")->Fill(kin->pLab,wTrack);
-    H->Hist("pTlab")->Fill(kin->pTlab,wTrack);
-    H->Hist("etaLab")->Fill(kin->etaLab,wTrack);
-    H->Hist("phiLab")->Fill(kin->phiLab,wTrack);
+    if(histosFamilies & hLab) {
+      H->Hist("pLab")->Fill(kin->pLab,wTrack);
+      H->Hist("pTlab")->Fill(kin->pTlab,wTrack);
+      H->Hist("etaLab")->Fill(kin->etaLab,wTrack);
+      H->Hist("phiLab")->Fill(kin->phiLab,wTrack);
+    };
     // hadron kinematics
-    H->Hist("z")->Fill(kin->z,wTrack);
-    H->Hist("pT")->Fill(kin->pT,wTrack);
-    H->Hist("qT")->Fill(kin->qT,wTrack);
-    if(kin->Q2!=0) H->Hist("qTq")->Fill(kin->qT/TMath::Sqrt(kin->Q2),wTrack);
-    H->Hist("mX")->Fill(kin->mX,wTrack);
-    H->Hist("phiH")->Fill(kin->phiH,wTrack);
-    H->Hist("phiS")->Fill(kin->phiS,wTrack);
-    dynamic_cast<TH2*>(H->Hist("phiHvsPhiS"))->Fill(kin->phiS,kin->phiH,wTrack);
-    H->Hist("phiSivers")->Fill(Kinematics::AdjAngle(kin->phiH - kin->phiS),wTrack);
-    H->Hist("phiCollins")->Fill(Kinematics::AdjAngle(kin->phiH + kin->phiS),wTrack);
-    dynamic_cast<TH2*>(H->Hist("etaVsP"))->Fill(kin->pLab,kin->etaLab,wTrack); // TODO: lab-frame p, or some other frame?
-    dynamic_cast<TH2*>(H->Hist("etaVsPcoarse"))->Fill(kin->pLab,kin->etaLab,wTrack); 
+    if(histosFamilies & hHadron) {
+      H->Hist("z")->Fill(kin->z,wTrack);
+      H->Hist("pT")->Fill(kin->pT,wTrack);
+      H->Hist("qT")->Fill(kin->qT,wTrack);
+      if(kin->Q2!=0) H->Hist("qTq")->Fill(kin->qT/TMath::Sqrt(kin->Q2),wTrack);
+      H->Hist("mX")->Fill(kin->mX,wTrack);
+      H->Hist("phiH")->Fill(kin->phiH,wTrack);
+      H->Hist("phiS")->Fill(kin->phiS,wTrack);
+      dynamic_cast<TH2*>(H->Hist("phiHvsPhiS"))->Fill(kin->phiS,kin->phiH,wTrack);
+      H->Hist("phiSivers")->Fill(Kinematics::AdjAngle(kin->phiH - kin->phiS),wTrack);
+      H->Hist("phiCollins")->Fill(Kinematics::AdjAngle(kin->phiH + kin->phiS),wTrack);
+    };
+    if(histosFamilies & hLab) {
+      dynamic_cast<TH2*>(H->Hist("etaVsP"))->Fill(kin->pLab,kin->etaLab,wTrack); // TODO: lab-frame p, or some other frame?
+      dynamic_cast<TH2*>(H->Hist("etaVsPcoarse"))->Fill(kin->pLab,kin->etaLab,wTrack); 
+    };
     // depolarization
-    dynamic_cast<TH2*>(H->Hist("epsilonVsQ2"))->Fill(kin->Q2,kin->epsilon,wTrack); 
-    dynamic_cast<TH2*>(H->Hist("depolAvsQ2"))->Fill(kin->Q2,kin->depolA,wTrack); 
-    dynamic_cast<TH2*>(H->Hist("depolBAvsQ2"))->Fill(kin->Q2,kin->depolP1,wTrack); 
-    dynamic_cast<TH2*>(H->Hist("depolCAvsQ2"))->Fill(kin->Q2,kin->depolP2,wTrack); 
-    dynamic_cast<TH2*>(H->Hist("depolVAvsQ2"))->Fill(kin->Q2,kin->depolP3,wTrack); 
-    dynamic_cast<TH2*>(H->Hist("depolWAvsQ2"))->Fill(kin->Q2,kin->depolP4,wTrack); 
+    if(histosFamilies & hDepol) {
+      dynamic_cast<TH2*>(H->Hist("epsilonVsQ2"))->Fill(kin->Q2,kin->epsilon,wTrack); 
+      dynamic_cast<TH2*>(H->Hist("depolAvsQ2"))->Fill(kin->Q2,kin->depolA,wTrack); 
+      dynamic_cast<TH2*>(H->Hist("depolBAvsQ2"))->Fill(kin->Q2,kin->depolP1,wTrack); 
+      dynamic_cast<TH2*>(H->Hist("depolCAvsQ2"))->Fill(kin->Q2,kin->depolP2,wTrack); 
+      dynamic_cast<TH2*>(H->Hist("depolVAvsQ2"))->Fill(kin->Q2,kin->depolP3,wTrack); 
+      dynamic_cast<TH2*>(H->Hist("depolWAvsQ2"))->Fill(kin->Q2,kin->depolP4,wTrack); 
+    };
     // cross sections (divide by lumi after all events processed)
-    H->Hist("Q_xsec")->Fill(TMath::Sqrt(kin->Q2),wTrack);
+    if(histosFamilies & hXsec) {
+      H->Hist("Q_xsec")->Fill(TMath::Sqrt(kin->Q2),wTrack);
+    };
+    // transverse single-spin asymmetries
+    if((histosFamilies & hAsym) && useAsymMoments) {
+      Double_t mods[] = {
+        TMath::Sin(kin->phiH - kin->phiS),
+        TMath::Sin(kin->phiH + kin->phiS),
+        TMath::Sin(3*kin->phiH - kin->phiS)
+      };
+      Double_t depols[] = { 1.0, kin->depolP1, kin->depolP1 };
+      H->Asym("spin")->Fill(kin->tSpin,kin->polT,mods,depols,wTrack);
+    };
     // resolutions
-    H->Hist("x_Res")->Fill( kin->x - kinTrue->x, wTrack );
-    H->Hist("y_Res")->Fill( kin->y - kinTrue->y, wTrack );
-    H->Hist("Q2_Res")->Fill( kin->Q2 - kinTrue->Q2, wTrack );
-    H->Hist("W_Res")->Fill( kin->W - kinTrue->W, wTrack );
-    H->Hist("Nu_Res")->Fill( kin->Nu - kinTrue->Nu, wTrack );
-    H->Hist("phiH_Res")->Fill( Kinematics::AdjAngle(kin->phiH - kinTrue->phiH), wTrack );
-    H->Hist("phiS_Res")->Fill( Kinematics::AdjAngle(kin->phiS - kinTrue->phiS), wTrack );
-    H->Hist("pT_Res")->Fill( kin->pT - kinTrue->pT, wTrack );
-    H->Hist("z_Res")->Fill( kin->z - kinTrue->z, wTrack );
-    H->Hist("mX_Res")->Fill( kin->mX - kinTrue->mX, wTrack );
-    H->Hist("xF_Res")->Fill( kin->xF - kinTrue->xF, wTrack );
-    dynamic_cast<TH2*>(H->Hist("Q2vsXtrue"))->Fill(kinTrue->x,kinTrue->Q2,wTrack);
-    if(kinTrue->z!=0) dynamic_cast<TH2*>(H->Hist("Q2vsX_zres"))->Fill(
-      kinTrue->x,kinTrue->Q2,wTrack*( fabs(kinTrue->z - kin->z)/(kinTrue->z) ) );
-    if(kinTrue->pT!=0) dynamic_cast<TH2*>(H->Hist("Q2vsX_pTres"))->Fill(
-      kinTrue->x,kinTrue->Q2,wTrack*( fabs(kinTrue->pT - kin->pT)/(kinTrue->pT) ) );
-    dynamic_cast<TH2*>(H->Hist("Q2vsX_phiHres"))->Fill(kinTrue->x,kinTrue->Q2,wTrack*( fabs(Kinematics::AdjAngle(kinTrue->phiH - kin->phiH) ) ) );
+    if(histosFamilies & hRes) {
+      if(useMoments) {
+        Double_t res[] = {
+          kin->x - kinTrue->x,
+          kin->y - kinTrue->y,
+          kin->Q2 - kinTrue->Q2,
+          kin->W - kinTrue->W,
+          kin->Nu - kinTrue->Nu,
+          Kinematics::AdjAngle(kin->phiH - kinTrue->phiH),
+          Kinematics::AdjAngle(kin->phiS - kinTrue->phiS),
+          kin->pT - kinTrue->pT,
+          kin->z - kinTrue->z,
+          kin->mX - kinTrue->mX,
+          kin->xF - kinTrue->xF
+        };
+        H->Mom("resolution")->Fill(res,wTrack);
+        Double_t ave[] = {
+          kin->x, kin->Q2, kin->y, kin->W, kin->z, kin->pT, kin->qT,
+          kin->mX, kin->xF, kin->phiH, kin->phiS, kin->etaLab, kin->pLab
+        };
+        H->Mom("kinematics")->Fill(ave,wTrack);
+      } else {
+        H->Hist("x_Res")->Fill( kin->x - kinTrue->x, wTrack );
+        H->Hist("y_Res")->Fill( kin->y - kinTrue->y, wTrack );
+        H->Hist("Q2_Res")->Fill( kin->Q2 - kinTrue->Q2, wTrack );
+        H->Hist("W_Res")->Fill( kin->W - kinTrue->W, wTrack );
+        H->Hist("Nu_Res")->Fill( kin->Nu - kinTrue->Nu, wTrack );
+        H->Hist("phiH_Res")->Fill( Kinematics::AdjAngle(kin->phiH - kinTrue->phiH), wTrack );
+        H->Hist("phiS_Res")->Fill( Kinematics::AdjAngle(kin->phiS - kinTrue->phiS), wTrack );
+        H->Hist("pT_Res")->Fill( kin->pT - kinTrue->pT, wTrack );
+        H->Hist("z_Res")->Fill( kin->z - kinTrue->z, wTrack );
+        H->Hist("mX_Res")->Fill( kin->mX - kinTrue->mX, wTrack );
+        H->Hist("xF_Res")->Fill( kin->xF - kinTrue->xF, wTrack );
+      };
+      dynamic_cast<TH2*>(H->Hist("Q2vsXtrue"))->Fill(kinTrue->x,kinTrue->Q2,wTrack);
+      if(kinTrue->z!=0) dynamic_cast<TH2*>(H->Hist("Q2vsX_zres"))->Fill(
+        kinTrue->x,kinTrue->Q2,wTrack*( fabs(kinTrue->z - kin->z)/(kinTrue->z) ) );
+      if(kinTrue->pT!=0) dynamic_cast<TH2*>(H->Hist("Q2vsX_pTres"))->Fill(
+        kinTrue->x,kinTrue->Q2,wTrack*( fabs(kinTrue->pT - kin->pT)/(kinTrue->pT) ) );
+      dynamic_cast<TH2*>(H->Hist("Q2vsX_phiHres"))->Fill(kinTrue->x,kinTrue->Q2,wTrack*( fabs(Kinematics::AdjAngle(kinTrue->phiH - kin->phiH) ) ) );
     
-    if( (H->Hist("Q2vsXtrue"))->FindBin(kinTrue->x,kinTrue->Q2) == (H->Hist("Q2vsXtrue"))->FindBin(kin->x,kin->Q2) ) dynamic_cast<TH2*>(H->Hist("Q2vsXpurity"))->Fill(kin->x,kin->Q2,wTrack);
+      if( (H->Hist("Q2vsXtrue"))->FindBin(kinTrue->x,kinTrue->Q2) == (H->Hist("Q2vsXtrue"))->FindBin(kin->x,kin->Q2) ) dynamic_cast<TH2*>(H->Hist("Q2vsXpurity"))->Fill(kin->x,kin->Q2,wTrack);
+    };
     
     // -- reconstructed vs. generated
-    dynamic_cast<TH2*>(H->Hist("x_RvG"))->Fill(kinTrue->x,kin->x,wTrack);
-    dynamic_cast<TH2*>(H->Hist("phiH_RvG"))->Fill(kinTrue->phiH,kin->phiH,wTrack);
-    dynamic_cast<TH2*>(H->Hist("phiS_RvG"))->Fill(kinTrue->phiS,kin->phiS,wTrack);
+    if(histosFamilies & hRvG) {
+      dynamic_cast<TH2*>(H->Hist("x_RvG"))->Fill(kinTrue->x,kin->x,wTrack);
+      dynamic_cast<TH2*>(H->Hist("phiH_RvG"))->Fill(kinTrue->phiH,kin->phiH,wTrack);
+      dynamic_cast<TH2*>(H->Hist("phiS_RvG"))->Fill(kinTrue->phiS,kin->phiS,wTrack);
+    };
   });
   // execute the payload
   // - save time and don't call `ClearOps` (next loop will overwrite lambda)
@@ -710,22 +2173,27 @@ void Analysis::FillHistosJets() {
   HD->TraverseBreadth(CheckBin());
   // - set `activeEvent` if there is at least one multidimensional bin to fill
   activeEvent = false;
-  HD->Payload(CheckActive());
+  HD->LeafOp(CheckActive()); // (not `Payload`, which would page in spilled Histos)
   HD->ExecuteOps(true);
   if(!activeEvent) return;
+  RecordSelectedEvent();
 
   // fill histograms, for activated bins only
   HD->Payload([this](Histos *H){
-    dynamic_cast<TH2*>(H->Hist("Q2vsX"))->Fill(kin->x,kin->Q2,wJet);
+    if(histosFamilies & hDIS) {
+      dynamic_cast<TH2*>(H->Hist("Q2vsX"))->Fill(kin->x,kin->Q2,wJet);
+    };
     // jet kinematics
-    H->Hist("pT_jet")->Fill(kin->pTjet,wJet);
-    H->Hist("mT_jet")->Fill(jet.mt(),wJet);
-    H->Hist("z_jet")->Fill(kin->zjet,wJet);
-    H->Hist("eta_jet")->Fill(jet.eta(),wJet);
-    H->Hist("qT_jet")->Fill(kin->qTjet,wJet);
-    if(kin->Q2!=0) H->Hist("qTQ_jet")->Fill(kin->qTjet/sqrt(kin->Q2),wJet);
-    for(int j = 0; j < kin->jperp.size(); j++) {
-      H->Hist("jperp")->Fill(kin->jperp[j],wJet);
+    if(histosFamilies & hJet) {
+      H->Hist("pT_jet")->Fill(kin->pTjet,wJet);
+      H->Hist("mT_jet")->Fill(jet.mt(),wJet);
+      H->Hist("z_jet")->Fill(kin->zjet,wJet);
+      H->Hist("eta_jet")->Fill(jet.eta(),wJet);
+      H->Hist("qT_jet")->Fill(kin->qTjet,wJet);
+      if(kin->Q2!=0) H->Hist("qTQ_jet")->Fill(kin->qTjet/sqrt(kin->Q2),wJet);
+      for(int j = 0; j < kin->jperp.size(); j++) {
+        H->Hist("jperp")->Fill(kin->jperp[j],wJet);
+      };
     };
   });
   // execute the payload
@@ -740,5 +2208,8 @@ void Analysis::FillHistosJets() {
 
 // destructor
 Analysis::~Analysis() {
+  if (inputMetadata) delete inputMetadata;
+  if (skimOut) delete skimOut;
+  if (readPrefetchPrev>=0) gEnv->SetValue("TFile.AsyncPrefetching",readPrefetchPrev); // (if `Finish` was not reached)
 };
 
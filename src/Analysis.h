@@ -17,6 +17,9 @@
 #include "TClonesArray.h"
 #include "TFile.h"
 #include "TRegexp.h"
+#include "THnSparse.h"
+#include "TEntryList.h"
+#include "TStopwatch.h"
 
 // sidis-eic
 #include "Histos.h"
@@ -26,12 +29,31 @@
 #include "BinSet.h"
 #include "SimpleTree.h"
 #include "Weights.h"
+#include "InputMetadata.h"
+#include "SkimFile.h"
+#include "ZoneMap.h"
 
 // delphes (TODO: does fastjet need this?)
 //#include "classes/DelphesClasses.h"
 //#include "external/ExRootAnalysis/ExRootTreeReader.h"
 
 
+// an axis of the fine-grained THnSparse (see `Analysis::SetSparseAxis`)
+struct SparseAxis {
+  TString varName; // bin scheme name, e.g., "x"
+  Int_t nBins;
+  Double_t lower, upper;
+  Bool_t logScale;
+};
+
+// read statistics of one input file of the chain (see `Analysis::MonitorRead`)
+struct InputReadStats {
+  TString fileName;
+  Long64_t readCalls;
+  Long64_t bytesRead;
+  Double_t realTime; // time spent in this file, reading and analyzing its events [s]
+};
+
 
 class Analysis : public TNamed
 {
@@ -46,8 +68,11 @@ class Analysis : public TNamed
     ~Analysis();
 
     // number of bins for histograms
-    const Int_t NBINS = 50;
-    const Int_t NBINS_FULL = 10;
+    // - these may be reduced by `Prepare()`, if `memoryDowngrade` is enabled
+    Int_t NBINS = 50;
+    Int_t NBINS_FULL = 10;
+    const Int_t NBINS_MIN = 5; // lower limits for downgrading
+    const Int_t NBINS_FULL_MIN = 2;
 
     // bin schemes
     void AddBinScheme(TString varname); // add a new bin scheme
@@ -59,16 +84,155 @@ class Analysis : public TNamed
 
     // common settings
     Bool_t writeSimpleTree; // if true, write SimpleTree (not binned)
+    TString simpleTreeColumns; /* SimpleTree columns to write, separated by spaces or commas, e.g.,
+                                * "X QSq Z PhPerp PhiH PhiS Spin_idx"; default "" writes all of them
+                                */
+    Int_t simpleTreeFormat; // SimpleTree output: `SimpleTree::fTTree` (default) or `SimpleTree::fRNTuple`
+    Int_t simpleTreeLayout; /* SimpleTree rows: `SimpleTree::lTrack` (default), one row per hadron, or
+                             * `SimpleTree::lEvent`, one row per event with arrays of hadron columns
+                             */
+    Bool_t simpleTreeAsync; /* if true, write SimpleTree from a background thread, so the event loop
+                             * does not wait for compression (see `SimpleTree::StartAsync`); the tree
+                             * is then written to its own file, `out/<outfilePrefix>.tree.root`
+                             */
     Long64_t maxEvents; /* default=0, which runs all events;
                          * if > 0, run a maximum number of `maxEvents` events (useful for quick tests)
                          */
+    Long64_t checkpointEvents; /* default=0; if > 0, write a checkpoint every `checkpointEvents` events:
+                                * the histograms, total weights, counters, and the position in the input,
+                                * in `out/<prefix>.checkpoint.root`, which is removed when the analysis finishes
+                                */
+    Double_t checkpointSeconds; // default=0; if > 0, also write a checkpoint every `checkpointSeconds` seconds
+    Bool_t resume; /* if true, and the checkpoint exists, continue from it, with the same output as a run
+                    * which was not interrupted; the configuration must be the same as that of the run
+                    * which wrote it; not possible with `writeSimpleTree`, which is not checkpointed, and
+                    * a resumed run does not record `entryListFile` or the event cache
+                    */
     Bool_t useBreitJets; // if true, use Breit jets, if using finalState `jets` (requires centauro)
+    Double_t jetRadius; // jet radius, for anti-kt and Breit (Centauro) jets; default 0.8
+    Int_t jetStrategy; // `fastjet::Strategy` for anti-kt jets; default `fastjet::Best`
+    TString jetCacheFile; /* if set, cache clustered jets in this file, and read them from it on later
+                           * runs with the same input files and jet settings (see `JetCache`)
+                           */
+    TString skimFile; /* if set, also write a skim of the input to this file (see `SkimFile`), which
+                       * `AnalysisSkim` can read much faster than the original input; it has the
+                       * electron, beams, HFS sums, and the hadrons of the active track final states
+                       * (not jets), for the recon methods of this analysis
+                       */
+    TString inputMetadataCache; /* cache of input file metadata (number of entries, etc.), so that
+                                 * `Prepare()` does not need to open input files whose number of
+                                 * entries is not in the config file; default
+                                 * "out/input_metadata.cache"; set to "" to disable (see `InputMetadata`)
+                                 */
+    Int_t inputThreads; // number of threads for opening input files in `Prepare()`; default=0, for all cores
+    Double_t readCacheMB; /* size of the `TTreeCache` of the input chain [MB], default=50; it holds only the
+                           * branches the reader uses, and has no learning phase; if 0, the ROOT default is used
+                           */
+    Bool_t readPrefetch; /* if true, prefetch the `TTreeCache` asynchronously; default false; this sets the
+                          * global `TFile.AsyncPrefetching`, which is restored by `Finish` (or the destructor)
+                          */
+    Bool_t useZoneMap; /* if true, skip clusters of input entries which have no events in the range of
+                        * the `x`, `q2`, `y`, and `w` bins, using a zone map of each input file (see
+                        * `ZoneMap`); a zone map is built by the first run over a file, and used by later
+                        * runs; ignored if `writeSparse` or `skimFile` is set, which need all events
+                        */
+    TString zoneMapDir; // directory of the zone map files; default "", which writes them next to the input files
+    TString entryListFile; /* if set, the event selection list: the first run records the input entries
+                            * which fill at least one histogram in this file, and later runs read only
+                            * those entries, if the cut configuration (bins, recon methods, final states,
+                            * beams, inputs, weights, `maxEvents`) is the same; otherwise it is recorded
+                            * again; ignored if `writeSparse` or `skimFile` is set, which need all events
+                            */
+    Double_t eventCacheMB; /* default=0, which disables it; if > 0, the in-memory event cache, for repeated
+                            * `Execute()` calls in one session: the events of a run are kept in memory (as
+                            * a skim, see `SkimFile`), up to this size [MB], and later runs on the same
+                            * inputs, beams, and `maxEvents`, with some of the same recon methods and track
+                            * final states, replay them instead of reading the input; not used with jets,
+                            * `writeSparse`, `skimFile`, `useZoneMap`, or `entryListFile`
+                            */
+    Double_t memoryBudget; /* default=0, which means no limit; if > 0, maximum memory [MB] allowed
+                            * for histograms; the memory is estimated before booking, in `Prepare()`
+                            */
+    Bool_t memoryDowngrade; /* if true and the histograms exceed `memoryBudget`, reduce `NBINS` and
+                             * `NBINS_FULL` until they fit; if false, the analysis aborts instead
+                             */
+    Long64_t maxResidentHistos; /* default=0, which keeps all Histos in memory; if > 0, keep at most
+                                 * this many Histos in memory, and spill the least-recently-filled
+                                 * ones to a scratch file in `scratchDir` (see `HistosDAG::SetWorkingSet`)
+                                 */
+    TString scratchDir; // directory for the scratch file; default is the system temporary directory
+    Bool_t useMoments; /* if true, book moments accumulators (see `Moments`) instead of the resolution
+                        * histograms (`*_Res`): "resolution" holds the mean and RMS of reconstructed
+                        * minus true values, and "kinematics" holds the averages of kinematic variables
+                        */
+    Bool_t useAsymMoments; /* if true, book an asymmetry accumulator "spin" (see `AsymMoments`), which
+                            * collects the spin-dependent moments of the Sivers, Collins, and pretzelosity
+                            * modulations; `PostProcessor::DumpAsymmetries` then prints the asymmetries
+                            */
+    Bool_t writeSparse; /* if true, also fill one fine-grained THnSparse per track final state and
+                         * recon method, named `sparse__<finalState>__<reconMethod>`, over the main
+                         * kinematic variables (see `SetSparseAxis`), with the tracks which fill at
+                         * least one bin; `PostProcessor::BuildFromSparse` can then make Histos for
+                         * any binning within the bins, without rerunning the event loop
+                         */
+    // set the binning of THnSparse axis `varName` (a bin scheme name, e.g., "x"), or add it
+    // if it is not an axis yet; `nBins<=0` removes the axis; the default axes are x, q2, y,
+    // z, pt, phiH, phiS, and eta (see the constructor); the memory of a THnSparse grows with
+    // the number of filled cells, which is at most the number of fills
+    void SetSparseAxis(TString varName, Int_t nBins, Double_t lower, Double_t upper, Bool_t logScale=false);
+    Bool_t writeConsolidated; /* if true, write histograms in consolidated form, with one TTree per
+                               * histogram family instead of one directory per Histos (see `HistosStore`);
+                               * recommended for large numbers of bins
+                               */
+    Bool_t calculateAllObservables; /* if false (default), `Prepare()` finds which observable groups
+                                     * are needed by the bins, histograms, `SimpleTree`, sparses, and
+                                     * weights, and `Kinematics` calculates only those (see
+                                     * `Kinematics::calcMask`); set to true to calculate all of them,
+                                     * e.g., if you call `Kinematics::InjectFakeAsymmetry`
+                                     */
+    // histogram families booked by `DefineHistos`, in each bin; `DisableHistos(hRes|hRvG)`, for
+    // example, does not book the resolution and reconstructed vs. generated histograms, and the
+    // observables only they need are then not calculated (see `PrepareObservables`)
+    enum histosFamily_enum {
+      hFull   = 1<<0, // full_xsec
+      hDIS    = 1<<1, // Q2vsX, Q, x, y, W
+      hLab    = 1<<2, // hadron lab-frame momentum: pLab, pTlab, etaLab, phiLab, etaVsP
+      hHadron = 1<<3, // z, pT, qT, mX, phiH, phiS, and their combinations
+      hDepol  = 1<<4, // depolarization factors vs. Q2
+      hXsec   = 1<<5, // Q_xsec
+      hAsym   = 1<<6, // spin asymmetry moments (if `useAsymMoments`)
+      hJet    = 1<<7, // jet kinematics
+      hRes    = 1<<8, // resolutions (or `Moments`, if `useMoments`), purity
+      hRvG    = 1<<9, // reconstructed vs. generated
+      hAll    = (1<<10)-1
+    };
+    UInt_t histosFamilies; // booked families; default `hAll`
+    void DisableHistos(UInt_t families) { histosFamilies &= ~families; }; // call before `Prepare`
+    Bool_t batchHadronKinematics; /* if true, the Delphes, DD4hep, and EE readers calculate the hadron kinematics of
+                                   * each event and recon method in one batch (see
+                                   * `Kinematics::CalculateHadronKinematicsBatch`), which the compiler can
+                                   * vectorize if built with `OPTIMIZE=1`; default false
+                                   */
+    // add a user-defined observable `name`, calculated by `func` from the reconstructed
+    // kinematics, which needs observable groups `deps` (see `Kinematics::obsGroup_enum`);
+    // it may then be used as a bin scheme, e.g., `AddBinScheme(name)`
+    void AddObservable(
+        TString name, TString title,
+        std::function<Double_t(const Kinematics&)> func,
+        UInt_t deps=Kinematics::oAll
+        );
+
     // set kinematics reconstruction method; see constructor for available methods
-    void SetReconMethod(TString reconMethod_) { reconMethod=reconMethod_; }; 
+    void SetReconMethod(TString reconMethod_) { reconMethods.clear(); AddReconMethod(reconMethod_); };
+    // add another kinematics reconstruction method; if more than one is added, all of them
+    // are evaluated in a single event loop (sharing the input and hadronic final state), and
+    // the HistosDAG gets a "recon" layer, with one bin per method
+    void AddReconMethod(TString reconMethod_);
 
     // add files to the TChain; this is called by `Prepare()`, but you can use these public
     // methods to add more files if you want
-    // add single file `fileName` with given Q2 range and xs.
+    // add single file `fileName` with given Q2 range and xs; files with `entries<=0` are
+    // counted (or found in `inputMetadataCache`)
     bool AddFile(std::vector<std::string> fileNames, std::vector<Long64_t> entries, Double_t xs, Double_t Q2min);
 
     // access HistosDAG
@@ -86,22 +250,120 @@ class Analysis : public TNamed
     // run the analysis
     virtual void Execute() = 0;
 
+    // free the in-memory event cache (see `eventCacheMB`), which is shared by all analyses
+    static void ClearEventCache();
+
   protected:
 
+    // read the config file `infileName`, and add its input files (`AddFile`); called by
+    // `Prepare()`; override to take the input files from elsewhere
+    virtual Bool_t LoadInputs();
+
     // prepare to perform the analysis; in derived classes, define a method `Execute()`, which
     // will run the event loop; the first line of `Execute()` should call `Analysis::Prepare()`,
-    // which set up common things like output files, `HistosDAG`, etc.
-    void Prepare();
+    // which set up common things like output files, `HistosDAG`, etc.; if it returns false,
+    // the analysis cannot proceed and `Execute()` should return
+    Bool_t Prepare();
 
     // finish the analysis; call `Analysis::Finish()` at the end of derived `Execute()` methods
     void Finish();
 
+    // histogram definitions, booked in every Histos object
+    std::function<void(Histos*)> DefineHistos();
+
+    // memory accounting: estimate histogram memory (bytes) before booking, check it
+    // against `memoryBudget`, and print measured usage
+    Long64_t EstimateMemory(Bool_t verbose=true);
+    Bool_t CheckMemoryBudget();
+    void PrintMemoryUsage();
+
+    // fine-grained THnSparse, for rebinning at post-processing time
+    THnSparseD *BookSparse(TString finalStateN, TString reconMethodN);
+    void FillSparse(); // fills the values of the axes from `valueMap`
+    Long64_t EstimateSparseMemory(); // bytes, lower bound, printed by `EstimateMemory`
+
+    // observable groups needed by the bins, histograms, etc.; sets `calcMask` of
+    // `kin` and `kinTrue`; called by `Prepare()`, after booking histograms
+    void PrepareObservables();
+    UInt_t ObservableDeps(TString obsName); // also checks user-defined observables
+
+    // key the random draws of `kin` and `kinTrue` by the current event of `chain`,
+    // so they are reproducible in any event order (see `Kinematics::SetRandomKey`);
+    // call for each event, after reading it
+    void SetRandomKey(TChain *chain);
+
+    // checkpoints: call `ResumeCheckpoint` before the event loop, with the addresses of the
+    // event loop counters, and start the loop at the position it returns (or return if it
+    // is negative, for errors); at the start of each iteration, call `Checkpoint` with the
+    // position of the event which is about to be processed
+    Long64_t ResumeCheckpoint(std::vector<Long64_t*> counters);
+    void Checkpoint(Long64_t entry);
+    void WriteCheckpoint(Long64_t entry);
+    TString CheckpointKey(); // configuration, which must match to resume
+
+    // input reading: call `PrepareRead` once the readers of `chain` are set up, with the
+    // names of the branches they use, and call `MonitorRead` for each event, after reading
+    // it; `Finish` calls `FinishRead`, which prints the read statistics of each input file
+    void PrepareRead(TChain *chain, std::vector<TString> branches);
+    void MonitorRead(TChain *chain);
+    void EndReadStats(); // end the statistics of the current file
+    void FinishRead();
+
+    // event selection list (if `entryListFile` is set); `UseEntryList` applies the list
+    // read to `chain`, and returns it, or nullptr if the list is being recorded instead;
+    // the event loop should then read only its entries (e.g., `TTreeReader(chain,list)`)
+    void PrepareEntryList();
+    TString EntryListKey(); // cut configuration, which must match to read the list
+    TEntryList *UseEntryList(TChain *chain);
+    void RecordSelectedEvent(); // add the current event to the list being recorded
+    void WriteEntryList();
+
+    // skim output (if `skimFile` is set) and the event cache being recorded; in the event
+    // loop, call `WriteSkimEvent` once per event, after the HFS is calculated, then
+    // `WriteSkimHadron` for each hadron of the active final states, both before the recon
+    // method loop, so that the skim does not depend on the recon methods
+    Bool_t WritingSkim() { return skimOut!=nullptr || eventCacheOut!=nullptr; };
+    void WriteSkimEvent(TChain *chain);
+    void WriteSkimHadron();
+    // run the recon method and hadron loops on event `e` of skim `skimIn`
+    void ReplayEvent(SkimFile *skimIn, Long64_t e);
+
+    // in-memory event cache (if `eventCacheMB>0`); call `ReplayEventCache` after `Prepare`:
+    // if the cache has the events of this analysis, it runs the event loop on them, and
+    // `Finish`, and returns true; otherwise the events are recorded by `WriteSkimEvent`
+    void PrepareEventCache();
+    TString EventCacheKey(); // inputs of the cached events, which must match to use them
+    Bool_t ReplayEventCache();
+    void FinishEventCache();
+
+    // zone map (if `useZoneMap`); in the event loop, call `ZoneMapNextEntry` before reading
+    // entry `e` of `chain`, and read the entry it returns instead (`numEntries` if there
+    // are no more to read); call `ZoneMapFill` in the recon method loop, after the DIS
+    // kinematics are calculated
+    void PrepareZoneMap();
+    Long64_t ZoneMapNextEntry(TChain *chain, Long64_t e, Long64_t numEntries);
+    void ZoneMapFill();
+    void ZoneMapFillWeight(Bool_t jet); // call after adding `wTrack` to `wTrackTotal`, or `wJet` to `wJetTotal`
+    Int_t ZoneMapWeightBin(Int_t reconIdx, Int_t q2Idx) { return reconIdx*Q2mins.size() + q2Idx; }; // bin of the zone map weights
+    void ZoneMapOpen(TChain *chain, Long64_t e); // zone map of the file of entry `e`
+    void ZoneMapClose(); // write the zone map being built
+    Bool_t ZoneMapSkip(Int_t c); // true if no event of cluster `c` can be in the bins
+
+    // batch hadron kinematics (if `batchHadronKinematics`); in the event loop, call
+    // `ClearHadronBatch`, then `AddToHadronBatch` for each hadron of the track loop, in the
+    // same order, after setting the `vecHadron`s, and `CalculateHadronBatch` after the DIS
+    // kinematics of each recon method; the track loop then calls `CalculateHadronKinematics`
+    void ClearHadronBatch();
+    void AddToHadronBatch();
+    void CalculateHadronBatch();
+    void CalculateHadronKinematics(); // reconstructed and generated, for the next hadron
+
     // FillHistos methods: fill histograms
     void FillHistosTracks();
     void FillHistosJets();
 
     // lambda to check which bins an observable is in, during DAG breadth
-    // traversal; it requires `finalStateID`, `valueMap`, and will
+    // traversal; it requires `finalStateID`, `reconMethod`, `valueMap`, and will
     // activate/deactivate bin nodes accoding to values in `valuMap`
     std::function<void(Node*)> CheckBin();
     // payload operator to check if the event will appear in at least one bin
@@ -114,7 +376,10 @@ class Analysis : public TNamed
     HistosDAG *HD;
     Weights const* weight;
     Weights const* weightJet;
-    Double_t wTrackTotal, wJetTotal;
+    // total weights of each recon method, since each method accepts different events
+    std::map<TString,Double_t> wTrackTotal, wJetTotal;
+    std::vector<Double_t> GetWeightTotals(); // `wTrackTotal`, then `wJetTotal`, in the order of `reconMethods`
+    Bool_t SetWeightTotals(std::vector<Double_t> const *totals); // from `GetWeightTotals`; false if `totals` does not match
     Double_t xsecTot;
     Long64_t entriesTot;
     const TString sep = "--------------------------------------------";
@@ -129,12 +394,54 @@ class Analysis : public TNamed
     std::vector<Double_t> Q2mins;
     std::vector<Long64_t> Q2entries;
     std::vector<Double_t> Q2weights;
+    SkimFile *skimOut; //! skim output, if `skimFile` is set
+    SkimFile *eventCacheOut; //! event cache being recorded, if any
+    TString checkpointFileName;
+    std::vector<Long64_t*> checkpointCounters; //! event loop counters, from `ResumeCheckpoint`
+    Long64_t checkpointCount; // events since the last checkpoint
+    Long64_t checkpointTime; // time of the last checkpoint [ms]
+    Int_t readTreeNum; // tree number of the current file of the chain, or -1
+    TString readFileName; // current file of the chain
+    Long64_t readCalls; // `TFile::GetReadCalls()` of the current file, so far
+    Long64_t readBytes; // `TFile::GetBytesRead()` of the current file, so far
+    Int_t readPrefetchPrev; // `TFile.AsyncPrefetching` before `PrepareRead` set it, or -1
+    TStopwatch readTimer; //!
+    std::vector<InputReadStats> readStats; //!
+    HadronSoA hadronBatch, hadronBatchTrue; //! hadrons of the current event (see `AddToHadronBatch`)
+    HadronObsSoA hadronObs, hadronObsTrue; //! their kinematics, for the current recon method
+    std::size_t hadronBatchIdx; // next hadron of the batch
+    Bool_t eventCacheHit; // true if this analysis replays the event cache
+    UInt_t eventFileID; // input file ID and
+    Long64_t eventEntry; // entry of the current event, from `SetRandomKey`
+    InputMetadata *inputMetadata; //! input file metadata, with the cache `inputMetadataCache`
+    ZoneMap *zoneMap; //! zone map of the current input file
+    Bool_t zoneMapBuild; // true if `zoneMap` is being built, false if it is used to skip clusters
+    std::map<TString,std::pair<Double_t,Double_t>> zoneMapEnvelope; // bin scheme -> range of all its bins
+    std::vector<TString> zoneMapQuantities; // quantities of the zone maps, for each recon method
+    std::vector<Long64_t> zoneMapFileEntries; // entries of each input file, in chain order
+    Long64_t zoneMapTreeStart, zoneMapTreeEnd; // chain entries of the current input file
+    Long64_t zoneMapCheckEnd; // entries before this are in a cluster which was already checked
+    Long64_t zoneMapLastEntry; // last entry counted by `zoneMap`
+    Long64_t zoneMapSkipped; // number of entries skipped
+    TEntryList *entryListIn; //! event selection list read, if valid
+    TEntryList *entryListOut; //! event selection list being recorded
+    TString entryListKey; // cut configuration of this analysis (see `EntryListKey`)
+    std::vector<Double_t> entryListWeightTotals; // `GetWeightTotals()` of the run which recorded `entryListIn`
+    TTree *eventTree; //! tree of the current event, from `SetRandomKey`
+    Bool_t eventRecorded; // true if the current event was added to `entryListOut`
+    // count the entries of files with `entries<=0`, in parallel, using `inputMetadata`
+    Bool_t CountEntries(std::vector<std::string> fileNames, std::vector<Long64_t> &entries);
     TString infileName,outfileName,outfilePrefix;
     TFile *outFile;
     Double_t eleBeamEn = 5; // GeV
     Double_t ionBeamEn = 41; // GeV
     Double_t crossingAngle = 0; // mrad
-    TString reconMethod;
+    TString reconMethod; // current reconstruction method, in the event loop
+    std::vector<TString> reconMethods; // list of reconstruction methods
+    Int_t ReconMethodIdx(); // index of `reconMethod` in `reconMethods`
+    // true for the first method of `reconMethods`, the only one the SimpleTree is filled
+    // for, since it has no recon method branch; events this method rejects are not in it
+    Bool_t IsMainReconMethod() { return reconMethod==reconMethods.front(); };
 
     // event loop objects
     Long64_t ENT;
@@ -154,6 +461,14 @@ class Analysis : public TNamed
     std::map<TString, TString> finalStateToTitle;
     std::map<int, TString> PIDtoFinalState;
     std::set<TString> activeFinalStates;
+    std::map<TString,THnSparseD*> sparseMap; // `<finalState>__<reconMethod>` -> THnSparse
+    std::vector<SparseAxis> sparseAxes; //! THnSparse axes, from `SetSparseAxis`
+    std::vector<Double_t> sparseValues; //! `FillSparse` buffer
+    // user-defined observables, from `AddObservable`
+    std::map<TString,std::function<Double_t(const Kinematics&)>> userObservables; //!
+    std::map<TString,UInt_t> userObservableDeps;
+    // observable groups of the booked histograms (see `Histos::SetObservableDeps`)
+    UInt_t histosDepsRec, histosDepsTrue; //!
 
   ClassDef(Analysis,1);
 };
@@ -33,7 +33,8 @@ class Particles
     int pid;
     int charge;
     int mcID;
-    TLorentzVector vecPart;
+    int index; // index of the track in the input event (for the random draws)
+    Vec4 vecPart; // (lightweight 4-vector; converts to `TLorentzVector`)
 };
 
 class AnalysisDD4hep : public Analysis
@@ -33,7 +33,11 @@ AnalysisDelphes::AnalysisDelphes(
 void AnalysisDelphes::Execute() {
 
   // setup
-  Prepare();
+  if(!Prepare()) return;
+
+  // replay the in-memory event cache instead of reading the input, if it has the
+  // events of this analysis (see `eventCacheMB`)
+  if(ReplayEventCache()) return;
 
   // read delphes tree
   TChain *chain = new TChain("Delphes");
@@ -49,6 +53,11 @@ void AnalysisDelphes::Execute() {
   // calculate cross section
   if(maxEvents>0) ENT = maxEvents; // limiter
 
+  // read only the entries of the event selection list, if one is read (it was recorded
+  // with the same `maxEvents`)
+  TEntryList *entryList = UseEntryList(chain);
+  if(entryList) ENT = entryList->GetN();
+
   // branch iterators
   TObjArrayIter itTrack(tr->UseBranch("Track"));
   TObjArrayIter itElectron(tr->UseBranch("Electron"));
@@ -64,14 +73,44 @@ void AnalysisDelphes::Execute() {
   TObjArrayIter itdualRICHagTrack(tr->UseBranch("dualRICHagTrack"));
   TObjArrayIter itdualRICHcfTrack(tr->UseBranch("dualRICHcfTrack"));
 
+  // cache the used branches
+  PrepareRead(chain, {
+      "Track", "Electron", "Particle", "EFlowTrack", "EFlowPhoton", "EFlowNeutralHadron",
+      "pfRICHTrack", "barrelDIRC_epidTrack", "barrelDIRC_hpidTrack", "BTOF_eTrack", "BTOF_hTrack",
+      "dualRICHagTrack", "dualRICHcfTrack" });
+
   CalculateEventQ2Weights();
 
+  // smeared PID of each track of the event
+  std::vector<Int_t> trackPID;
+
+  // jets are only clustered if the jet final state is used
+  Bool_t useJets = activeFinalStates.find("jet")!=activeFinalStates.end();
+  TStopwatch loopTimer, jetTimer;
+  loopTimer.Reset();
+  jetTimer.Reset();
+  // jet cache, keyed by the input file UUID and the tree entry in that file
+  JetCache *jetCache = (useJets && jetCacheFile!="") ? new JetCache(jetCacheFile) : nullptr;
+  TString jetCacheInputID = "";
+  Int_t jetCacheTreeNum = -1;
+  Long64_t jetCacheEntry = 0;
+
   // event loop =========================================================
   cout << "begin event loop..." << endl;
-  int errorCount=0;
-  for(Long64_t e=0; e<ENT; e++) {
+  loopTimer.Start(false);
+  Long64_t errorCount=0;
+  // resume from the checkpoint (if `resume`)
+  Long64_t resumeEntry = ResumeCheckpoint({&errorCount});
+  if(resumeEntry<0) return;
+  for(Long64_t e=resumeEntry; e<ENT; e++) {
+    Checkpoint(e); // (if `checkpointEvents` or `checkpointSeconds` is set)
     if(e>0&&e%10000==0) cout << (Double_t)e/ENT*100 << "%" << endl;
-    tr->ReadEntry(e);
+    // skip clusters which have no events in the bins (if `useZoneMap`)
+    e = ZoneMapNextEntry(chain,e,ENT);
+    if(e>=ENT) break;
+    tr->ReadEntry(entryList ? chain->GetEntryNumber(e) : e);
+    SetRandomKey(chain);
+    MonitorRead(chain);
 
     // electron loop
     // - finds max-momentum electron
@@ -157,122 +196,200 @@ void AnalysisDelphes::Execute() {
         );
     kinTrue->GetTrueHFS(itParticle);
 
-    // calculate DIS kinematics
-    if(!(kin->CalculateDIS(reconMethod))) continue; // reconstructed
-    if(!(kinTrue->CalculateDIS(reconMethod))) continue; // generated (truth)
+    // identify this event for the jet cache
+    if(jetCache) {
+      if(chain->GetTreeNumber()!=jetCacheTreeNum) {
+        jetCacheTreeNum = chain->GetTreeNumber();
+        jetCacheInputID = chain->GetFile()->GetUUID().AsString();
+      };
+      jetCacheEntry = chain->GetTree()->GetReadEntry();
+    };
 
-    // get vector of jets
-    // TODO: should this have an option for clustering method?
-    kin->GetJets(itEFlowTrack, itEFlowPhoton, itEFlowNeutralHadron, itParticle);
-   
-    // track loop - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+    // get vector of jets (independent of the recon method); Breit frame jets
+    // depend on the recon method, and are found in the jet loop instead
+    if(useJets && !useBreitJets) {
+      jetTimer.Start(false);
+      TString jetParams = jetCache ? kin->JetParams() : "";
+      if(!(jetCache && jetCache->ReadJets(jetCacheInputID, jetParams, jetCacheEntry, kin->jetsRec, kin->jetsTrue, kin->quarkpT))) {
+        kin->GetJets(itEFlowTrack, itEFlowPhoton, itEFlowNeutralHadron, itParticle);
+        if(jetCache) jetCache->WriteJets(jetCacheInputID, jetParams, jetCacheEntry, kin->jetsRec, kin->jetsTrue, kin->quarkpT);
+      };
+      jetTimer.Stop();
+    };
+
+    // write the event to the skim (if `skimFile` is set)
+    WriteSkimEvent(chain);
+
+    // find the track PIDs, which do not depend on the recon method, and write the hadrons
+    // of the track loop to the skim (if `skimFile` is set) and add them to the batch (if
+    // `batchHadronKinematics`)
+    // - `pid = trk->PID` is currently not smeared, so it would just be the truth-level PID
+    trackPID.clear();
+    ClearHadronBatch();
     itTrack.Reset();
     while(Track *trk = (Track*) itTrack()) {
-      //cout << e << " " << trk->PID << endl;
-
-      // final state cut
-      // - check PID, to see if it's a final state we're interested in for
-      //   histograms; if not, proceed to next track
-      // pid = trk->PID; //NOTE: trk->PID is currently not smeared so it just returns the truth-level PID
-      pid = kin->getTrackPID( // get smeared PID
-          trk,
-          itpfRICHTrack,
-          itDIRCepidTrack, itDIRChpidTrack,
-          itBTOFepidTrack, itBTOFhpidTrack,
-          itdualRICHagTrack, itdualRICHcfTrack
-          );
-      auto kv = PIDtoFinalState.find(pid);
-      if(kv!=PIDtoFinalState.end()) finalStateID = kv->second; else continue;
-      if(activeFinalStates.find(finalStateID)==activeFinalStates.end()) continue;
-
-      // get parent particle, to check if pion is from vector meson
-      GenParticle *trkParticle = (GenParticle*)trk->Particle.GetObject();
-      TObjArray *brParticle = (TObjArray*)itParticle.GetCollection();
-      GenParticle *parentParticle = (GenParticle*)brParticle->At(trkParticle->M1);
-      int parentPID = (parentParticle->PID); // TODO: this is not used yet...
-
-      // calculate hadron kinematics
-      kin->hadPID = pid;
-      kin->vecHadron.SetPtEtaPhiM(
-          trk->PT,
-          trk->Eta,
-          trk->Phi,
-          trk->Mass /* TODO: do we use track mass here ?? */
-          );
+      trackPID.push_back(kin->getTrackPID( // get smeared PID
+            trk,
+            itpfRICHTrack,
+            itDIRCepidTrack, itDIRChpidTrack,
+            itBTOFepidTrack, itBTOFhpidTrack,
+            itdualRICHagTrack, itdualRICHcfTrack
+            ));
+      if(!batchHadronKinematics && !WritingSkim()) continue;
+      auto kv = PIDtoFinalState.find(trackPID.back());
+      if(kv==PIDtoFinalState.end() || activeFinalStates.find(kv->second)==activeFinalStates.end()) continue;
       GenParticle* trkPart = (GenParticle*)trk->Particle.GetObject();
-      kinTrue->hadPID = pid;
-      kinTrue->vecHadron.SetPtEtaPhiM(
-          trkPart->PT,
-          trkPart->Eta,
-          trkPart->Phi,
-          trkPart->Mass /* TODO: do we use track mass here ?? */
-          );
-      
-      kin->CalculateHadronKinematics();
-      kinTrue->CalculateHadronKinematics();
+      kin->hadPID = kinTrue->hadPID = trackPID.back();
+      kin->vecHadron.SetPtEtaPhiM(trk->PT, trk->Eta, trk->Phi, trk->Mass);
+      kinTrue->vecHadron.SetPtEtaPhiM(trkPart->PT, trkPart->Eta, trkPart->Phi, trkPart->Mass);
+      kin->SetRandomHadron(trackPID.size()-1);
+      WriteSkimHadron();
+      if(batchHadronKinematics) AddToHadronBatch();
+    };
 
-      // asymmetry injection
-      //kin->InjectFakeAsymmetry(); // sets tSpin, based on reconstructed kinematics
-      //kinTrue->InjectFakeAsymmetry(); // sets tSpin, based on generated kinematics
-      //kin->tSpin = kinTrue->tSpin; // copy to "reconstructed" tSpin
+    // loop over recon methods
+    // - the input and the hadronic final state are shared by all methods, so only
+    //   the DIS and hadron kinematics are recalculated
+    for(TString reconMethodN : reconMethods) {
+      reconMethod = reconMethodN;
+
+      // calculate DIS kinematics
+      if(!(kin->CalculateDIS(reconMethod))) continue; // reconstructed
+      if(!(kinTrue->CalculateDIS(reconMethod))) continue; // generated (truth)
+      ZoneMapFill(); // (if building a zone map)
+      if(batchHadronKinematics) CalculateHadronBatch();
+
+      // track loop - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+      itTrack.Reset();
+      Int_t trkIdx = -1; // index of `trk` in the track branch, for the random draws
+      while(Track *trk = (Track*) itTrack()) {
+        trkIdx++;
+        //cout << e << " " << trk->PID << endl;
+
+        // final state cut
+        // - check PID, to see if it's a final state we're interested in for
+        //   histograms; if not, proceed to next track
+        pid = trackPID[trkIdx];
+        auto kv = PIDtoFinalState.find(pid);
+        if(kv!=PIDtoFinalState.end()) finalStateID = kv->second; else continue;
+        if(activeFinalStates.find(finalStateID)==activeFinalStates.end()) continue;
+
+        // get parent particle, to check if pion is from vector meson
+        GenParticle *trkParticle = (GenParticle*)trk->Particle.GetObject();
+        TObjArray *brParticle = (TObjArray*)itParticle.GetCollection();
+        GenParticle *parentParticle = (GenParticle*)brParticle->At(trkParticle->M1);
+        int parentPID = (parentParticle->PID); // TODO: this is not used yet...
+
+        // calculate hadron kinematics
+        kin->hadPID = pid;
+        kin->vecHadron.SetPtEtaPhiM(
+            trk->PT,
+            trk->Eta,
+            trk->Phi,
+            trk->Mass /* TODO: do we use track mass here ?? */
+            );
+        GenParticle* trkPart = (GenParticle*)trk->Particle.GetObject();
+        kinTrue->hadPID = pid;
+        kinTrue->vecHadron.SetPtEtaPhiM(
+            trkPart->PT,
+            trkPart->Eta,
+            trkPart->Phi,
+            trkPart->Mass /* TODO: do we use track mass here ?? */
+            );
+      
+        kin->SetRandomHadron(trkIdx);
+        kinTrue->SetRandomHadron(trkIdx);
+        CalculateHadronKinematics(); // (in batches, if `batchHadronKinematics`)
+
+        // asymmetry injection (if enabled, set `calculateAllObservables=true`)
+        //kin->InjectFakeAsymmetry(); // sets tSpin, based on reconstructed kinematics
+        //kinTrue->InjectFakeAsymmetry(); // sets tSpin, based on generated kinematics
+        //kin->tSpin = kinTrue->tSpin; // copy to "reconstructed" tSpin
   
-      // Get index of file that the event comes from.
-      Double_t Q2weightFactor = GetEventQ2Weight(kinTrue->Q2, inLookup[chain->GetTreeNumber()]);
-      wTrack = Q2weightFactor * weight->GetWeight(*kinTrue);
-      wTrackTotal += wTrack;
+        // Get index of file that the event comes from.
+        Double_t Q2weightFactor = GetEventQ2Weight(kinTrue->Q2, inLookup[chain->GetTreeNumber()]);
+        wTrack = Q2weightFactor * weight->GetWeight(*kinTrue);
+        wTrackTotal[reconMethod] += wTrack;
+        ZoneMapFillWeight(false); // (if building a zone map)
 
-      // fill track histograms in activated bins
-      FillHistosTracks();
+        // fill track histograms in activated bins
+        FillHistosTracks();
 
-      // fill simple tree
-      // - not binned
-      // - `activeEvent` is only true if at least one bin gets filled for this track
-      if( writeSimpleTree && activeEvent ) ST->FillTree(wTrack);
+        // fill simple tree
+        // - not binned
+        // - `activeEvent` is only true if at least one bin gets filled for this track
+        // - filled only for the first recon method of `reconMethods` (see `IsMainReconMethod`)
+        if( writeSimpleTree && activeEvent && IsMainReconMethod() ) ST->FillTree(wTrack);
 
-      // tests
-      //kin->ValidateHeadOnFrame();
+        // tests
+        //kin->ValidateHeadOnFrame();
 
-    }; // end track loop
+      }; // end track loop
 
 
-    // jet loop - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-    finalStateID = "jet";
-    if(activeFinalStates.find(finalStateID)!=activeFinalStates.end()) {
+      // jet loop - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+      finalStateID = "jet";
+      if(useJets) {
 
-      #if INCCENTAURO == 1
-      if(useBreitJets) kin->GetBreitFrameJets(itEFlowTrack, itEFlowPhoton, itEFlowNeutralHadron, itParticle);
-      #endif
+        #if INCCENTAURO == 1
+        if(useBreitJets) {
+          jetTimer.Start(false);
+          TString jetParams = jetCache ? kin->JetParams(true)+" recon="+reconMethod : "";
+          if(!(jetCache && jetCache->ReadJets(jetCacheInputID, jetParams, jetCacheEntry, kin->breitJetsRec, kin->breitJetsTrue, kin->quarkpT))) {
+            kin->GetBreitFrameJets(itEFlowTrack, itEFlowPhoton, itEFlowNeutralHadron, itParticle);
+            if(jetCache) jetCache->WriteJets(jetCacheInputID, jetParams, jetCacheEntry, kin->breitJetsRec, kin->breitJetsTrue, kin->quarkpT);
+          };
+          jetTimer.Stop();
+        };
+        #endif
 
-      Double_t Q2weightFactor = GetEventQ2Weight(kinTrue->Q2, chain->GetTreeNumber());
-      wJet = Q2weightFactor * weightJet->GetWeight(*kinTrue); // TODO: should we separate weights for breit and non-breit jets?
-      wJetTotal += wJet;
+        Double_t Q2weightFactor = GetEventQ2Weight(kinTrue->Q2, inLookup[chain->GetTreeNumber()]);
+        wJet = Q2weightFactor * weightJet->GetWeight(*kinTrue); // TODO: should we separate weights for breit and non-breit jets?
+        wJetTotal[reconMethod] += wJet;
+        ZoneMapFillWeight(true); // (if building a zone map)
 
-      Int_t nJets;
-      if(useBreitJets) nJets = kin->breitJetsRec.size();
-      else      nJets = kin->jetsRec.size();
+        Int_t nJets;
+        if(useBreitJets) nJets = kin->breitJetsRec.size();
+        else      nJets = kin->jetsRec.size();
 
-      for(int i = 0; i < kin->jetsRec.size(); i++){
+        for(int i = 0; i < nJets; i++){
 
-        if(useBreitJets) {
-          #if INCCENTAURO == 1
-          jet = kin->breitJetsRec[i];
-          kin->CalculateBreitJetKinematics(jet);
-          #endif
-        } else {
-          jet = kin->jetsRec[i];
-          kin->CalculateJetKinematics(jet);
-        };
+          if(useBreitJets) {
+            #if INCCENTAURO == 1
+            jet = kin->breitJetsRec[i];
+            kin->CalculateBreitJetKinematics(jet);
+            #endif
+          } else {
+            jet = kin->jetsRec[i];
+            kin->CalculateJetKinematics(jet);
+          };
 
-        // fill jet histograms in activated bins
-        FillHistosJets();
+          // fill jet histograms in activated bins
+          FillHistosJets();
 
-      };
-    }; // end jet loop
+        };
+      }; // end jet loop
+
+    }; // end recon method loop
 
   };
+  loopTimer.Stop();
   cout << "end event loop" << endl;
   // event loop end =========================================================
 
+  // throughput, and the time spent clustering jets
+  Double_t loopTime = loopTimer.RealTime();
+  if(loopTime>0) {
+    cout << "event loop: " << ENT << " events in " << loopTime << " s ("
+         << ENT/loopTime << " events/s)" << endl;
+    if(useJets)
+      cout << "jet clustering: " << jetTimer.RealTime() << " s ("
+           << 100*jetTimer.RealTime()/loopTime << "% of event loop)" << endl;
+  };
+
+
+  // close the jet cache
+  if(jetCache) delete jetCache;
 
   // finish execution
   Finish();
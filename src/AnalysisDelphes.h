@@ -15,6 +15,7 @@
 #include "TClonesArray.h"
 #include "TFile.h"
 #include "TRegexp.h"
+#include "TStopwatch.h"
 
 // delphes
 #include "classes/DelphesClasses.h"
@@ -32,6 +33,7 @@
 #include "BinSet.h"
 #include "SimpleTree.h"
 #include "Weights.h"
+#include "JetCache.h"
 
 
 class AnalysisDelphes : public Analysis
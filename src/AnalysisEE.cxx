@@ -38,7 +38,11 @@ AnalysisEE::~AnalysisEE() {
 void AnalysisEE::Execute()
 {
   // setup
-  Prepare();
+  if(!Prepare()) return;
+
+  // replay the in-memory event cache instead of reading the input, if it has the
+  // events of this analysis (see `eventCacheMB`)
+  if(ReplayEventCache()) return;
 
   // read EventEvaluator tree
   TChain *chain = new TChain("event_tree");
@@ -49,7 +53,8 @@ void AnalysisEE::Execute()
     }
   }
 
-  TTreeReader tr(chain);
+  // read only the entries of the event selection list, if one is read
+  TTreeReader tr(chain, UseEntryList(chain));
 
   // Truth
 
@@ -85,6 +90,14 @@ void AnalysisEE::Execute()
   //  TTreeReaderArray<short> tracks_charge(tr,  "tracks_charge");
 
 
+  // cache the used branches
+  PrepareRead(chain, {
+      "hepmcp_status", "hepmcp_PDG", "hepmcp_E", "hepmcp_px", "hepmcp_py", "hepmcp_pz",
+      "hepmcp_BCID", "hepmcp_m1", "hepmcp_m2",
+      "mcpart_ID", "mcpart_ID_parent", "mcpart_PDG", "mcpart_E", "mcpart_px", "mcpart_py", "mcpart_pz",
+      "mcpart_BCID",
+      "tracks_ID", "tracks_px", "tracks_py", "tracks_pz", "tracks_trueID" });
+
   TTreeReader::EEntryStatus entrystats = tr.SetEntry(0);
 
   // calculate Q2 weights
@@ -94,13 +107,32 @@ void AnalysisEE::Execute()
   Long64_t nevt, numNoBeam, numEle, numNoEle, numNoHadrons, numProxMatched, errorCount;
   nevt = numNoBeam = numEle = numNoEle = numNoHadrons = numProxMatched = errorCount = 0;
 
+  // resume from the checkpoint (if `resume`); `tr.Next()` then reads `resumeEntry`
+  Long64_t resumeEntry = ResumeCheckpoint({&nevt, &numNoBeam, &numEle, &numNoEle, &numNoHadrons, &numProxMatched, &errorCount});
+  if(resumeEntry<0) return;
+  if(resumeEntry>0) tr.SetEntry(resumeEntry-1);
+
   // event loop =========================================================
   cout << "begin event loop..." << endl;
+  Long64_t numEntries = maxEvents>0 ? TMath::Min(maxEvents, chain->GetEntries()) : chain->GetEntries();
   while(tr.Next()) {
+    Checkpoint(tr.GetCurrentEntry()); // (if `checkpointEvents` or `checkpointSeconds` is set)
     if(nevt%10000==0) cout << nevt << " events..." << endl;
   
     nevt++;
     if(nevt>maxEvents && maxEvents>0) break;
+    // skip clusters which have no events in the bins (if `useZoneMap`); the skipped
+    // entries count towards `maxEvents`, as in `AnalysisDelphes`
+    if(useZoneMap) {
+      Long64_t eNext = ZoneMapNextEntry(chain,tr.GetCurrentEntry(),numEntries);
+      if(eNext!=tr.GetCurrentEntry()) {
+        nevt += eNext - tr.GetCurrentEntry() - 1; // (the next entry read is counted by the loop)
+        if(eNext>=numEntries || tr.SetEntry(eNext-1)!=TTreeReader::kEntryValid) break;
+        continue;
+      };
+    };
+    SetRandomKey(chain);
+    MonitorRead(chain);
 
     // resets
     kin->ResetHFS();
@@ -253,6 +285,7 @@ void AnalysisEE::Execute()
       ParticlesEE part;
       part.pid = pid_;
       part.mcID = tracks_trueID[ireco];
+      part.index = ireco;
       //      part.charge = tracks_charge[ireco];
       part.charge = (pid_ == 211 || pid_ == 321 || pid_ == 2212 || pid_ == -11 || pid_ == -13)?1:(pid_ == -211 || pid_ == -321 || pid_ == -2212 || pid_ == 11 || pid_ == 13)?-1:0;
 
@@ -306,76 +339,114 @@ void AnalysisEE::Execute()
       continue;
     };
     
-    // calculate DIS kinematics
-    if(!(kin->CalculateDIS(reconMethod))) continue; // reconstructed
-    if(!(kinTrue->CalculateDIS(reconMethod))) continue; // generated (truth)
-
-
-    // loop over reconstructed particles again
-    /* - calculate hadron kinematics
-     * - fill output data structures (Histos, SimpleTree, etc.)
-     */
-    for(auto part : recopart) {
-      int pid_ = part.pid;
-      int mcid_ = part.mcID;
-
-      // final state cut
-      // - check PID, to see if it's a final state we're interested in for
-      //   histograms; if not, proceed to next track
-      auto kv = PIDtoFinalState.find(pid_);
-      if(kv!=PIDtoFinalState.end()) finalStateID = kv->second; else continue;
-      if(activeFinalStates.find(finalStateID)==activeFinalStates.end()) continue;
-
-      // calculate reconstructed hadron kinematics
-      kin->vecHadron = part.vecPart;
-      kin->CalculateHadronKinematics();
-
-      // find the matching truth hadron using mcID, and calculate its kinematics
-      if(mcid_ > 0) {
+    // write the event to the skim (if `skimFile` is set)
+    WriteSkimEvent(chain);
+
+    // write the hadrons of the hadron loop to the skim (if `skimFile` is set) and add them
+    // to the batch (if `batchHadronKinematics`); they do not depend on the recon method
+    ClearHadronBatch();
+    if(batchHadronKinematics || WritingSkim()) {
+      for(auto part : recopart) {
+        auto kv = PIDtoFinalState.find(part.pid);
+        if(kv==PIDtoFinalState.end() || activeFinalStates.find(kv->second)==activeFinalStates.end()) continue;
+        kin->vecHadron = part.vecPart;
         for(auto imc : mcpart) {
-          if(mcid_ == imc.mcID) {
+          if(part.mcID == imc.mcID) {
             kinTrue->vecHadron = imc.vecPart;
             break;
           }
         }
-      }
-      /* // deprecated, since existence of truth match is checked earlier; in practice prox matching was never called
-	 else {
-	 // give it another shot: proximity matching
-	 double mineta = 4.0;
-	 numProxMatched++;
-	 for(int imc=0; imc<(int)mcpart.size(); imc++) {
-	 if(pid_ == mcpart[imc].pid) {
-	 double deta = abs(kin->vecHadron.Eta() - mcpart[imc].vecPart.Eta());
-            if(deta < mineta) {
-              mineta = deta;
-              kinTrue->vecHadron = mcpart[imc].vecPart;
+        kin->SetRandomHadron(part.index);
+        WriteSkimHadron();
+        if(batchHadronKinematics) AddToHadronBatch();
+      };
+    };
+
+    // loop over recon methods
+    // - the input and the hadronic final state are shared by all methods, so only
+    //   the DIS and hadron kinematics are recalculated
+    for(TString reconMethodN : reconMethods) {
+      reconMethod = reconMethodN;
+
+      // calculate DIS kinematics
+      if(!(kin->CalculateDIS(reconMethod))) continue; // reconstructed
+      if(!(kinTrue->CalculateDIS(reconMethod))) continue; // generated (truth)
+      ZoneMapFill(); // (if building a zone map)
+      if(batchHadronKinematics) CalculateHadronBatch();
+
+
+      // loop over reconstructed particles again
+      /* - calculate hadron kinematics
+       * - fill output data structures (Histos, SimpleTree, etc.)
+       */
+      for(auto part : recopart) {
+        int pid_ = part.pid;
+        int mcid_ = part.mcID;
+
+        // final state cut
+        // - check PID, to see if it's a final state we're interested in for
+        //   histograms; if not, proceed to next track
+        auto kv = PIDtoFinalState.find(pid_);
+        if(kv!=PIDtoFinalState.end()) finalStateID = kv->second; else continue;
+        if(activeFinalStates.find(finalStateID)==activeFinalStates.end()) continue;
+
+        // reconstructed hadron
+        kin->vecHadron = part.vecPart;
+
+        // find the matching truth hadron using mcID
+        if(mcid_ > 0) {
+          for(auto imc : mcpart) {
+            if(mcid_ == imc.mcID) {
+              kinTrue->vecHadron = imc.vecPart;
+              break;
             }
           }
         }
-      }
-      */
-      kinTrue->CalculateHadronKinematics();
+        /* // deprecated, since existence of truth match is checked earlier; in practice prox matching was never called
+  	 else {
+  	 // give it another shot: proximity matching
+  	 double mineta = 4.0;
+  	 numProxMatched++;
+  	 for(int imc=0; imc<(int)mcpart.size(); imc++) {
+  	 if(pid_ == mcpart[imc].pid) {
+  	 double deta = abs(kin->vecHadron.Eta() - mcpart[imc].vecPart.Eta());
+              if(deta < mineta) {
+                mineta = deta;
+                kinTrue->vecHadron = mcpart[imc].vecPart;
+              }
+            }
+          }
+        }
+        */
+
+        // calculate hadron kinematics
+        kin->SetRandomHadron(part.index);
+        kinTrue->SetRandomHadron(part.index);
+        CalculateHadronKinematics(); // (in batches, if `batchHadronKinematics`)
+
+        // asymmetry injection (if enabled, set `calculateAllObservables=true`)
+        // kin->InjectFakeAsymmetry(); // sets tSpin, based on reconstructed kinematics
+        // kinTrue->InjectFakeAsymmetry(); // sets tSpin, based on generated kinematics
+        // kin->tSpin = kinTrue->tSpin; // copy to "reconstructed" tSpin
 
-      // asymmetry injection
-      // kin->InjectFakeAsymmetry(); // sets tSpin, based on reconstructed kinematics
-      // kinTrue->InjectFakeAsymmetry(); // sets tSpin, based on generated kinematics
-      // kin->tSpin = kinTrue->tSpin; // copy to "reconstructed" tSpin
+        // weighting
+        Double_t Q2weightFactor = GetEventQ2Weight(kinTrue->Q2, inLookup[chain->GetTreeNumber()]);
+        wTrack = Q2weightFactor * weight->GetWeight(*kinTrue);
+        wTrackTotal[reconMethod] += wTrack;
+        ZoneMapFillWeight(false); // (if building a zone map)
 
-      // weighting
-      Double_t Q2weightFactor = GetEventQ2Weight(kinTrue->Q2, inLookup[chain->GetTreeNumber()]);
-      wTrack = Q2weightFactor * weight->GetWeight(*kinTrue);
-      wTrackTotal += wTrack;
+        // fill track histograms in activated bins
+        FillHistosTracks();
 
-      // fill track histograms in activated bins
-      FillHistosTracks();
+        // fill simple tree
+        // - not binned
+        // - `activeEvent` is only true if at least one bin gets filled for this track
+        // - filled only for the first recon method of `reconMethods` (see `IsMainReconMethod`)
+        if( writeSimpleTree && activeEvent && IsMainReconMethod() ) ST->FillTree(wTrack);
 
-      // fill simple tree
-      // - not binned
-      // - `activeEvent` is only true if at least one bin gets filled for this track
-      if( writeSimpleTree && activeEvent ) ST->FillTree(wTrack);
+      }//hadron loop
 
-    }//hadron loop
+    }; // end recon method loop
 
   }// tree reader loop
 
@@ -0,0 +1,109 @@
+#include "AnalysisSkim.h"
+
+ClassImp(AnalysisSkim)
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// constructor
+AnalysisSkim::AnalysisSkim(
+  TString infileName_,
+  TString outfilePrefix_
+) : Analysis(
+  infileName_,
+  5, 41, 0, // beams are read from the skim file
+  outfilePrefix_
+)
+  , skimIn(nullptr)
+{
+};
+
+
+// open the skim file
+//------------------------------------
+Bool_t AnalysisSkim::LoadInputs() {
+  if(skimFile==infileName) {
+    cerr << "ERROR: cannot write the skim file that is being read" << endl;
+    return false;
+  };
+  skimIn = new SkimFile(infileName);
+  if(!skimIn->OpenRead()) return false;
+  cout << "skim file info: " << skimIn->GetInfo() << endl;
+  eleBeamEn = skimIn->GetEleBeamEn();
+  ionBeamEn = skimIn->GetIonBeamEn();
+  crossingAngle = skimIn->GetCrossingAngle();
+  // Q2 ranges: one "file" per range, so `inLookup` maps range index to itself
+  for(std::size_t idx=0; idx<skimIn->GetQ2min().size(); idx++) {
+    std::vector<std::string> fileNames = { std::string(infileName.Data()) };
+    std::vector<Long64_t> entries = { skimIn->GetEntries()[idx] };
+    if(!AddFile(fileNames, entries, skimIn->GetXs()[idx], skimIn->GetQ2min()[idx])) {
+      cerr << "ERROR: bad Q2 table in skim file " << infileName << endl;
+      return false;
+    };
+  };
+  return true;
+};
+
+
+//=============================================
+// perform the analysis
+//=============================================
+void AnalysisSkim::Execute() {
+
+  // setup
+  if(entryListFile!="") {
+    cerr << "WARNING: entryListFile is not used for skim files" << endl;
+    entryListFile = "";
+  };
+  if(eventCacheMB>0) {
+    cerr << "WARNING: eventCacheMB is not used for skim files, which are already memory-mapped" << endl;
+    eventCacheMB = 0;
+  };
+  if(!Prepare()) return;
+  // hadrons in the skim are those of the final states that wrote it, for any recon method
+  TString skimInfo = skimIn->GetInfo();
+  for(TString finalStateN : activeFinalStates) {
+    if(finalStateN!="jet" && !skimInfo.Contains(" "+finalStateN))
+      cerr << "WARNING: final state " << finalStateN << " was not used to write the skim" << endl;
+  };
+  if(activeFinalStates.find("jet")!=activeFinalStates.end())
+    cerr << "WARNING: skim files do not have jets; the jet final state will be empty" << endl;
+
+  ENT = skimIn->GetNumEvents();
+  if(maxEvents>0) ENT = TMath::Min(maxEvents,ENT); // limiter
+
+  CalculateEventQ2Weights();
+
+  // event loop =========================================================
+  cout << "begin event loop..." << endl;
+  TStopwatch loopTimer;
+  loopTimer.Start();
+  // resume from the checkpoint (if `resume`)
+  Long64_t resumeEntry = ResumeCheckpoint({});
+  if(resumeEntry<0) return;
+  for(Long64_t e=resumeEntry; e<ENT; e++) {
+    Checkpoint(e); // (if `checkpointEvents` or `checkpointSeconds` is set)
+    if(e>0&&e%100000==0) cout << (Double_t)e/ENT*100 << "%" << endl;
+    ReplayEvent(skimIn,e);
+  };
+  loopTimer.Stop();
+  cout << "end event loop" << endl;
+  // event loop end =========================================================
+
+  // throughput
+  Double_t loopTime = loopTimer.RealTime();
+  if(loopTime>0)
+    cout << "event loop: " << ENT << " events in " << loopTime << " s ("
+         << ENT/loopTime << " events/s)" << endl;
+
+  // finish execution
+  Finish();
+  skimIn->Close();
+};
+
+
+// destructor
+AnalysisSkim::~AnalysisSkim() {
+  if(skimIn) delete skimIn;
+};
@@ -0,0 +1,44 @@
+#ifndef AnalysisSkim_
+#define AnalysisSkim_
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <iostream>
+
+// root
+#include "TStopwatch.h"
+
+// sidis-eic
+#include "Analysis.h"
+#include "SkimFile.h"
+
+/* analysis of a skim file, written by another `Analysis` with `skimFile` set
+ * - `infileName_` is the skim file, instead of a config file; the beam energies, crossing
+ *   angle, and Q2 ranges (for the Q2 weights) are read from it
+ * - bins, histograms, and other settings may differ from the analysis that wrote the skim,
+ *   but recon methods and track final states must be among those it used, and jets are
+ *   not available
+ */
+class AnalysisSkim : public Analysis
+{
+  public:
+    AnalysisSkim(
+        TString infileName_="",
+        TString outfilePrefix_=""
+        );
+    ~AnalysisSkim();
+
+    // perform the analysis
+    void Execute() override;
+
+  protected:
+    // open the skim file, and add its Q2 ranges
+    Bool_t LoadInputs() override;
+
+  private:
+    SkimFile *skimIn; //!
+
+  ClassDefOverride(AnalysisSkim,1);
+};
+
+#endif
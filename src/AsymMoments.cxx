@@ -0,0 +1,151 @@
+#include "AsymMoments.h"
+
+ClassImp(AsymMoments)
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// constructor
+AsymMoments::AsymMoments(TString name_, TString title_, std::vector<TString> modNames_)
+  : modNames(modNames_)
+{
+  this->SetNameTitle(name_,title_);
+  sumWM.resize(2*modNames.size());
+  sumW2M.resize(2*modNames.size());
+  sumW2M2.resize(2*modNames.size());
+  sumWPD.resize(2*modNames.size());
+  Reset();
+};
+
+
+// fill
+void AsymMoments::Fill(Int_t spin, Double_t pol, const Double_t *mods, const Double_t *depols, Double_t w) {
+  if(w==0) return;
+  Int_t s = SpinIndex(spin);
+  entries[s]++;
+  sumW[s] += w;
+  sumW2[s] += w*w;
+  for(Int_t m=0; m<(Int_t)modNames.size(); m++) {
+    Int_t i = SumIndex(s,m);
+    sumWM[i] += w * mods[m];
+    sumW2M[i] += w * w * mods[m];
+    sumW2M2[i] += w * w * mods[m] * mods[m];
+    sumWPD[i] += w * pol * depols[m];
+  };
+};
+
+
+// combine with another accumulator
+void AsymMoments::Add(const AsymMoments *other) {
+  if(other->modNames.size()!=modNames.size()) {
+    cerr << "ERROR: cannot add AsymMoments " << other->GetName() << " to " << GetName()
+         << ", since they have different modulations" << endl;
+    return;
+  };
+  for(Int_t s=0; s<2; s++) {
+    entries[s] += other->entries[s];
+    sumW[s] += other->sumW[s];
+    sumW2[s] += other->sumW2[s];
+  };
+  for(std::size_t i=0; i<sumWM.size(); i++) {
+    sumWM[i] += other->sumWM[i];
+    sumW2M[i] += other->sumW2M[i];
+    sumW2M2[i] += other->sumW2M2[i];
+    sumWPD[i] += other->sumWPD[i];
+  };
+};
+
+// merge a list of accumulators into this one (used by `hadd` and `TFileMerger`)
+Long64_t AsymMoments::Merge(TCollection *list) {
+  if(list==nullptr) return 0;
+  TIter next(list);
+  while(TObject *obj = next()) {
+    if(!obj->InheritsFrom(AsymMoments::Class())) {
+      cerr << "ERROR: cannot merge " << obj->ClassName() << " into AsymMoments" << endl;
+      return -1;
+    };
+    Add((AsymMoments*)obj);
+  };
+  return GetEntries();
+};
+
+void AsymMoments::Reset() {
+  for(Int_t s=0; s<2; s++) {
+    entries[s] = 0;
+    sumW[s] = 0.;
+    sumW2[s] = 0.;
+  };
+  std::fill(sumWM.begin(),sumWM.end(),0.);
+  std::fill(sumW2M.begin(),sumW2M.end(),0.);
+  std::fill(sumW2M2.begin(),sumW2M2.end(),0.);
+  std::fill(sumWPD.begin(),sumWPD.end(),0.);
+};
+
+
+// accessors
+Int_t AsymMoments::GetModIndex(TString modName) {
+  for(std::size_t m=0; m<modNames.size(); m++) {
+    if(modNames[m]==modName) return (Int_t)m;
+  };
+  cerr << "ERROR: AsymMoments " << GetName() << " has no modulation " << modName << endl;
+  return -1;
+};
+
+// weighted average of the modulation, for one spin state
+Double_t AsymMoments::GetMoment(TString modName, Int_t spin) {
+  Int_t m = GetModIndex(modName);
+  Int_t s = SpinIndex(spin);
+  if(m<0 || sumW[s]==0) return 0.;
+  return sumWM[SumIndex(s,m)] / sumW[s];
+};
+
+// uncertainty of the weighted average: the variance of sum_i w_i*(m_i-<m>), divided by (sum w)^2
+Double_t AsymMoments::GetMomentError(TString modName, Int_t spin) {
+  Int_t m = GetModIndex(modName);
+  Int_t s = SpinIndex(spin);
+  if(m<0 || sumW[s]==0) return 0.;
+  Int_t i = SumIndex(s,m);
+  Double_t ave = sumWM[i] / sumW[s];
+  Double_t var = sumW2M2[i] - 2*ave*sumW2M[i] + ave*ave*sumW2[s];
+  return var>0 ? TMath::Sqrt(var) / sumW[s] : 0.;
+};
+
+Double_t AsymMoments::GetMeanPolDepol(TString modName) {
+  Int_t m = GetModIndex(modName);
+  Double_t sumWtot = sumW[0] + sumW[1];
+  if(m<0 || sumWtot==0) return 0.;
+  return ( sumWPD[SumIndex(0,m)] + sumWPD[SumIndex(1,m)] ) / sumWtot;
+};
+
+// asymmetry amplitude; returns 0 if either spin state is empty
+Double_t AsymMoments::GetAsymmetry(TString modName) {
+  Double_t pd = GetMeanPolDepol(modName);
+  if(pd==0 || sumW[0]==0 || sumW[1]==0) return 0.;
+  return ( GetMoment(modName,1) - GetMoment(modName,-1) ) / pd;
+};
+
+Double_t AsymMoments::GetAsymmetryError(TString modName) {
+  Double_t pd = GetMeanPolDepol(modName);
+  if(pd==0 || sumW[0]==0 || sumW[1]==0) return 0.;
+  return TMath::Hypot( GetMomentError(modName,1), GetMomentError(modName,-1) ) / TMath::Abs(pd);
+};
+
+
+// print
+void AsymMoments::Print(Option_t *option) const {
+  cout << "AsymMoments " << GetName() << " (" << GetTitle() << "): "
+       << entries[0] << " spin-up and " << entries[1] << " spin-down entries" << endl;
+  AsymMoments *self = const_cast<AsymMoments*>(this);
+  for(TString modName : modNames) {
+    cout << "  " << modName
+         << ": A=" << self->GetAsymmetry(modName)
+         << " +- " << self->GetAsymmetryError(modName)
+         << " <P*D>=" << self->GetMeanPolDepol(modName)
+         << endl;
+  };
+};
+
+
+AsymMoments::~AsymMoments() {
+};
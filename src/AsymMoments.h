@@ -0,0 +1,81 @@
+#ifndef AsymMoments_
+#define AsymMoments_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// ROOT
+#include "TObject.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TMath.h"
+#include "TCollection.h"
+
+/* streaming accumulator for single-spin asymmetries, by the method of moments
+ * - for each azimuthal modulation (e.g., sin(phiH-phiS) for Sivers), and separately
+ *   for each spin state, stores the weighted sums needed for the average of the
+ *   modulation and its statistical uncertainty, along with the weighted sum of
+ *   polarization times depolarization factor
+ * - the asymmetry amplitude is then
+ *     A = ( <m>_up - <m>_down ) / <P*D>
+ *   where <m> is the weighted average of the modulation `m` for each spin state,
+ *   which is independent of the relative luminosity of the two spin states
+ * - assumes the acceptance is uniform in the modulation angle; otherwise the
+ *   moments are biased, just like an unweighted fit would be
+ * - `Add` and `Merge` combine accumulators exactly, so `hadd` works too
+ */
+class AsymMoments : public TNamed
+{
+  public:
+    AsymMoments(
+        TString name_="asymMoments",
+        TString title_="",
+        std::vector<TString> modNames_={}
+        );
+    ~AsymMoments();
+
+    // fill
+    // - `spin` is the spin sign (+1 or -1) and `pol` the polarization magnitude
+    // - `mods` and `depols` must have one entry per modulation, in the order of
+    //   `GetModNames()`: the value of the modulation and its depolarization factor
+    void Fill(Int_t spin, Double_t pol, const Double_t *mods, const Double_t *depols, Double_t w=1.0);
+
+    // combine with another accumulator, which must have the same modulations
+    void Add(const AsymMoments *other);
+    Long64_t Merge(TCollection *list);
+    void Reset();
+
+    // accessors
+    std::vector<TString> GetModNames() { return modNames; };
+    Int_t GetModIndex(TString modName); // returns -1 if not found
+    Long64_t GetEntries(Int_t spin) { return entries[SpinIndex(spin)]; };
+    Long64_t GetEntries() { return entries[0] + entries[1]; };
+    Double_t GetSumW(Int_t spin) { return sumW[SpinIndex(spin)]; };
+    Double_t GetMoment(TString modName, Int_t spin); // <m> for one spin state
+    Double_t GetMomentError(TString modName, Int_t spin);
+    Double_t GetMeanPolDepol(TString modName); // <P*D>, both spin states
+    Double_t GetAsymmetry(TString modName);
+    Double_t GetAsymmetryError(TString modName);
+
+    void Print(Option_t *option="") const override;
+
+  private:
+    std::vector<TString> modNames;
+    Long64_t entries[2]; // per spin state: [0] for spin up, [1] for spin down
+    Double_t sumW[2];
+    Double_t sumW2[2];
+    // per spin state and modulation, at index `SumIndex(spinIdx,modIdx)`
+    std::vector<Double_t> sumWM; // sum of w*m
+    std::vector<Double_t> sumW2M; // sum of w^2*m
+    std::vector<Double_t> sumW2M2; // sum of w^2*m^2
+    std::vector<Double_t> sumWPD; // sum of w*P*D
+    Int_t SpinIndex(Int_t spin) { return spin>=0 ? 0 : 1; };
+    Int_t SumIndex(Int_t spinIdx, Int_t modIdx) { return spinIdx*(Int_t)modNames.size() + modIdx; };
+
+  ClassDefOverride(AsymMoments,1);
+};
+
+#endif
@@ -133,6 +133,18 @@ Bool_t CutDef::CheckCut(Double_t arg1) {
   return false;
 };
 
+// get the interval accepted by this cut
+Bool_t CutDef::GetInterval(Double_t &low, Double_t &high) {
+  low = -DBL_MAX;
+  high = DBL_MAX;
+  if(cutType.CompareTo("Min",TString::kIgnoreCase)==0) low = min;
+  else if(cutType.CompareTo("Max",TString::kIgnoreCase)==0) high = max;
+  else if(cutType.CompareTo("Range",TString::kIgnoreCase)==0) { low = min; high = max; }
+  else if(cutType.CompareTo("CenterDelta",TString::kIgnoreCase)==0) { low = center-delta; high = center+delta; }
+  else if(cutType.CompareTo("External",TString::kIgnoreCase)==0) return false;
+  return true;
+};
+
 CutDef::~CutDef() {
 };
 
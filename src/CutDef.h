@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <iostream>
 #include <sstream>
+#include <cfloat>
 
 // ROOT
 #include "TSystem.h"
@@ -41,6 +42,9 @@ class CutDef : public TObject
     Double_t GetMin() { return min; };
     Double_t GetMax() { return max; };
     TString GetCutID() { return cutID; };
+    // get the interval [low,high] accepted by this cut; open ends are set to -/+DBL_MAX;
+    // returns false for External cuts, which have no interval
+    Bool_t GetInterval(Double_t &low, Double_t &high);
 
 
   private:
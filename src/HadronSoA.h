@@ -0,0 +1,49 @@
+#ifndef HadronSoA_
+#define HadronSoA_
+
+#include <vector>
+
+// ROOT
+#include "Rtypes.h"
+#include "TLorentzVector.h"
+
+/* struct-of-arrays containers for batch hadron kinematics
+ * - `HadronSoA` holds the lab-frame 4-momenta of all hadrons in an event, as
+ *   contiguous arrays, so the loops in `Kinematics::CalculateHadronKinematicsBatch`
+ *   can be vectorized by the compiler
+ * - `HadronObsSoA` holds the resulting observables, with the same indexing
+ */
+struct HadronSoA {
+  std::vector<Double_t> px, py, pz, E;
+  std::vector<Int_t> pid;
+  std::size_t size() const { return px.size(); };
+  void clear() {
+    px.clear(); py.clear(); pz.clear(); E.clear(); pid.clear();
+  };
+  void reserve(std::size_t n) {
+    px.reserve(n); py.reserve(n); pz.reserve(n); E.reserve(n); pid.reserve(n);
+  };
+  void push_back(const TLorentzVector &p4, Int_t pid_=0) {
+    px.push_back(p4.Px());
+    py.push_back(p4.Py());
+    pz.push_back(p4.Pz());
+    E.push_back(p4.E());
+    pid.push_back(pid_);
+  };
+  TLorentzVector P4(std::size_t i) const {
+    return TLorentzVector(px[i],py[i],pz[i],E[i]);
+  };
+};
+
+struct HadronObsSoA {
+  std::vector<Double_t> pLab, pTlab, phiLab, etaLab;
+  std::vector<Double_t> z, pT, qT, mX, xF, phiH, phiS;
+  std::size_t size() const { return z.size(); };
+  void resize(std::size_t n) {
+    pLab.resize(n); pTlab.resize(n); phiLab.resize(n); etaLab.resize(n);
+    z.resize(n); pT.resize(n); qT.resize(n); mX.resize(n);
+    xF.resize(n); phiH.resize(n); phiS.resize(n);
+  };
+};
+
+#endif
@@ -12,6 +12,11 @@ using std::endl;
 Histos::Histos(TString setname_, TString settitle_)
   : setname(setname_)
   , settitle(settitle_)
+  , spilled(false)
+  , defDepsRec(~0u) // (all groups)
+  , defDepsTrue(~0u)
+  , depsRec(0)
+  , depsTrue(0)
 {
   this->SetName(setname);
   if(settitle!="settitle") cout << "Histos:  " << settitle << endl;
@@ -177,17 +182,47 @@ void Histos::DefineHist4D(
 };
 
 
+// define a moments accumulator
+Moments *Histos::DefineMoments(TString momName, TString momTitle, std::vector<TString> varNames) {
+  Moments *mom = new Moments(setname+"_mom_"+momName, momTitle+", "+settitle, varNames);
+  this->RegisterMoments(momName,mom);
+  return mom;
+};
+
+// define an asymmetry accumulator
+AsymMoments *Histos::DefineAsymMoments(TString asymName, TString asymTitle, std::vector<TString> modNames) {
+  AsymMoments *asym = new AsymMoments(setname+"_asym_"+asymName, asymTitle+", "+settitle, modNames);
+  this->RegisterAsym(asymName,asym);
+  return asym;
+};
+
+
 // add histogram to containers
 void Histos::RegisterHist(TString varname_, TH1 *hist_, HistConfig *config_) {
   VarNameList.push_back(varname_);
   histConfigMap.insert(std::pair<TString,HistConfig*>(varname_,config_));
   histMap.insert(std::pair<TString,TH1*>(varname_,hist_));
+  AddObservableDeps();
 };
 
 void Histos::RegisterHist4(TString varname_, Hist4D *hist_, HistConfig *config_) {
   VarNameList.push_back(varname_);
   hist4ConfigMap.insert(std::pair<TString,HistConfig*>(varname_,config_));
   hist4Map.insert(std::pair<TString,Hist4D*>(varname_,hist_));
+  AddObservableDeps();
+};
+
+
+void Histos::RegisterMoments(TString momName_, Moments *mom_) {
+  MomentsNameList.push_back(momName_);
+  momentsMap.insert(std::pair<TString,Moments*>(momName_,mom_));
+  AddObservableDeps();
+};
+
+void Histos::RegisterAsym(TString asymName_, AsymMoments *asym_) {
+  AsymNameList.push_back(asymName_);
+  asymMap.insert(std::pair<TString,AsymMoments*>(asymName_,asym_));
+  AddObservableDeps();
 };
 
 
@@ -217,6 +252,29 @@ Hist4D *Histos::Hist4(TString histName, Bool_t silence) {
 };
 
 
+Moments *Histos::Mom(TString momName, Bool_t silence) {
+  auto it = momentsMap.find(momName);
+  if(it==momentsMap.end()) {
+    if(!silence)
+      cerr << "ERROR: momentsMap does not have "
+           << momName << " accumulator" << endl;
+    return nullptr;
+  };
+  return it->second;
+};
+
+AsymMoments *Histos::Asym(TString asymName, Bool_t silence) {
+  auto it = asymMap.find(asymName);
+  if(it==asymMap.end()) {
+    if(!silence)
+      cerr << "ERROR: asymMap does not have "
+           << asymName << " accumulator" << endl;
+    return nullptr;
+  };
+  return it->second;
+};
+
+
 // access histogram config by name
 HistConfig *Histos::GetHistConfig(TString histName) {
   HistConfig *retConfig;
@@ -241,6 +299,146 @@ HistConfig *Histos::GetHist4Config(TString histName) {
 };
 
 
+// memory accounting
+Long64_t Histos::HistBytes(TObject *hist, Bool_t assumeSumw2) {
+  if(hist==nullptr) return 0;
+  if(hist->InheritsFrom(Hist4D::Class())) {
+    Hist4D *hist4 = (Hist4D*) hist;
+    Long64_t bytes = hist4->IsA()->Size() + HistBytes(hist4->_axes,false);
+    for(TH2D *subHist : hist4->_hists) bytes += HistBytes(subHist,assumeSumw2);
+    return bytes;
+  };
+  if(!hist->InheritsFrom(TH1::Class())) return hist->IsA()->Size();
+  TH1 *h = (TH1*) hist;
+  // size of each bin content
+  Long64_t cellBytes = sizeof(Double_t);
+  if(h->IsA()->InheritsFrom("TArrayF") || h->IsA()->InheritsFrom("TArrayI")) cellBytes = 4;
+  else if(h->IsA()->InheritsFrom("TArrayS")) cellBytes = 2;
+  else if(h->IsA()->InheritsFrom("TArrayC")) cellBytes = 1;
+  Long64_t bytes = h->IsA()->Size() + h->GetNcells()*cellBytes;
+  if(assumeSumw2 || h->GetSumw2N()>0) bytes += h->GetNcells()*sizeof(Double_t);
+  // variable-width bin edges
+  bytes += ( h->GetXaxis()->GetXbins()->GetSize() +
+             h->GetYaxis()->GetXbins()->GetSize() +
+             h->GetZaxis()->GetXbins()->GetSize() ) * sizeof(Double_t);
+  return bytes;
+};
+
+Long64_t Histos::HistBytes(TString varname, Bool_t assumeSumw2) {
+  TObject *hist = Hist(varname,true);
+  if(hist==nullptr) hist = Hist4(varname,true);
+  return HistBytes(hist,assumeSumw2);
+};
+
+Long64_t Histos::GetBytes(Bool_t assumeSumw2) {
+  Long64_t bytes = this->IsA()->Size();
+  for(auto const &kv : histMap) bytes += HistBytes(kv.second,assumeSumw2);
+  for(auto const &kv : hist4Map) bytes += HistBytes(kv.second,assumeSumw2);
+  for(auto const &kv : momentsMap) bytes += kv.second->IsA()->Size() +
+    kv.second->GetVarNames().size() * (2*sizeof(Double_t) + sizeof(TString));
+  for(auto const &kv : asymMap) bytes += kv.second->IsA()->Size() +
+    kv.second->GetModNames().size() * (8*sizeof(Double_t) + sizeof(TString));
+  return bytes;
+};
+
+
+// delete all histograms, moments and asymmetry accumulators, and configurations
+void Histos::DeleteHists() {
+  for(auto const &kv : histMap) delete kv.second;
+  for(auto const &kv : hist4Map) delete kv.second;
+  for(auto const &kv : histConfigMap) delete kv.second;
+  for(auto const &kv : hist4ConfigMap) delete kv.second;
+  for(auto const &kv : momentsMap) delete kv.second;
+  for(auto const &kv : asymMap) delete kv.second;
+  histMap.clear();
+  momentsMap.clear();
+  MomentsNameList.clear();
+  asymMap.clear();
+  AsymNameList.clear();
+  hist4Map.clear();
+  histConfigMap.clear();
+  hist4ConfigMap.clear();
+  VarNameList.clear();
+};
+
+
+// out-of-core storage: write histograms to `dir` and free them from memory
+void Histos::Spill(TDirectory *dir) {
+  if(spilled) return;
+  // "Overwrite" replaces the key from any previous spill, so the scratch file does not grow
+  for(auto const &kv : histMap) {
+    dir->WriteTObject(kv.second,SpillKey(kv.first),"Overwrite");
+    delete kv.second;
+  };
+  for(auto const &kv : hist4Map) {
+    dir->WriteTObject(kv.second,SpillKey(kv.first),"Overwrite");
+    delete kv.second;
+  };
+  histMap.clear();
+  hist4Map.clear();
+  spilled = true;
+};
+
+// read spilled histograms back from `dir`
+void Histos::Restore(TDirectory *dir) {
+  if(!spilled) return;
+  for(TString varname : VarNameList) {
+    TObject *obj = dir->Get(SpillKey(varname));
+    if(obj==nullptr) {
+      cerr << "ERROR: cannot restore histogram " << varname << " of " << setname << endl;
+      continue;
+    };
+    if(obj->InheritsFrom(Hist4D::Class()))
+      hist4Map.insert(std::pair<TString,Hist4D*>(varname,(Hist4D*)obj));
+    else {
+      ((TH1*)obj)->SetDirectory(nullptr); // owned by this Histos, not by `dir`
+      histMap.insert(std::pair<TString,TH1*>(varname,(TH1*)obj));
+    };
+  };
+  spilled = false;
+};
+
+
+// checkpoint: accumulators get their own key prefixes, since their names may be
+// histogram names too
+void Histos::WriteCheckpoint(TDirectory *dir) {
+  for(auto const &kv : histMap) dir->WriteTObject(kv.second,SpillKey(kv.first));
+  for(auto const &kv : hist4Map) dir->WriteTObject(kv.second,SpillKey(kv.first));
+  for(auto const &kv : momentsMap) dir->WriteTObject(kv.second,SpillKey("mom__"+kv.first));
+  for(auto const &kv : asymMap) dir->WriteTObject(kv.second,SpillKey("asym__"+kv.first));
+};
+
+Bool_t Histos::ReadCheckpoint(TDirectory *dir) {
+  // check that everything is there, before replacing anything
+  for(auto const &kv : histMap) if(dir->GetKey(SpillKey(kv.first))==nullptr) return false;
+  for(auto const &kv : hist4Map) if(dir->GetKey(SpillKey(kv.first))==nullptr) return false;
+  for(auto const &kv : momentsMap) if(dir->GetKey(SpillKey("mom__"+kv.first))==nullptr) return false;
+  for(auto const &kv : asymMap) if(dir->GetKey(SpillKey("asym__"+kv.first))==nullptr) return false;
+  for(auto &kv : histMap) {
+    TH1 *hist = (TH1*) dir->Get(SpillKey(kv.first));
+    hist->SetDirectory(nullptr); // owned by this Histos, not by `dir`
+    delete kv.second;
+    kv.second = hist;
+  };
+  for(auto &kv : hist4Map) {
+    Hist4D *hist = (Hist4D*) dir->Get(SpillKey(kv.first));
+    delete kv.second;
+    kv.second = hist;
+  };
+  for(auto &kv : momentsMap) {
+    Moments *mom = (Moments*) dir->Get(SpillKey("mom__"+kv.first));
+    delete kv.second;
+    kv.second = mom;
+  };
+  for(auto &kv : asymMap) {
+    AsymMoments *asym = (AsymMoments*) dir->Get(SpillKey("asym__"+kv.first));
+    delete kv.second;
+    kv.second = asym;
+  };
+  return true;
+};
+
+
 // get a specific CutDef
 CutDef *Histos::GetCutDef(TString varName) {
   for(auto cut : CutDefList) {
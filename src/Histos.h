@@ -24,6 +24,8 @@
 #include "BinSet.h"
 #include "CutDef.h"
 #include "Hist4D.h"
+#include "Moments.h"
+#include "AsymMoments.h"
 
 // container for histogram settings
 class HistConfig : public TNamed {
@@ -54,6 +56,10 @@ class Histos : public TNamed
     Hist4D *Hist4(TString histName, Bool_t silence=false);
     HistConfig *GetHistConfig(TString histName); // settings for this histogram
     HistConfig *GetHist4Config(TString histName);
+    Moments *Mom(TString momName, Bool_t silence=false); // access moments accumulator by name
+    std::vector<TString> MomentsNameList; // list of moments accumulator names
+    AsymMoments *Asym(TString asymName, Bool_t silence=false); // access asymmetry accumulator by name
+    std::vector<TString> AsymNameList; // list of asymmetry accumulator names
     std::vector<TString> VarNameList; // list of histogram names (for external looping)
     std::vector<CutDef*> CutDefList; // list of associated cut definitions
     TString GetSetName() { return setname; };
@@ -63,6 +69,13 @@ class Histos : public TNamed
     // store associated cut definitions
     void AddCutDef(CutDef *cut) { CutDefList.push_back(cut); };
 
+    // add an already-built histogram to containers (used when reading
+    // consolidated output, see `HistosStore`)
+    void RegisterHist(TString varname_, TH1 *hist_, HistConfig *config_);
+    void RegisterHist4(TString varname_, Hist4D *hist_, HistConfig *config_);
+    void RegisterMoments(TString momName_, Moments *mom_);
+    void RegisterAsym(TString asymName_, AsymMoments *asym_);
+
     // histogram builders
     void DefineHist1D(
         TString varname,
@@ -118,6 +131,46 @@ class Histos : public TNamed
         Bool_t logz = false
         );
 
+    // moments accumulator builder: streaming weighted mean and variance of each
+    // variable in `varNames`, as a cheap alternative to histograms whose only
+    // purpose is to compute averages or resolutions (see `Moments`)
+    Moments *DefineMoments(TString momName, TString momTitle, std::vector<TString> varNames);
+    // asymmetry accumulator builder: spin-dependent moments of each azimuthal
+    // modulation in `modNames`, for asymmetry extraction (see `AsymMoments`)
+    AsymMoments *DefineAsymMoments(TString asymName, TString asymTitle, std::vector<TString> modNames);
+
+    // observable groups (see `Kinematics::obsGroup_enum`) read to fill the histograms and
+    // accumulators defined after `SetObservableDeps`, for reconstructed and generated
+    // kinematics (the default is all groups); `GetObservableDeps` returns the union of
+    // those of all definitions (see `Analysis::PrepareObservables`)
+    void SetObservableDeps(UInt_t depsRec_, UInt_t depsTrue_=0) { defDepsRec = depsRec_; defDepsTrue = depsTrue_; };
+    UInt_t GetObservableDeps(Bool_t generated=false) { return generated ? depsTrue : depsRec; };
+
+    // memory accounting
+    // - `HistBytes` estimates the heap usage of a TH1 or Hist4D; if `assumeSumw2`,
+    //   include the sum of weights squared array even if not (yet) allocated, since
+    //   it is created by the first weighted `Fill`
+    static Long64_t HistBytes(TObject *hist, Bool_t assumeSumw2=false);
+    Long64_t HistBytes(TString varname, Bool_t assumeSumw2=false);
+    Long64_t GetBytes(Bool_t assumeSumw2=false); // sum over all histograms
+    // delete all histograms, moments and asymmetry accumulators, and configurations
+    void DeleteHists();
+
+    // out-of-core storage (see `HistosDAG::SetWorkingSet`)
+    // - `Spill` writes all histograms to `dir` and frees them from memory; configurations,
+    //   names and cuts stay resident
+    // - `Restore` reads them back from `dir`
+    void Spill(TDirectory *dir);
+    void Restore(TDirectory *dir);
+    Bool_t IsSpilled() { return spilled; };
+
+    // checkpoint (see `Analysis::checkpointEvents`)
+    // - `WriteCheckpoint` writes copies of all histograms and accumulators to `dir`
+    // - `ReadCheckpoint` replaces them with those in `dir`; returns false, and changes
+    //   nothing, if any is missing
+    void WriteCheckpoint(TDirectory *dir);
+    Bool_t ReadCheckpoint(TDirectory *dir);
+
     // writers
     void WriteHists(TFile *ofile) {
       ofile->cd("/");
@@ -125,6 +178,8 @@ class Histos : public TNamed
       ofile->cd("histArr_"+setname);
       for(auto const &kv : histMap) kv.second->Write();
       for(auto const &kv : hist4Map) kv.second->Write();
+      for(auto const &kv : momentsMap) kv.second->Write();
+      for(auto const &kv : asymMap) kv.second->Write();
       ofile->cd("/");
     };
 
@@ -135,10 +190,15 @@ class Histos : public TNamed
     std::map<TString,Hist4D*> hist4Map;
     std::map<TString,HistConfig*> histConfigMap;
     std::map<TString,HistConfig*> hist4ConfigMap;
-    void RegisterHist(TString varname_, TH1 *hist_, HistConfig *config_);
-    void RegisterHist4(TString varname_, Hist4D *hist_, HistConfig *config_);
+    std::map<TString,Moments*> momentsMap;
+    std::map<TString,AsymMoments*> asymMap;
+    Bool_t spilled; //!
+    UInt_t defDepsRec, defDepsTrue; //! observable groups of the next definitions
+    UInt_t depsRec, depsTrue; //! union of the observable groups of all definitions
+    void AddObservableDeps() { depsRec |= defDepsRec; depsTrue |= defDepsTrue; };
+    TString SpillKey(TString varname_) { return setname+"__"+varname_; };
 
-  ClassDef(Histos,1);
+  ClassDef(Histos,3);
 };
 
 #endif
@@ -5,6 +5,10 @@ ClassImp(HistosDAG)
 // default constructor
 HistosDAG::HistosDAG()
   : debug(false)
+  , maxResident(0)
+  , scratchFile(nullptr)
+  , nSpills(0)
+  , nRestores(0)
 {
   InitializeDAG();
 };
@@ -70,6 +74,17 @@ void HistosDAG::Build(TFile *rootFile) {
       if(B->GetNumBins()>0) AddLayer(B);
     };
   };
+  // consolidated output (see `HistosStore`): rebuild Histos from family trees
+  if(HistosStore::IsConsolidated(rootFile)) {
+    HistosStore store(rootFile);
+    for(Histos *H : store.ReadAll()) {
+      NodePath P;
+      if(!PathFromHistosName(H->GetName(),P)) return;
+      for(Node *N : P.GetBinNodes()) { H->AddCutDef(N->GetCut()); };
+      histosMap.insert(std::pair<std::set<Node*>,Histos*>(P.GetBinNodes(),H));
+    };
+    return;
+  };
   nextKey.Reset();
   // add each Histos to histMap
   while(TKey *key = (TKey*)nextKey()) {
@@ -78,27 +93,33 @@ void HistosDAG::Build(TFile *rootFile) {
       // get NodePath from Histos name
       if(debug) std::cout << "READ HISTOS " << keyname << std::endl;
       NodePath P;
-      P.nodes.insert(GetRootNode());
-      P.nodes.insert(GetLeafNode());
-      TString tokID;
-      Ssiz_t tf=0;
-      while(keyname.Tokenize(tokID,tf,"__")) {
-        if(tokID=="histos") continue;
-        Node *N = GetNode(tokID);
-        if(N) P.nodes.insert(N);
-        else {
-          std::cerr << "ERROR: mismatch of Node \"" << tokID << "\" between Histos and BinSets" << std::endl;
-          return;
-        };
-      };
-      // append to `histosMap`
-      if(debug) std::cout << "-> PATH: " << P.PathString() << std::endl;
+      if(!PathFromHistosName(keyname,P)) return;
       histosMap.insert(std::pair<std::set<Node*>,Histos*>(P.GetBinNodes(),(Histos*)key->ReadObj()));
     };
   };
 };
 
 
+// get NodePath from Histos name, which is of the form `histos__<nodeID>__<nodeID>...`
+Bool_t HistosDAG::PathFromHistosName(TString histosName, NodePath &P) {
+  P.nodes.insert(GetRootNode());
+  P.nodes.insert(GetLeafNode());
+  TString tokID;
+  Ssiz_t tf=0;
+  while(histosName.Tokenize(tokID,tf,"__")) {
+    if(tokID=="histos") continue;
+    Node *N = GetNode(tokID);
+    if(N) P.nodes.insert(N);
+    else {
+      std::cerr << "ERROR: mismatch of Node \"" << tokID << "\" between Histos and BinSets" << std::endl;
+      return false;
+    };
+  };
+  if(debug) std::cout << "-> PATH: " << P.PathString() << std::endl;
+  return true;
+};
+
+
 // return Histos* associated with the given NodePath
 Histos *HistosDAG::GetHistos(NodePath *P) {
   Histos *ret;
@@ -108,9 +129,19 @@ Histos *HistosDAG::GetHistos(NodePath *P) {
               << P->PathString() << std::endl;
     return nullptr;
   };
+  if(maxResident>0) Touch(ret);
   return ret;
 };
 
+// return Histos* with the given name
+Histos *HistosDAG::GetHistos(TString histosName) {
+  for(auto const &kv : histosMap) {
+    if(histosName==kv.second->GetName()) return kv.second;
+  };
+  std::cerr << "ERROR: no Histos named " << histosName << std::endl;
+  return nullptr;
+};
+
 // return Histos* associated with the given external NodePath, by ID-matching its Nodes to the local DAG's Nodes
 Histos *HistosDAG::GetHistosExternal(NodePath *extP) {
   NodePath *intP = new NodePath();
@@ -121,6 +152,81 @@ Histos *HistosDAG::GetHistosExternal(NodePath *extP) {
   return this->GetHistos(intP);
 };
 
+// bounded working set
+void HistosDAG::SetWorkingSet(Long64_t maxResident_, TString scratchFileName) {
+  CloseWorkingSet();
+  if(maxResident_<=0) return;
+  maxResident = maxResident_;
+  // open the scratch file, without changing the current directory
+  TDirectory::TContext context;
+  scratchFile = new TFile(scratchFileName,"RECREATE","",404); // fast LZ4 compression
+  if(scratchFile->IsZombie()) {
+    std::cerr << "ERROR: cannot open scratch file " << scratchFileName << "; working set disabled" << std::endl;
+    delete scratchFile;
+    scratchFile = nullptr;
+    maxResident = 0;
+    return;
+  };
+  std::cout << "HistosDAG working set: at most " << maxResident << " resident Histos, "
+            << "scratch file " << scratchFileName << std::endl;
+};
+
+void HistosDAG::CloseWorkingSet() {
+  if(scratchFile==nullptr) return;
+  std::cout << "HistosDAG working set: " << nSpills << " spills, " << nRestores << " restores" << std::endl;
+  TString scratchFileName = scratchFile->GetName();
+  scratchFile->Close();
+  delete scratchFile;
+  scratchFile = nullptr;
+  gSystem->Unlink(scratchFileName);
+  maxResident = 0;
+  lruList.clear();
+  lruPos.clear();
+};
+
+// mark `H` as most recently used, restoring it if needed, and spill
+// the least recently used Histos if over the limit
+void HistosDAG::Touch(Histos *H) {
+  auto it = lruPos.find(H);
+  if(it!=lruPos.end()) {
+    if(it->second==lruList.begin()) return; // already most recent
+    lruList.erase(it->second);
+  } else if(H->IsSpilled()) {
+    H->Restore(scratchFile);
+    nRestores++;
+  };
+  lruList.push_front(H);
+  lruPos[H] = lruList.begin();
+  while((Long64_t)lruList.size() > maxResident) {
+    Histos *cold = lruList.back();
+    cold->Spill(scratchFile);
+    nSpills++;
+    lruPos.erase(cold);
+    lruList.pop_back();
+  };
+};
+
+
+// checkpoint; spilled Histos are paged in first
+void HistosDAG::WriteCheckpoint(TDirectory *dir) {
+  for(auto const &kv : histosMap) {
+    if(maxResident>0) Touch(kv.second);
+    kv.second->WriteCheckpoint(dir);
+  };
+};
+
+Bool_t HistosDAG::ReadCheckpoint(TDirectory *dir) {
+  for(auto const &kv : histosMap) {
+    if(maxResident>0) Touch(kv.second);
+    if(!kv.second->ReadCheckpoint(dir)) {
+      std::cerr << "ERROR: Histos " << kv.second->GetName() << " is not in the checkpoint" << std::endl;
+      return false;
+    };
+  };
+  return true;
+};
+
+
 HistosDAG::~HistosDAG() {
 };
 
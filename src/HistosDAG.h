@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <iostream>
 #include <sstream>
+#include <list>
 
 // ROOT
 #include "TSystem.h"
@@ -21,6 +22,7 @@
 #include "BinSet.h"
 #include "Node.h"
 #include "NodePath.h"
+#include "HistosStore.h"
 
 
 class HistosDAG : public DAG
@@ -34,6 +36,7 @@ class HistosDAG : public DAG
 
     // build the DAG from ROOT file; all BinSets will become layers and
     // all Histos objects will be linked to NodePaths
+    // - supports both one-key-per-Histos files and consolidated files (see `HistosStore`)
     void Build(TFile *rootFile);
 
     // payload operator, executed on the specified Histos object; see `FormatPayload`
@@ -79,12 +82,41 @@ class HistosDAG : public DAG
 
     // return Histos* associated with the given NodePath
     Histos *GetHistos(NodePath *P);
+    // return Histos* with the given name (slower: linear search)
+    Histos *GetHistos(TString histosName);
+    // bounded working set: keep at most `maxResident_` Histos in memory; when a Histos
+    // is accessed with `GetHistos` and the limit is exceeded, the least-recently-used
+    // Histos is spilled to the scratch file `scratchFileName`, and it is paged back in
+    // the next time it is accessed
+    // - `maxResident_==0` disables the working set (default)
+    // - call `CloseWorkingSet` when done, to remove the scratch file; Histos which
+    //   are spilled at that point are no longer accessible
+    void SetWorkingSet(Long64_t maxResident_, TString scratchFileName);
+    void CloseWorkingSet();
+    Long64_t GetMaxResident() { return maxResident; };
+
+    // checkpoint: write the contents of all Histos to `dir`, or replace them with those
+    // in `dir` (see `Histos::WriteCheckpoint`); `ReadCheckpoint` returns false if any
+    // Histos is not in `dir`
+    void WriteCheckpoint(TDirectory *dir);
+    Bool_t ReadCheckpoint(TDirectory *dir);
+
+    // number of Histos objects (leaf paths)
+    Long64_t GetNumHistos() { return (Long64_t)histosMap.size(); };
     // if you have a NodePath from another DAG that has the same binning scheme, use GetHistosExternal instead
     Histos *GetHistosExternal(NodePath *extP);
 
   private:
     Bool_t debug;
     std::map<std::set<Node*>,Histos*> histosMap; // map DAG path of bin nodes -> Histos*
+    Bool_t PathFromHistosName(TString histosName, NodePath &P);
+    // working set
+    Long64_t maxResident;
+    TFile *scratchFile; //!
+    std::list<Histos*> lruList; //! resident Histos, most recently used first
+    std::map<Histos*,std::list<Histos*>::iterator> lruPos; //!
+    Long64_t nSpills, nRestores;
+    void Touch(Histos *H);
 
   ClassDefOverride(HistosDAG,1);
 };
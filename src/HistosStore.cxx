@@ -0,0 +1,287 @@
+#include "HistosStore.h"
+
+ClassImp(HistosStore)
+
+using std::map;
+using std::vector;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// constructor; if `file_` is given, read the index of consolidated Histos
+HistosStore::HistosStore(TFile *file_)
+  : file(file_)
+  , readBuffer(nullptr)
+  , indexTr(nullptr)
+  , indexOffset(0)
+{
+  this->SetName("histosStore");
+  if(file==nullptr) return;
+  if(!IsConsolidated(file)) {
+    cerr << "ERROR: file " << file->GetName() << " does not contain consolidated Histos" << endl;
+    return;
+  };
+  // read the index tree
+  TTree *indexTree = file->Get<TTree>("histosIndex");
+  std::string *nameStr = nullptr;
+  std::string *titleStr = nullptr;
+  Long64_t offset;
+  indexTree->SetBranchAddress("name",&nameStr);
+  indexTree->SetBranchAddress("title",&titleStr);
+  indexTree->SetBranchAddress("offset",&offset);
+  for(Long64_t e=0; e<indexTree->GetEntries(); e++) {
+    indexTree->GetEntry(e);
+    histosNames.push_back(TString(*nameStr));
+    histosTitles.push_back(TString(*titleStr));
+    offsetMap.insert(std::pair<TString,Long64_t>(TString(*nameStr),offset));
+  };
+  // list of family tree names, in booking order
+  for(auto obj : *indexTree->GetUserInfo()) {
+    if(obj->InheritsFrom(TObjString::Class()))
+      families.push_back(((TObjString*)obj)->GetString());
+  };
+  indexTree->ResetBranchAddresses();
+};
+
+
+// write a list of Histos to `ofile`, in consolidated form
+Bool_t HistosStore::Write(TFile *ofile, std::vector<Histos*> histosList) {
+  HistosStore store;
+  Bool_t success = true;
+  store.BeginWrite(ofile);
+  for(Histos *H : histosList) success &= store.Append(H);
+  store.EndWrite();
+  return success;
+};
+
+
+// incremental writing
+void HistosStore::BeginWrite(TFile *ofile) {
+  file = ofile;
+  file->cd("/");
+  families.clear();
+  familyTrees.clear();
+  writeBuffers.clear();
+  // index tree: Histos name -> offset in family trees
+  indexTr = new TTree("histosIndex","Histos index");
+  indexTr->Branch("name",&indexName);
+  indexTr->Branch("title",&indexTitle);
+  indexTr->Branch("offset",&indexOffset,"offset/L");
+  indexOffset = 0;
+};
+
+Bool_t HistosStore::Append(Histos *H) {
+  if(indexTr==nullptr) {
+    cerr << "ERROR: call HistosStore::BeginWrite before Append" << endl;
+    return false;
+  };
+  file->cd("/");
+  // one tree per histogram family and per moments accumulator; families are
+  // taken from the first Histos
+  if(indexOffset==0) {
+    for(TString varName : H->VarNameList) {
+      Bool_t is4D = H->Hist4(varName,true)!=nullptr;
+      TObject *proto = is4D ? (TObject*)H->Hist4(varName) : (TObject*)H->Hist(varName);
+      HistConfig *config = is4D ? H->GetHist4Config(varName) : H->GetHistConfig(varName);
+      if(proto==nullptr || config==nullptr) continue;
+      TTree *famTr = BookFamilyTree("histfam__"+varName,varName+" histograms",proto);
+      famTr->GetUserInfo()->Add(config->Clone(varName));
+    };
+    for(TString momName : H->MomentsNameList)
+      BookFamilyTree("momfam__"+momName,momName+" moments",H->Mom(momName));
+    for(TString asymName : H->AsymNameList)
+      BookFamilyTree("asymfam__"+asymName,asymName+" asymmetry moments",H->Asym(asymName));
+  };
+  // check that this Histos has every family, before filling any family tree,
+  // so that all family trees stay in sync with the index
+  for(TString treeName : families) {
+    if(GetObject(H,treeName)==nullptr) {
+      cerr << "ERROR: Histos " << H->GetName() << " has no object for " << treeName
+           << "; all Histos must have the same histogram families; not writing it" << endl;
+      return false;
+    };
+  };
+  // fill each family tree
+  for(TString treeName : families) {
+    writeBuffers[treeName] = GetObject(H,treeName);
+    familyTrees[treeName]->Fill();
+  };
+  // fill index
+  indexName = H->GetName();
+  indexTitle = H->GetSetTitle().Data();
+  indexTr->Fill();
+  indexOffset++;
+  return true;
+};
+
+// create a family tree, with an unsplit branch holding one object per entry
+TTree *HistosStore::BookFamilyTree(TString treeName, TString treeTitle, TObject *proto) {
+  TTree *famTr = new TTree(treeName,treeTitle);
+  writeBuffers[treeName] = proto;
+  famTr->Branch("obj",proto->ClassName(),&writeBuffers[treeName],32000,0);
+  familyTrees.insert(std::pair<TString,TTree*>(treeName,famTr));
+  families.push_back(treeName);
+  indexTr->GetUserInfo()->Add(new TObjString(treeName));
+  return famTr;
+};
+
+// get the object of Histos `H` that belongs in family tree `treeName`
+TObject *HistosStore::GetObject(Histos *H, TString treeName) {
+  TString name = treeName;
+  if(name.BeginsWith("momfam__")) return H->Mom(name.Remove(0,8),true);
+  if(name.BeginsWith("asymfam__")) return H->Asym(name.Remove(0,9),true);
+  name.Remove(0,9); // "histfam__"
+  TObject *obj = H->Hist(name,true);
+  if(obj==nullptr) obj = H->Hist4(name,true);
+  return obj;
+};
+
+void HistosStore::EndWrite() {
+  if(indexTr==nullptr) return;
+  file->cd("/");
+  for(auto const &kv : familyTrees) {
+    kv.second->Write();
+    delete kv.second;
+  };
+  indexTr->Write();
+  delete indexTr;
+  indexTr = nullptr;
+  cout << "wrote " << indexOffset << " Histos in consolidated form, "
+       << families.size() << " families" << endl;
+  familyTrees.clear();
+  writeBuffers.clear();
+};
+
+
+// return true if `file` contains consolidated Histos
+Bool_t HistosStore::IsConsolidated(TFile *file) {
+  return file->GetListOfKeys()->FindObject("histosIndex")!=nullptr;
+};
+
+
+// read all Histos from the file
+std::vector<Histos*> HistosStore::ReadAll() {
+  vector<Histos*> histosList;
+  for(std::size_t idx=0; idx<histosNames.size(); idx++) {
+    Histos *H = new Histos(histosNames[idx],histosTitles[idx]);
+    histosList.push_back(H);
+  };
+  // read each family tree sequentially, one entry per Histos
+  for(TString treeName : families) {
+    TTree *famTr = GetFamilyTree(treeName);
+    if(famTr==nullptr) continue;
+    TString name = treeName;
+    Bool_t isMoments = name.BeginsWith("momfam__");
+    Bool_t isAsym = name.BeginsWith("asymfam__");
+    name.Remove(0, isMoments ? 8 : 9); // ("histfam__" and "asymfam__" have the same length)
+    HistConfig *famConfig = (HistConfig*) famTr->GetUserInfo()->FindObject(name);
+    for(std::size_t idx=0; idx<histosList.size(); idx++) {
+      TObject *obj = ReadEntry(treeName,offsetMap.at(histosNames[idx]));
+      if(obj==nullptr) continue;
+      if(isMoments) {
+        histosList[idx]->RegisterMoments(name,(Moments*)obj);
+        continue;
+      };
+      if(isAsym) {
+        histosList[idx]->RegisterAsym(name,(AsymMoments*)obj);
+        continue;
+      };
+      HistConfig *config = famConfig ? (HistConfig*) famConfig->Clone() : new HistConfig();
+      if(obj->InheritsFrom(Hist4D::Class()))
+        histosList[idx]->RegisterHist4(name,(Hist4D*)obj,config);
+      else
+        histosList[idx]->RegisterHist(name,(TH1*)obj,config);
+    };
+  };
+  return histosList;
+};
+
+
+// cheap single-histogram extraction
+TH1 *HistosStore::GetHist(TString histosName, TString varName) {
+  Long64_t offset = GetOffset(histosName);
+  if(offset<0) return nullptr;
+  TObject *obj = ReadEntry("histfam__"+varName,offset);
+  if(obj==nullptr || !obj->InheritsFrom(TH1::Class())) {
+    cerr << "ERROR: no TH1 " << varName << " for Histos " << histosName << endl;
+    return nullptr;
+  };
+  return (TH1*)obj;
+};
+
+Hist4D *HistosStore::GetHist4(TString histosName, TString varName) {
+  Long64_t offset = GetOffset(histosName);
+  if(offset<0) return nullptr;
+  TObject *obj = ReadEntry("histfam__"+varName,offset);
+  if(obj==nullptr || !obj->InheritsFrom(Hist4D::Class())) {
+    cerr << "ERROR: no Hist4D " << varName << " for Histos " << histosName << endl;
+    return nullptr;
+  };
+  return (Hist4D*)obj;
+};
+
+Moments *HistosStore::GetMoments(TString histosName, TString momName) {
+  Long64_t offset = GetOffset(histosName);
+  if(offset<0) return nullptr;
+  TObject *obj = ReadEntry("momfam__"+momName,offset);
+  if(obj==nullptr || !obj->InheritsFrom(Moments::Class())) {
+    cerr << "ERROR: no Moments " << momName << " for Histos " << histosName << endl;
+    return nullptr;
+  };
+  return (Moments*)obj;
+};
+
+AsymMoments *HistosStore::GetAsym(TString histosName, TString asymName) {
+  Long64_t offset = GetOffset(histosName);
+  if(offset<0) return nullptr;
+  TObject *obj = ReadEntry("asymfam__"+asymName,offset);
+  if(obj==nullptr || !obj->InheritsFrom(AsymMoments::Class())) {
+    cerr << "ERROR: no AsymMoments " << asymName << " for Histos " << histosName << endl;
+    return nullptr;
+  };
+  return (AsymMoments*)obj;
+};
+
+
+// offset of a Histos in the family trees
+Long64_t HistosStore::GetOffset(TString histosName) {
+  auto it = offsetMap.find(histosName);
+  if(it==offsetMap.end()) {
+    cerr << "ERROR: Histos " << histosName << " not found in HistosStore" << endl;
+    return -1;
+  };
+  return it->second;
+};
+
+
+// get (and cache) a family tree
+TTree *HistosStore::GetFamilyTree(TString treeName) {
+  auto it = familyTrees.find(treeName);
+  if(it!=familyTrees.end()) return it->second;
+  if(file==nullptr) return nullptr;
+  TTree *famTr = file->Get<TTree>(treeName);
+  if(famTr==nullptr) {
+    cerr << "ERROR: family tree " << treeName << " not found in HistosStore" << endl;
+    return nullptr;
+  };
+  famTr->GetBranch("obj")->SetAddress(&readBuffer);
+  familyTrees.insert(std::pair<TString,TTree*>(treeName,famTr));
+  return famTr;
+};
+
+
+// read one object; a new object is allocated for each call
+TObject *HistosStore::ReadEntry(TString treeName, Long64_t offset) {
+  TTree *famTr = GetFamilyTree(treeName);
+  if(famTr==nullptr) return nullptr;
+  readBuffer = nullptr; // null pointer, so the branch allocates a new object
+  famTr->GetBranch("obj")->GetEntry(offset);
+  TObject *obj = readBuffer;
+  readBuffer = nullptr;
+  if(obj!=nullptr && obj->InheritsFrom(TH1::Class())) ((TH1*)obj)->SetDirectory(nullptr);
+  return obj;
+};
+
+
+HistosStore::~HistosStore() {
+};
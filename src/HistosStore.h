@@ -0,0 +1,89 @@
+#ifndef HistosStore_
+#define HistosStore_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <string>
+
+// ROOT
+#include "TObject.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TList.h"
+#include "TObjString.h"
+
+// sidis-eic
+#include "Histos.h"
+#include "Hist4D.h"
+
+/* consolidated storage of many `Histos` objects in one ROOT file
+ * - instead of one directory per `Histos` and one key per histogram, each
+ *   histogram family (e.g., all "Q2vsX" histograms, across all bins) is stored
+ *   in a single TTree, named `histfam__<varname>`, with one entry per `Histos`;
+ *   moments and asymmetry accumulators are stored likewise, in `momfam__<name>`
+ *   and `asymfam__<name>`
+ * - the TTree `histosIndex` maps each `Histos` name (which encodes the NodePath)
+ *   to its entry number (offset) in every family tree
+ * - extracting a single bin's histogram only reads one entry of one family tree
+ */
+class HistosStore : public TNamed
+{
+  public:
+    HistosStore(TFile *file_=nullptr);
+    ~HistosStore();
+
+    // write a list of Histos to `ofile`, in consolidated form; all Histos must
+    // have the same histogram families (as is the case for a HistosDAG payload);
+    // returns false if any Histos was not written
+    static Bool_t Write(TFile *ofile, std::vector<Histos*> histosList);
+    // incremental writing, one Histos at a time (e.g., from a HistosDAG payload):
+    // call `BeginWrite`, then `Append` for each Histos, then `EndWrite`
+    // - `Append` returns false, and writes nothing, if `H` lacks a family
+    void BeginWrite(TFile *ofile);
+    Bool_t Append(Histos *H);
+    void EndWrite();
+
+    // return true if `file` contains consolidated Histos
+    static Bool_t IsConsolidated(TFile *file);
+
+    // read all Histos from the file
+    std::vector<Histos*> ReadAll();
+
+    // cheap single-histogram extraction; returns a new object owned by the caller
+    // - use `GetHist4` for `Hist4D` families
+    TH1 *GetHist(TString histosName, TString varName);
+    Hist4D *GetHist4(TString histosName, TString varName);
+    Moments *GetMoments(TString histosName, TString momName);
+    AsymMoments *GetAsym(TString histosName, TString asymName);
+
+    // accessors
+    std::vector<TString> GetHistosNames() { return histosNames; };
+    std::vector<TString> GetFamilies() { return families; }; // family tree names
+    Long64_t GetOffset(TString histosName); // returns -1 if not found
+
+  private:
+    TFile *file; //!
+    std::vector<TString> histosNames;
+    std::vector<TString> histosTitles;
+    std::vector<TString> families;
+    std::map<TString,Long64_t> offsetMap;
+    std::map<TString,TTree*> familyTrees; //!
+    TObject *readBuffer; //! branch address for reading family trees
+    std::map<TString,TObject*> writeBuffers; //! branch addresses for writing family trees
+    TTree *indexTr; //!
+    std::string indexName, indexTitle; //!
+    Long64_t indexOffset; //!
+    TTree *GetFamilyTree(TString treeName);
+    TTree *BookFamilyTree(TString treeName, TString treeTitle, TObject *proto);
+    TObject *GetObject(Histos *H, TString treeName);
+    TObject *ReadEntry(TString treeName, Long64_t offset);
+
+  ClassDef(HistosStore,1);
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include "InputMetadata.h"
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
+#include "TROOT.h"
+
+ClassImp(InputMetadata)
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace {
+  std::mutex printMutex; // for printing errors from worker threads
+}
+
+// constructor: load the cache file, if it exists
+InputMetadata::InputMetadata(TString cacheFile_)
+  : modified(false)
+{
+  this->SetName(cacheFile_);
+  Load();
+};
+
+
+// fetch metadata
+Bool_t InputMetadata::Fetch(std::vector<std::string> fileNames, Int_t nThreads) {
+  Int_t nFiles = (Int_t) fileNames.size();
+  if(nFiles==0) return true;
+  if(nThreads<=0) nThreads = (Int_t) std::thread::hardware_concurrency();
+  nThreads = std::max(1, std::min(nThreads,nFiles));
+  if(nThreads>1) ROOT::EnableThreadSafety();
+
+  // workers take the next file, check the cache, and open the file if needed; the
+  // results are merged into `infoMap` afterward, so `infoMap` is only read here
+  std::vector<InputFileInfo> results(nFiles);
+  std::vector<Int_t> status(nFiles,0); // 0=cached, 1=scanned, -1=error
+  std::atomic<Int_t> nextIdx(0);
+  auto worker = [&]() {
+    for(Int_t i=nextIdx++; i<nFiles; i=nextIdx++) {
+      InputFileInfo &info = results[i];
+      info.path = fileNames[i];
+      Bool_t statOK = Stat(info.path,info);
+      auto it = infoMap.find(info.path);
+      if(statOK && it!=infoMap.end() && it->second.size==info.size && it->second.mtime==info.mtime) {
+        status[i] = 0;
+        continue;
+      };
+      status[i] = Scan(info.path,info) ? 1 : -1;
+    };
+  };
+  cout << "reading metadata of " << nFiles << " input files, with " << nThreads << " threads..." << endl;
+  std::vector<std::future<void>> tasks;
+  for(Int_t t=0; t<nThreads; t++) tasks.push_back(std::async(std::launch::async,worker));
+  for(auto &task : tasks) task.get();
+
+  // merge
+  Bool_t success = true;
+  Int_t nCached = 0;
+  for(Int_t i=0; i<nFiles; i++) {
+    if(status[i]<0) { success = false; continue; };
+    if(status[i]==0) { nCached++; continue; };
+    InputFileInfo &info = results[i];
+    infoMap[info.path] = info;
+    if(info.size>=0) modified = true;
+  };
+  cout << "  " << nCached << " from cache " << GetName() << ", "
+       << nFiles-nCached << " opened" << endl;
+  Save();
+  return success;
+};
+
+
+// accessors
+Long64_t InputMetadata::GetEntries(std::string fileName) {
+  auto it = infoMap.find(fileName);
+  return it!=infoMap.end() ? it->second.entries : -1;
+};
+
+
+
+// cache file
+// - format: a header line `cacheHeader`, then one line per file, tab separated
+//   (so that paths may contain spaces):
+//   path size mtime treeName entries numClusters cluster0 cluster1 ...
+// - a cache with another header (e.g., from an older version) is ignored, and
+//   rewritten by the next `Fetch`
+namespace {
+  const std::string cacheHeader = "# sidis-eic input metadata v2: path size mtime treeName entries numClusters clusters... (tab separated)";
+}
+Bool_t InputMetadata::Load() {
+  if(TString(GetName())=="") return false; // cache disabled
+  std::ifstream fin(GetName());
+  if(!fin.is_open()) return false;
+  std::string line;
+  if(!std::getline(fin,line) || line!=cacheHeader) {
+    cerr << "WARNING: ignoring input metadata cache " << GetName() << " of another format" << endl;
+    return false;
+  };
+  while(std::getline(fin,line)) {
+    if(line.empty() || line[0]=='#') continue;
+    std::stringstream ss(line);
+    InputFileInfo info;
+    Long64_t nClusters = 0;
+    std::getline(ss,info.path,'\t');
+    ss >> info.size >> info.mtime;
+    ss.ignore(1,'\t');
+    std::getline(ss,info.treeName,'\t');
+    ss >> info.entries >> nClusters;
+    for(Long64_t c=0; c<nClusters; c++) {
+      Long64_t cluster;
+      ss >> cluster;
+      info.clusters.push_back(cluster);
+    };
+    if(!ss) {
+      cerr << "WARNING: skipping malformed line in input metadata cache " << GetName() << endl;
+      continue;
+    };
+    infoMap[info.path] = info;
+  };
+  return true;
+};
+
+Bool_t InputMetadata::Save() {
+  if(!modified || TString(GetName())=="") return true;
+  gSystem->mkdir(gSystem->DirName(GetName()),true);
+  // write to a temporary file, then rename, so that concurrent runs never read a partial cache
+  TString tmpName = TString::Format("%s.%d.tmp",GetName(),gSystem->GetPid());
+  std::ofstream fout(tmpName.Data());
+  if(!fout.is_open()) {
+    cerr << "WARNING: cannot write input metadata cache " << GetName() << endl;
+    return false;
+  };
+  fout << cacheHeader << endl;
+  for(auto kv : infoMap) {
+    const InputFileInfo &info = kv.second;
+    if(info.size<0) continue; // not cacheable
+    fout << info.path << "\t" << info.size << "\t" << info.mtime << "\t" << info.treeName << "\t"
+         << info.entries << "\t" << info.clusters.size();
+    for(Long64_t cluster : info.clusters) fout << "\t" << cluster;
+    fout << endl;
+  };
+  fout.close();
+  if(gSystem->Rename(tmpName,GetName())!=0) {
+    cerr << "WARNING: cannot write input metadata cache " << GetName() << endl;
+    gSystem->Unlink(tmpName);
+    return false;
+  };
+  modified = false;
+  return true;
+};
+
+
+// read metadata from a file
+Bool_t InputMetadata::Scan(std::string fileName, InputFileInfo &info) {
+  TFile *file = TFile::Open(fileName.c_str());
+  if(file==nullptr || file->IsZombie()) {
+    std::lock_guard<std::mutex> lock(printMutex);
+    cerr << "ERROR: Couldn't open input file '" << fileName << "'" << endl;
+    delete file;
+    return false;
+  };
+  TTree *tree = nullptr;
+  for(TString treeName : {"Delphes","events","event_tree"}) {
+    tree = file->Get<TTree>(treeName);
+    if(tree!=nullptr) break;
+  };
+  if(tree==nullptr) {
+    std::lock_guard<std::mutex> lock(printMutex);
+    cerr << "ERROR: Couldn't find Delphes or events tree in file '" << fileName << "'" << endl;
+    file->Close();
+    delete file;
+    return false;
+  };
+  info.treeName = tree->GetName();
+  info.entries = tree->GetEntries();
+  info.clusters.clear();
+  auto clusterIt = tree->GetClusterIterator(0);
+  Long64_t start;
+  while( (start=clusterIt()) < info.entries ) info.clusters.push_back(start);
+  file->Close();
+  delete file;
+  return true;
+};
+
+Bool_t InputMetadata::Stat(std::string fileName, InputFileInfo &info) {
+  FileStat_t stat;
+  if(gSystem->GetPathInfo(fileName.c_str(),stat)!=0) {
+    info.size = -1;
+    info.mtime = 0;
+    return false;
+  };
+  info.size = stat.fSize;
+  info.mtime = stat.fMtime;
+  return true;
+};
+
+
+InputMetadata::~InputMetadata() {
+};
@@ -0,0 +1,71 @@
+#ifndef InputMetadata_
+#define InputMetadata_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <vector>
+#include <string>
+
+// ROOT
+#include "TObject.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TSystem.h"
+#include "TFile.h"
+#include "TTree.h"
+
+// metadata of one input file
+struct InputFileInfo {
+  std::string path;
+  Long64_t size = -1; // file size, or -1 if unknown (e.g., remote files, which are not cached)
+  Long_t mtime = 0; // modification time
+  std::string treeName = "";
+  Long64_t entries = -1;
+  std::vector<Long64_t> clusters; // first entry of each cluster of the tree
+};
+
+/* metadata of input files (tree name, number of entries, cluster boundaries), with a
+ * persistent sidecar cache, so that input files do not need to be opened again on
+ * later runs
+ * - the cache is a tab-separated text file, with one line per file; an entry is
+ *   valid if the file path, size, and modification time match
+ * - `Fetch` opens the files that are not in the cache, in parallel
+ */
+class InputMetadata : public TNamed
+{
+  public:
+    InputMetadata(TString cacheFile_="out/input_metadata.cache"); // "" disables the cache
+    ~InputMetadata();
+
+    // get metadata for all `fileNames`, from the cache if valid, otherwise by opening
+    // them, using `nThreads` threads (0 for the number of cores); returns false if any
+    // file cannot be read
+    Bool_t Fetch(std::vector<std::string> fileNames, Int_t nThreads=0);
+
+    // accessors, for files already fetched; `GetEntries` returns -1 if not fetched
+    Bool_t Has(std::string fileName) { return infoMap.find(fileName)!=infoMap.end(); };
+    Long64_t GetEntries(std::string fileName);
+    const InputFileInfo &GetInfo(std::string fileName) { return infoMap.at(fileName); };
+
+    // read and write the cache file; `Save` writes only if anything changed, and is
+    // called by `Fetch`
+    Bool_t Load();
+    Bool_t Save();
+
+    // open `fileName` and read its metadata (not including size and mtime)
+    static Bool_t Scan(std::string fileName, InputFileInfo &info);
+    // get size and mtime of `fileName`; returns false if unavailable
+    static Bool_t Stat(std::string fileName, InputFileInfo &info);
+
+  private:
+    std::map<std::string,InputFileInfo> infoMap; //!
+    Bool_t modified;
+
+  ClassDefOverride(InputMetadata,1);
+};
+
+#endif
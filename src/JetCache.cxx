@@ -0,0 +1,192 @@
+#include "JetCache.h"
+
+ClassImp(JetCache)
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// constructor: open (or create) the cache file, and find the keys it already has
+JetCache::JetCache(TString fileName_)
+  : file(nullptr)
+  , numRead(0)
+  , numWritten(0)
+  , readTree(nullptr)
+{
+  this->SetName(fileName_);
+  bJetP4 = new std::vector<Double_t>();
+  bNumConst = new std::vector<Int_t>();
+  bConstP4 = new std::vector<Double_t>();
+  TDirectory::TContext context; // restore the current directory on return
+  file = TFile::Open(fileName_,"UPDATE");
+  if(file==nullptr || file->IsZombie()) {
+    cerr << "ERROR: cannot open jet cache file " << fileName_ << "; jets will not be cached" << endl;
+    file = nullptr;
+    return;
+  };
+  TIter next(file->GetListOfKeys());
+  while(TKey *key = (TKey*) next()) {
+    if(TString(key->GetClassName())!="TTree" || !TString(key->GetName()).BeginsWith("jets_")) continue;
+    TTree *tr = file->Get<TTree>(key->GetName());
+    if(tr==nullptr) continue;
+    trees.insert(std::pair<TString,TTree*>(tr->GetTitle(),tr));
+    readOnly.insert(std::pair<TString,Bool_t>(tr->GetTitle(),true));
+  };
+  cout << "jet cache " << fileName_ << " has " << trees.size() << " cached inputs" << endl;
+};
+
+
+// read
+Bool_t JetCache::IsCached(TString inputID, TString params) {
+  auto it = readOnly.find(KeyName(inputID,params));
+  return it!=readOnly.end() && it->second;
+};
+
+Bool_t JetCache::ReadJets(
+    TString inputID, TString params, Long64_t entry,
+    std::vector<fastjet::PseudoJet> &jetsRec,
+    std::vector<fastjet::PseudoJet> &jetsTrue,
+    Double_t &quarkpT
+    )
+{
+  if(file==nullptr || !IsCached(inputID,params)) return false;
+  TString key = KeyName(inputID,params);
+  TTree *tr = trees.at(key);
+  if(tr->GetEntries()==0) return false;
+
+  // index the input entry numbers, on first use
+  std::map<Long64_t,Long64_t> &index = entryIndex[key];
+  if(index.empty()) {
+    TBranch *br = tr->GetBranch("entry");
+    br->SetAddress(&bEntry);
+    for(Long64_t i=0; i<tr->GetEntries(); i++) {
+      br->GetEntry(i);
+      index.insert(std::pair<Long64_t,Long64_t>(bEntry,i));
+    };
+  };
+  auto it = index.find(entry);
+  if(it==index.end()) return false;
+
+  // read and unpack the jets
+  if(tr!=readTree) {
+    SetAddresses(tr);
+    readTree = tr;
+  };
+  tr->GetEntry(it->second);
+  jetsRec.clear();
+  jetsTrue.clear();
+  Int_t constIdx = 0;
+  Unpack(0, bNumRec, constIdx, jetsRec);
+  Unpack(bNumRec, (Int_t)bNumConst->size(), constIdx, jetsTrue);
+  quarkpT = bQuarkPT;
+  numRead++;
+  return true;
+};
+
+void JetCache::SetAddresses(TTree *tr) {
+  tr->SetBranchAddress("entry",&bEntry);
+  tr->SetBranchAddress("quarkpT",&bQuarkPT);
+  tr->SetBranchAddress("numRec",&bNumRec);
+  tr->SetBranchAddress("jetP4",&bJetP4);
+  tr->SetBranchAddress("numConst",&bNumConst);
+  tr->SetBranchAddress("constP4",&bConstP4);
+};
+
+// build jets `jetBegin` to `jetEnd` from the buffers, starting at constituent `constIdx`
+void JetCache::Unpack(Int_t jetBegin, Int_t jetEnd, Int_t &constIdx, std::vector<fastjet::PseudoJet> &jets) {
+  std::vector<fastjet::PseudoJet> constituents;
+  for(Int_t j=jetBegin; j<jetEnd; j++) {
+    constituents.clear();
+    for(Int_t c=0; c<bNumConst->at(j); c++) {
+      Int_t k = 4*(constIdx++);
+      constituents.push_back(fastjet::PseudoJet(
+            bConstP4->at(k), bConstP4->at(k+1), bConstP4->at(k+2), bConstP4->at(k+3) ));
+    };
+    fastjet::PseudoJet jet = fastjet::join(constituents);
+    jet.reset_momentum( bJetP4->at(4*j), bJetP4->at(4*j+1), bJetP4->at(4*j+2), bJetP4->at(4*j+3) );
+    jets.push_back(jet);
+  };
+};
+
+
+// write
+void JetCache::WriteJets(
+    TString inputID, TString params, Long64_t entry,
+    const std::vector<fastjet::PseudoJet> &jetsRec,
+    const std::vector<fastjet::PseudoJet> &jetsTrue,
+    Double_t quarkpT
+    )
+{
+  if(file==nullptr) return;
+  TString key = KeyName(inputID,params);
+  auto it = trees.find(key);
+  TTree *tr;
+  if(it==trees.end()) tr = BookTree(key);
+  else if(readOnly.at(key)) return;
+  else tr = it->second;
+  bEntry = entry;
+  bQuarkPT = quarkpT;
+  bNumRec = (Int_t) jetsRec.size();
+  bJetP4->clear();
+  bNumConst->clear();
+  bConstP4->clear();
+  Fill(jetsRec);
+  Fill(jetsTrue);
+  tr->Fill();
+  numWritten++;
+};
+
+TTree *JetCache::BookTree(TString key) {
+  TString treeName = TString::Format("jets_%u",key.Hash());
+  while(file->GetKey(treeName)!=nullptr || file->FindObject(treeName)!=nullptr) treeName += "_";
+  TDirectory::TContext context(file);
+  TTree *tr = new TTree(treeName,key);
+  tr->Branch("entry",&bEntry,"entry/L");
+  tr->Branch("quarkpT",&bQuarkPT,"quarkpT/D");
+  tr->Branch("numRec",&bNumRec,"numRec/I");
+  tr->Branch("jetP4",&bJetP4);
+  tr->Branch("numConst",&bNumConst);
+  tr->Branch("constP4",&bConstP4);
+  trees.insert(std::pair<TString,TTree*>(key,tr));
+  readOnly.insert(std::pair<TString,Bool_t>(key,false));
+  return tr;
+};
+
+// append jets to the buffers
+void JetCache::Fill(const std::vector<fastjet::PseudoJet> &jets) {
+  for(const fastjet::PseudoJet &jet : jets) {
+    bJetP4->insert(bJetP4->end(), { jet.px(), jet.py(), jet.pz(), jet.E() });
+    std::vector<fastjet::PseudoJet> constituents;
+    if(jet.has_constituents()) constituents = jet.constituents();
+    bNumConst->push_back((Int_t)constituents.size());
+    for(const fastjet::PseudoJet &c : constituents)
+      bConstP4->insert(bConstP4->end(), { c.px(), c.py(), c.pz(), c.E() });
+  };
+};
+
+
+// close
+void JetCache::Close() {
+  if(file==nullptr) return;
+  TDirectory::TContext context(file);
+  for(auto kv : trees) {
+    if(!readOnly.at(kv.first)) kv.second->Write();
+  };
+  cout << "jet cache " << GetName() << ": read " << numRead
+       << " events, wrote " << numWritten << " events" << endl;
+  file->Close();
+  delete file;
+  file = nullptr;
+  trees.clear();
+  readOnly.clear();
+  entryIndex.clear();
+  readTree = nullptr;
+};
+
+
+JetCache::~JetCache() {
+  Close();
+  delete bJetP4;
+  delete bNumConst;
+  delete bConstP4;
+};
@@ -0,0 +1,96 @@
+#ifndef JetCache_
+#define JetCache_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// ROOT
+#include "TObject.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TKey.h"
+#include "TDirectory.h"
+
+// Fastjet
+#include "fastjet/PseudoJet.hh"
+#include "fastjet/CompositeJetStructure.hh"
+
+/* sidecar cache of clustered jets, so that jet studies do not need to rerun the
+ * clustering for every change of binning or histograms
+ * - the cache is a ROOT file with one TTree per key, where a key is an input file
+ *   ID (its `TUUID`) together with a string of clustering parameters (see
+ *   `Kinematics::JetParams`); each tree entry holds the reconstructed and true jets
+ *   of one event: their 4-momenta, the 4-momenta of their constituents, and the
+ *   struck quark pT
+ * - keys that are already in the file are read-only, and keys that are not are
+ *   written; so the first run fills the cache, and later runs with the same
+ *   parameters read from it
+ * - jets read from the cache are built with `fastjet::join` from their constituents,
+ *   so `constituents()` works, but there is no cluster sequence (e.g., no areas or
+ *   substructure)
+ */
+class JetCache : public TNamed
+{
+  public:
+    JetCache(TString fileName_="jets.cache.root");
+    ~JetCache();
+
+    // read the jets of input `inputID` entry `entry`, clustered with `params`;
+    // returns false if they are not in the cache
+    Bool_t ReadJets(
+        TString inputID, TString params, Long64_t entry,
+        std::vector<fastjet::PseudoJet> &jetsRec,
+        std::vector<fastjet::PseudoJet> &jetsTrue,
+        Double_t &quarkpT
+        );
+    // write the jets of input `inputID` entry `entry`, clustered with `params`;
+    // does nothing if this key was already in the cache when it was opened
+    void WriteJets(
+        TString inputID, TString params, Long64_t entry,
+        const std::vector<fastjet::PseudoJet> &jetsRec,
+        const std::vector<fastjet::PseudoJet> &jetsTrue,
+        Double_t quarkpT
+        );
+
+    // write new trees and close the file; called by the destructor
+    void Close();
+
+    // accessors
+    Bool_t IsCached(TString inputID, TString params); // true if this key can be read
+    Long64_t GetNumRead() { return numRead; };
+    Long64_t GetNumWritten() { return numWritten; };
+
+  private:
+    TFile *file; //!
+    // trees, and whether they were found in the file (read) or are new (write)
+    std::map<TString,TTree*> trees; //!
+    std::map<TString,Bool_t> readOnly; //!
+    // map entry number of the input -> entry number of the tree, for read trees
+    std::map<TString,std::map<Long64_t,Long64_t>> entryIndex; //!
+    Long64_t numRead, numWritten;
+
+    // branch buffers
+    Long64_t bEntry;
+    Double_t bQuarkPT;
+    Int_t bNumRec; // number of reconstructed jets; the rest are true jets
+    std::vector<Double_t> *bJetP4; //! (px,py,pz,E) of each jet
+    std::vector<Int_t> *bNumConst; //! number of constituents of each jet
+    std::vector<Double_t> *bConstP4; //! (px,py,pz,E) of each constituent
+
+    TTree *readTree; //! tree whose branch addresses are set for reading
+
+    static TString KeyName(TString inputID, TString params) { return inputID+"|"+params; };
+    TTree *BookTree(TString key);
+    void SetAddresses(TTree *tr);
+    void Fill(const std::vector<fastjet::PseudoJet> &jets);
+    void Unpack(Int_t jetBegin, Int_t jetEnd, Int_t &constIdx, std::vector<fastjet::PseudoJet> &jets);
+
+  ClassDefOverride(JetCache,1);
+};
+
+#endif
@@ -52,6 +52,7 @@ Kinematics::Kinematics(
   // - boost lab frame -> c.o.m. frame of proton and ion Beams
   BvecBoost = vecEleBeam + vecIonBeam;
   Bboost = -1*BvecBoost.BoostVector();
+  beamComTransform = TLorentzRotation(Bboost);
   // - boost c.o.m. frame of beams -> back to a frame with energies (nearly) the Original beam energies
   OvecBoost.SetXYZT( 0.0, 0.0, BvecBoost[2], BvecBoost[3] );
   Oboost = OvecBoost.BoostVector();
@@ -64,6 +65,13 @@ Kinematics::Kinematics(
   BvecIonBeam.RotateY(rotAboutY);
   // - rotation of beams about x to remove y-components
   rotAboutX = TMath::ATan2( BvecIonBeam.Py(), BvecIonBeam.Pz() );
+  // - compose the full transformation into one matrix, and its inverse
+  //   (`TLorentzRotation::Boost` and `Rotate*` apply the new transformation after the current one)
+  headOnTransform.Boost(Bboost).RotateY(rotAboutY).RotateX(rotAboutX).Boost(Oboost);
+  headOnTransformInv = headOnTransform.Inverse();
+
+  // calculate all observables, by default
+  calcMask = oAll;
 
   // default transverse spin (needed for phiS calculation)
   tSpin = 1; // +1=spin-up, -1=spin-down
@@ -74,8 +82,17 @@ Kinematics::Kinematics(
   polL = 0.;
   polBeam = 0.;
 
-  // random number generator (for asymmetry injection
-  RNG = new TRandomMixMax(91874); // (TODO: fixed seed?)
+  // counter-based random draws (for spins and asymmetry injection)
+  randomSeed = 91874;
+  rngFileID = 0;
+  rngEntry = 0;
+  rngHadron = 0;
+  rngAutoHadron = true;
+  rngAutoEntry = true;
+
+  // jet clustering settings
+  jetR = 0.8;
+  jetStrategy = fastjet::Best;
 
   // reset counters
   countPIDsmeared=countPIDtrue=0;
@@ -201,6 +218,10 @@ Bool_t Kinematics::CalculateDIS(TString recmethod){
 
   reconOK = true;
 
+  // random draws: new event (if not keyed externally), starting from the first hadron
+  if(rngAutoEntry) rngEntry++;
+  if(rngAutoHadron) rngHadron = 0;
+
   // transform to the head-on frame; not needed by all reconstruction methods,
   // but best to make sure this is done up front
   this->TransformToHeadOnFrame(vecEleBeam,HvecEleBeam);
@@ -223,34 +244,67 @@ Bool_t Kinematics::CalculateDIS(TString recmethod){
   // - lab frame -> C.o.m. frame of virtual photon and ion
   CvecBoost = vecQ + vecIonBeam;
   Cboost = -1*CvecBoost.BoostVector();
+  comTransform = TLorentzRotation(Cboost);
   // - lab frame -> Ion rest frame
   IvecBoost = vecIonBeam;
   Iboost = -1*IvecBoost.BoostVector();
+  ionTransform = TLorentzRotation(Iboost);
 
   // calculate depolarization
   // - calculate epsilon, the ratio of longitudinal and transverse photon flux [hep-ph/0611265]
   // - these calculations are Lorentz invariant
-  gamma = 2*ProtonMass()*x / TMath::Sqrt(Q2);
-  epsilon = ( 1 - y - TMath::Power(gamma*y,2)/4 ) /
-    ( 1 - y + y*y/2 + TMath::Power(gamma*y,2)/4 );
-  // - factors A,B,C,V,W (see [hep-ph/0611265] using notation from [1408.5721])
-  depolA = y*y / (2 - 2*epsilon);
-  depolB = depolA * epsilon;
-  depolC = depolA * TMath::Sqrt(1-epsilon*epsilon);
-  depolV = depolA * TMath::Sqrt(2*epsilon*(1+epsilon));
-  depolW = depolA * TMath::Sqrt(2*epsilon*(1-epsilon));
-  // - factor ratios (see [1807.10606] eq. 2.3)
-  if(depolA==0) depolP1=depolP2=depolP3=depolP4=0;
-  else {
-    depolP1 = depolB / depolA;
-    depolP2 = depolC / depolA;
-    depolP3 = depolV / depolA;
-    depolP4 = depolW / depolA;
+  if(calcMask & oDepol) {
+    gamma = 2*ProtonMass()*x / TMath::Sqrt(Q2);
+    epsilon = ( 1 - y - TMath::Power(gamma*y,2)/4 ) /
+      ( 1 - y + y*y/2 + TMath::Power(gamma*y,2)/4 );
+    // - factors A,B,C,V,W (see [hep-ph/0611265] using notation from [1408.5721])
+    depolA = y*y / (2 - 2*epsilon);
+    depolB = depolA * epsilon;
+    depolC = depolA * TMath::Sqrt(1-epsilon*epsilon);
+    depolV = depolA * TMath::Sqrt(2*epsilon*(1+epsilon));
+    depolW = depolA * TMath::Sqrt(2*epsilon*(1-epsilon));
+    // - factor ratios (see [1807.10606] eq. 2.3)
+    if(depolA==0) depolP1=depolP2=depolP3=depolP4=0;
+    else {
+      depolP1 = depolB / depolA;
+      depolP2 = depolC / depolA;
+      depolP3 = depolV / depolA;
+      depolP4 = depolW / depolA;
+    };
   };
 
+  // event-level setup for hadron kinematics
+  this->PrepareEvent();
+
   return reconOK;
 };
 
+
+// event-level setup for `CalculateHadronKinematics`: boost the reference vectors (q,
+// electron, spin) and build the lepton plane once, rather than for every hadron
+// - called at the end of `CalculateDIS`; if you modify `vecQ`, `vecElectron`, or `W`
+//   afterward, call it again
+void Kinematics::PrepareEvent() {
+  Vec4 q4(vecQ);
+  vecIonBeam4 = vecIonBeam;
+  vecW4 = vecW;
+  // boosts
+  CvecQ3 = q4.Transformed(comTransform).Vect();
+  IvecQ3 = q4.Transformed(ionTransform).Vect();
+  Vec3 IvecElectron3 = Vec4(vecElectron).Transformed(ionTransform).Vect();
+  IvecQmag2 = IvecQ3.Dot(IvecQ3);
+  // lepton plane, in ion rest frame
+  IleptonNormal = IvecQ3.Cross(IvecElectron3);
+  // denominators
+  zDenom = vecIonBeam4.Dot(q4);
+  xFnorm = 2 / (W * CvecQ3.Mag());
+  // phiS: calculated in ion rest frame; the spin reference vector is fixed, so this
+  // does not depend on the hadron
+  Vec4 vecSpin4(0,1,0,0); // Pauli-Lubanski pseudovector, in lab frame
+  Vec3 IvecSpin3 = vecSpin4.Transformed(ionTransform).Vect(); // boost to ion rest frame
+  phiSevent = AdjAngle(PlaneAngle(IleptonNormal, IvecQ3, IvecSpin3));
+};
+
 // calculate DIS kinematics using scattered electron
 // - needs `vecElectron` set
 void Kinematics::CalculateDISbyElectron() {
@@ -352,50 +406,199 @@ void Kinematics::CalculateDISbyeSigma(){
 
 
 // calculate hadron kinematics
-// - calculate DIS kinematics first, so we have `vecQ`, etc.
+// - calculate DIS kinematics first, so we have `vecQ`, etc., and the event-level
+//   quantities from `PrepareEvent`
 // - needs `vecHadron` set
+// - only the observable groups in `calcMask` are calculated
 void Kinematics::CalculateHadronKinematics() {
+  if(rngAutoHadron) rngHadron++; // (for random draws, if `SetRandomHadron` is not used)
+  Vec4 h4(vecHadron); // (`Vec4` avoids `TLorentzVector` temporaries below)
   // hadron momentum
-  pLab = vecHadron.P();
-  pTlab = vecHadron.Pt();
-  phiLab = vecHadron.Phi();
-  etaLab = vecHadron.Eta();
+  if(calcMask & oLab) {
+    pLab = h4.P();
+    pTlab = h4.Pt();
+    phiLab = h4.Phi();
+    etaLab = h4.Eta();
+  };
   // hadron z
-  z = vecIonBeam.Dot(vecHadron) / vecIonBeam.Dot(vecQ);
+  if(calcMask & oZ) z = vecIonBeam4.Dot(h4) / zDenom;
   // missing mass
-  mX = (vecW-vecHadron).M(); // missing mass
-  // boosts
-  this->BoostToComFrame(vecHadron,CvecHadron);
-  this->BoostToComFrame(vecQ,CvecQ);
-  this->BoostToIonFrame(vecHadron,IvecHadron);
-  this->BoostToIonFrame(vecQ,IvecQ);
-  this->BoostToIonFrame(vecElectron,IvecElectron);
+  if(calcMask & oMX) mX = (vecW4-h4).M(); // missing mass
   // feynman-x: calculated in photon+ion c.o.m. frame
-  xF = 2 * CvecHadron.Vect().Dot(CvecQ.Vect()) /
-      (W * CvecQ.Vect().Mag());
-  // phiH: calculated in ion rest frame
-  phiH = AdjAngle(PlaneAngle(
-      IvecQ.Vect(), IvecElectron.Vect(),
-      IvecQ.Vect(), IvecHadron.Vect()
-      ));
-  // phiS: calculated in ion rest frame
-  tSpin = RNG->Uniform() < 0.5 ? 1 : -1;
-  lSpin = RNG->Uniform() < 0.5 ? 1 : -1;
-  vecSpin.SetXYZT(0,1,0,0); // Pauli-Lubanski pseudovector, in lab frame
-  this->BoostToIonFrame(vecSpin,IvecSpin); // boost to ion rest frame
-  phiS = AdjAngle(PlaneAngle(
-      IvecQ.Vect(), IvecElectron.Vect(),
-      IvecQ.Vect(), IvecSpin.Vect()
-      ));
-  // pT, in perp frame (transverse to q): calculated in ion rest frame
-  pT = Reject(
-      IvecHadron.Vect(),
-      IvecQ.Vect()
-      ).Mag();
+  if(calcMask & oXF) {
+    Vec3 CvecHadron3 = h4.Transformed(comTransform).Vect();
+    xF = CvecHadron3.Dot(CvecQ3) * xFnorm;
+  };
+  if(calcMask & (oPhiH|oPT)) {
+    Vec3 IvecHadron3 = h4.Transformed(ionTransform).Vect();
+    // phiH: calculated in ion rest frame
+    if(calcMask & oPhiH) phiH = AdjAngle(PlaneAngle(IleptonNormal, IvecQ3, IvecHadron3));
+    // pT, in perp frame (transverse to q): calculated in ion rest frame
+    if(calcMask & oPT) pT = Reject(IvecHadron3,IvecQ3).Mag();
+  };
+  // phiS: calculated in ion rest frame (see `PrepareEvent`)
+  if(calcMask & oSpin) {
+    Double_t uT, uL;
+    this->RandomUniform2(sSpin,uT,uL);
+    tSpin = uT < 0.5 ? 1 : -1;
+    lSpin = uL < 0.5 ? 1 : -1;
+  };
+  if(calcMask & oPhiS) phiS = phiSevent;
   // qT
-  qT = pT / z;
+  if((calcMask & oPT) && (calcMask & oZ)) qT = pT / z;
 };
 
+// batch hadron kinematics: same as `CalculateHadronKinematics`, for all hadrons `in`
+// - the first loop only has arithmetic and square roots, so that the compiler can
+//   vectorize it (build with optimization, see `OPTIMIZE` in `config.mk`); the
+//   transcendental functions are in a second loop
+void Kinematics::CalculateHadronKinematicsBatch(const HadronSoA &in, HadronObsSoA &out) {
+  const Int_t n = (Int_t) in.size();
+  out.resize(n);
+  batchSign.resize(n);
+  // inputs
+  const Double_t *px = in.px.data();
+  const Double_t *py = in.py.data();
+  const Double_t *pz = in.pz.data();
+  const Double_t *E  = in.E.data();
+  // outputs
+  Double_t *oPLab  = out.pLab.data();
+  Double_t *oPTlab = out.pTlab.data();
+  Double_t *oZ     = out.z.data();
+  Double_t *oPT    = out.pT.data();
+  Double_t *oQT    = out.qT.data();
+  Double_t *oMX    = out.mX.data();
+  Double_t *oXF    = out.xF.data();
+  Double_t *oCos   = out.phiH.data(); // cos(phiH), until the second loop
+  Double_t *oSign  = batchSign.data(); // sign of phiH; 0 if `PlaneAngle` would fail
+  // event-level constants, copied to locals
+  const Double_t PE=vecIonBeam.E(), Px=vecIonBeam.Px(), Py=vecIonBeam.Py(), Pz=vecIonBeam.Pz();
+  const Double_t WE=vecW.E(), Wx=vecW.Px(), Wy=vecW.Py(), Wz=vecW.Pz();
+  const Double_t zDen = zDenom, xFn = xFnorm, q2 = IvecQmag2;
+  const Double_t qx=IvecQ3.X(), qy=IvecQ3.Y(), qz=IvecQ3.Z();
+  const Double_t cqx=CvecQ3.X(), cqy=CvecQ3.Y(), cqz=CvecQ3.Z();
+  const Double_t nx=IleptonNormal.X(), ny=IleptonNormal.Y(), nz=IleptonNormal.Z();
+  const Double_t nMag = IleptonNormal.Mag();
+  const Bool_t rejectOK = fabs(q2)>=0.0001;
+  const Double_t invQ2 = rejectOK ? 1/q2 : 0;
+  // ion rest frame and photon+ion c.o.m. frame boosts (spatial rows only)
+  const Double_t Ixx=ionTransform.XX(), Ixy=ionTransform.XY(), Ixz=ionTransform.XZ(), Ixt=ionTransform.XT();
+  const Double_t Iyx=ionTransform.YX(), Iyy=ionTransform.YY(), Iyz=ionTransform.YZ(), Iyt=ionTransform.YT();
+  const Double_t Izx=ionTransform.ZX(), Izy=ionTransform.ZY(), Izz=ionTransform.ZZ(), Izt=ionTransform.ZT();
+  const Double_t Cxx=comTransform.XX(), Cxy=comTransform.XY(), Cxz=comTransform.XZ(), Cxt=comTransform.XT();
+  const Double_t Cyx=comTransform.YX(), Cyy=comTransform.YY(), Cyz=comTransform.YZ(), Cyt=comTransform.YT();
+  const Double_t Czx=comTransform.ZX(), Czy=comTransform.ZY(), Czz=comTransform.ZZ(), Czt=comTransform.ZT();
+
+  // vectorizable loop
+  for(Int_t i=0; i<n; i++) {
+    const Double_t hx=px[i], hy=py[i], hz=pz[i], he=E[i];
+    // lab frame
+    const Double_t pT2lab = hx*hx + hy*hy;
+    oPTlab[i] = std::sqrt(pT2lab);
+    oPLab[i] = std::sqrt(pT2lab + hz*hz);
+    // z and missing mass
+    oZ[i] = (PE*he - Px*hx - Py*hy - Pz*hz) / zDen;
+    const Double_t mx=WE-he, mxx=Wx-hx, mxy=Wy-hy, mxz=Wz-hz;
+    const Double_t mm = mx*mx - mxx*mxx - mxy*mxy - mxz*mxz;
+    oMX[i] = mm<0 ? -std::sqrt(-mm) : std::sqrt(mm);
+    // boosts
+    const Double_t ix = Ixx*hx + Ixy*hy + Ixz*hz + Ixt*he;
+    const Double_t iy = Iyx*hx + Iyy*hy + Iyz*hz + Iyt*he;
+    const Double_t iz = Izx*hx + Izy*hy + Izz*hz + Izt*he;
+    const Double_t cx = Cxx*hx + Cxy*hy + Cxz*hz + Cxt*he;
+    const Double_t cy = Cyx*hx + Cyy*hy + Cyz*hz + Cyt*he;
+    const Double_t cz = Czx*hx + Czy*hy + Czz*hz + Czt*he;
+    // feynman-x
+    oXF[i] = (cx*cqx + cy*cqy + cz*cqz) * xFn;
+    // pT, transverse to q
+    const Double_t f = (ix*qx + iy*qy + iz*qz) * invQ2;
+    const Double_t rx=ix-f*qx, ry=iy-f*qy, rz=iz-f*qz;
+    oPT[i] = rejectOK ? std::sqrt(rx*rx + ry*ry + rz*rz) : 0.;
+    oQT[i] = oPT[i] / oZ[i];
+    // phiH: angle between lepton plane (normal n) and hadron plane (normal q x h)
+    const Double_t hnx = qy*iz - qz*iy;
+    const Double_t hny = qz*ix - qx*iz;
+    const Double_t hnz = qx*iy - qy*ix;
+    const Double_t sgn = nx*ix + ny*iy + nz*iz;
+    const Double_t numer = nx*hnx + ny*hny + nz*hnz;
+    const Double_t denom = nMag * std::sqrt(hnx*hnx + hny*hny + hnz*hnz);
+    const Bool_t planeOK = fabs(sgn)>=0.00001 && fabs(denom)>=0.00001;
+    oCos[i] = planeOK ? numer/denom : 0.;
+    oSign[i] = planeOK ? (sgn>0 ? 1. : -1.) : 0.;
+  };
+
+  // transcendental functions
+  for(Int_t i=0; i<n; i++) {
+    out.phiH[i] = oSign[i]!=0 ? oSign[i] * TMath::ACos(oCos[i]) : AdjAngle(-10000);
+    out.phiS[i] = phiSevent;
+    out.phiLab[i] = (px[i]==0 && py[i]==0) ? 0. : TMath::ATan2(py[i],px[i]);
+    // pseudorapidity, as in `TVector3::PseudoRapidity`
+    const Double_t cosTheta = oPLab[i]==0 ? 1. : pz[i]/oPLab[i];
+    if(cosTheta*cosTheta < 1) out.etaLab[i] = -0.5 * TMath::Log( (1.0-cosTheta)/(1.0+cosTheta) );
+    else if(pz[i]==0) out.etaLab[i] = 0;
+    else out.etaLab[i] = pz[i]>0 ? 10e10 : -10e10;
+  };
+};
+
+// copy the observables of hadron `i` of a batch, for the groups in `calcMask`
+void Kinematics::SetHadronKinematics(const HadronObsSoA &obs, std::size_t i) {
+  if(rngAutoHadron) rngHadron++; // (for random draws, if `SetRandomHadron` is not used)
+  if(calcMask & oLab) {
+    pLab = obs.pLab[i];
+    pTlab = obs.pTlab[i];
+    phiLab = obs.phiLab[i];
+    etaLab = obs.etaLab[i];
+  };
+  if(calcMask & oZ) z = obs.z[i];
+  if(calcMask & oMX) mX = obs.mX[i];
+  if(calcMask & oXF) xF = obs.xF[i];
+  if(calcMask & oPhiH) phiH = obs.phiH[i];
+  if(calcMask & oPT) pT = obs.pT[i];
+  if(calcMask & oSpin) {
+    Double_t uT, uL;
+    this->RandomUniform2(sSpin,uT,uL);
+    tSpin = uT < 0.5 ? 1 : -1;
+    lSpin = uL < 0.5 ? 1 : -1;
+  };
+  if(calcMask & oPhiS) phiS = obs.phiS[i];
+  if((calcMask & oPT) && (calcMask & oZ)) qT = obs.qT[i];
+};
+
+
+// validate `CalculateHadronKinematicsBatch` against `CalculateHadronKinematics`
+Bool_t Kinematics::ValidateHadronKinematicsBatch(const HadronSoA &in, Double_t tolerance) {
+  HadronObsSoA out;
+  this->CalculateHadronKinematicsBatch(in,out);
+  TLorentzVector vecHadronSave = vecHadron;
+  UInt_t calcMaskSave = calcMask;
+  calcMask = oAll; // the batch version calculates all observables
+  Double_t maxDiff = 0;
+  for(std::size_t i=0; i<in.size(); i++) {
+    vecHadron = in.P4(i);
+    this->CalculateHadronKinematics();
+    Double_t scalar[] = { pLab, pTlab, phiLab, etaLab, z, pT, qT, mX, xF, phiH, phiS };
+    Double_t batch[] = {
+      out.pLab[i], out.pTlab[i], out.phiLab[i], out.etaLab[i], out.z[i], out.pT[i],
+      out.qT[i], out.mX[i], out.xF[i], out.phiH[i], out.phiS[i]
+    };
+    for(int v=0; v<11; v++) {
+      if(isnan(scalar[v]) && isnan(batch[v])) continue;
+      Double_t diff = TMath::Abs(batch[v]-scalar[v]) / TMath::Max(1.0,TMath::Abs(scalar[v]));
+      if(!(diff<=maxDiff)) maxDiff = diff; // (also catches NaN)
+    };
+  };
+  vecHadron = vecHadronSave;
+  SetCalcMask(calcMaskSave);
+  cout << "max. relative difference of batch vs. scalar hadron kinematics: " << maxDiff
+       << " (" << in.size() << " hadrons)" << endl;
+  if(!(maxDiff<=tolerance)) {
+    cerr << "ERROR: batch hadron kinematics do not match scalar hadron kinematics" << endl;
+    return false;
+  };
+  return true;
+};
+
+
 // validate transformations to the head-on frame
 void Kinematics::ValidateHeadOnFrame() {
   this->BoostToIonFrame(vecEleBeam,IvecEleBeam);
@@ -420,6 +623,33 @@ void Kinematics::ValidateHeadOnFrame() {
   printf("lab hadron:     "); vecHadron.Print();
   printf("head-on hadron: "); HvecHadron.Print();
   printf("difference:     "); (vecHadron-HvecHadron).Print();
+  // compare the composed matrix to the chained boosts and rotations, and check
+  // the batch transformation and the inverse
+  printf("---\n");
+  TLorentzVector labVecs[4] = { vecEleBeam, vecIonBeam, vecElectron, vecHadron };
+  Double_t batch[16];
+  for(int i=0; i<4; i++) {
+    batch[4*i]   = labVecs[i].Px();
+    batch[4*i+1] = labVecs[i].Py();
+    batch[4*i+2] = labVecs[i].Pz();
+    batch[4*i+3] = labVecs[i].E();
+  };
+  this->TransformToHeadOnFrame(4,batch,batch);
+  Double_t maxDiff = 0;
+  for(int i=0; i<4; i++) {
+    TLorentzVector chained, composed, back;
+    this->TransformToHeadOnFrameChained(labVecs[i],chained);
+    this->TransformToHeadOnFrame(labVecs[i],composed);
+    this->TransformBackToLabFrame(composed,back);
+    for(int c=0; c<4; c++) {
+      Double_t scale = TMath::Max(1.0,TMath::Abs(chained[c]));
+      maxDiff = TMath::Max(maxDiff, TMath::Abs(composed[c]-chained[c])/scale);
+      maxDiff = TMath::Max(maxDiff, TMath::Abs(batch[4*i+c]-chained[c])/scale);
+      maxDiff = TMath::Max(maxDiff, TMath::Abs(back[c]-labVecs[i][c])/scale);
+    };
+  };
+  printf("max. relative difference of matrix vs. chained transformations: %g\n",maxDiff);
+  if(maxDiff>1e-12) cerr << "ERROR: head-on frame transformation matrix does not match chained transformations" << endl;
 };
 
 
@@ -587,12 +817,15 @@ void Kinematics::ResetHFS() {
 
 // add a 4-momentum to the hadronic final state
 void Kinematics::AddToHFS(TLorentzVector p4_) {
-  TLorentzVector p4 = p4_;
-  if(mainFrame==fHeadOn) this->TransformToHeadOnFrame(p4,p4);
+  this->AddToHFS(Vec4(p4_));
+};
+
+void Kinematics::AddToHFS(const Vec4 &p4_) {
+  Vec4 p4 = mainFrame==fHeadOn ? p4_.Transformed(headOnTransform) : p4_;
   sigmah += (p4.E() - p4.Pz());
   Pxh += p4.Px();
   Pyh += p4.Py();
-  hadronSumVec += p4;
+  hadronSumVec += TLorentzVector(p4);
   countHadrons++;
 };
 
@@ -640,8 +873,10 @@ void Kinematics::GetJets(
     }
   }
 
-  std::vector<fastjet::PseudoJet> particles;
-  std::vector<fastjet::PseudoJet> particlesTrue;
+  std::vector<fastjet::PseudoJet> &particles = jetInputRec;
+  std::vector<fastjet::PseudoJet> &particlesTrue = jetInputTrue;
+  particles.clear();
+  particlesTrue.clear();
   jetConstituents.clear();
   // looping over final state particles, adding to particles vector
   while(Track *eflowTrack = (Track*)itEFlowTrack() ){
@@ -697,14 +932,32 @@ void Kinematics::GetJets(
   }
 
   //double R = 0.8*(M_PI/2.0);
-  double R = 0.8;
-  fastjet::JetDefinition jet_def(fastjet::antikt_algorithm, R);
+  fastjet::JetDefinition jet_def(fastjet::antikt_algorithm, jetR, (fastjet::Strategy)jetStrategy);
+
+  this->ClusterJets(jet_def);
+  jetsRec = sorted_by_pt(csRec->inclusive_jets());
+  jetsTrue = sorted_by_pt(csTrue->inclusive_jets());
+
+};
+
+
+// clustering parameters; increment the version if the jet input selection changes
+TString Kinematics::JetParams(Bool_t breit) {
+  return TString::Format("v1 %s R=%g strategy=%d eleBeam=(%g,%g,%g,%g) ionBeam=(%g,%g,%g,%g)",
+      breit ? "centauro" : "antikt",
+      jetR, breit ? -1 : jetStrategy,
+      vecEleBeam.Px(), vecEleBeam.Py(), vecEleBeam.Pz(), vecEleBeam.E(),
+      vecIonBeam.Px(), vecIonBeam.Py(), vecIonBeam.Pz(), vecIonBeam.E()
+      );
+};
 
-  csRec = fastjet::ClusterSequence(particles, jet_def);
-  csTrue = fastjet::ClusterSequence(particlesTrue, jet_def);
-  jetsRec = sorted_by_pt(csRec.inclusive_jets());
-  jetsTrue = sorted_by_pt(csTrue.inclusive_jets());
 
+// cluster `jetInputRec` and `jetInputTrue` into `csRec` and `csTrue`
+// - the previous event's cluster sequences are deleted; jets from them can no longer
+//   be used to access constituents
+void Kinematics::ClusterJets(const fastjet::JetDefinition &jetDef) {
+  csRec.reset(new fastjet::ClusterSequence(jetInputRec, jetDef));
+  csTrue.reset(new fastjet::ClusterSequence(jetInputTrue, jetDef));
 };
 
 
@@ -718,8 +971,10 @@ void Kinematics::GetBreitFrameJets(
   itEFlowPhoton.Reset();
   itEFlowNeutralHadron.Reset();
   itParticle.Reset();
-  std::vector<fastjet::PseudoJet> particles;
-  std::vector<fastjet::PseudoJet> particlesTrue;
+  std::vector<fastjet::PseudoJet> &particles = jetInputRec;
+  std::vector<fastjet::PseudoJet> &particlesTrue = jetInputTrue;
+  particles.clear();
+  particlesTrue.clear();
 
   jetConstituents.clear();
 
@@ -741,18 +996,20 @@ void Kinematics::GetBreitFrameJets(
   TLorentzVector breitVec = vecQ + 2*x*vecIonBeam;
   TVector3 breitBoostTrue = -1*breitVecTrue.BoostVector();
   TVector3 breitBoost = -1*breitVec.BoostVector();
+  TLorentzRotation breitTransformTrue(breitBoostTrue);
+  TLorentzRotation breitTransform(breitBoost);
   itParticle.Reset();
 
   while(Track *eflowTrack = (Track*)itEFlowTrack() ){
     TLorentzVector eflowTrackp4 = eflowTrack->P4();
     if(!isnan(eflowTrackp4.E()) && eflowTrackp4 != vecElectron){
       if(std::abs(eflowTrack->Eta) < 4.0 && eflowTrack->PT > 0.2){
-        eflowTrackp4.Boost(breitBoost);
+        eflowTrackp4.Transform(breitTransform);
         particles.push_back(fastjet::PseudoJet(eflowTrackp4.Px(),eflowTrackp4.Py(),eflowTrackp4.Pz(),eflowTrackp4.E()));
 
         GenParticle *trackParticle = (GenParticle*)eflowTrack->Particle.GetObject();
         TLorentzVector partp4 = trackParticle->P4();
-        partp4.Boost(breitBoostTrue);
+        partp4.Transform(breitTransformTrue);
         particlesTrue.push_back(fastjet::PseudoJet(partp4.Px(),partp4.Py(),partp4.Pz(),partp4.E()));
 
         jetConstituents.insert(std::pair<double,int>(eflowTrackp4.Px(), eflowTrack->PID) );
@@ -767,13 +1024,13 @@ void Kinematics::GetBreitFrameJets(
           sqrt(towerPhotonp4.Px()*towerPhotonp4.Px()+towerPhotonp4.Py()*towerPhotonp4.Py()) > 0.2
           )
       {
-        towerPhotonp4.Boost(breitBoost);
+        towerPhotonp4.Transform(breitTransform);
         particles.push_back(fastjet::PseudoJet(towerPhotonp4.Px(),towerPhotonp4.Py(),towerPhotonp4.Pz(),towerPhotonp4.E()));
 
         for(int i = 0; i < towerPhoton->Particles.GetEntries(); i++){
           GenParticle *photonPart = (GenParticle*)towerPhoton->Particles.At(i);
           TLorentzVector photonp4 = photonPart->P4();
-          photonp4.Boost(breitBoostTrue);
+          photonp4.Transform(breitTransformTrue);
           particlesTrue.push_back(fastjet::PseudoJet(photonp4.Px(),photonp4.Py(),photonp4.Pz(),photonp4.E()));
         }
       }
@@ -786,7 +1043,7 @@ void Kinematics::GetBreitFrameJets(
         )
     {
       if( std::abs(towerNeutralHadron->Eta) < 4.0 ){
-        towerNeutralHadronp4.Boost(breitBoost);
+        towerNeutralHadronp4.Transform(breitTransform);
         particles.push_back(
             fastjet::PseudoJet(towerNeutralHadronp4.Px(),towerNeutralHadronp4.Py(),towerNeutralHadronp4.Pz(),towerNeutralHadronp4.E())
           );
@@ -794,21 +1051,19 @@ void Kinematics::GetBreitFrameJets(
         for(int i = 0; i < towerNeutralHadron->Particles.GetEntries(); i++){
           GenParticle *nhadPart = (GenParticle*)towerNeutralHadron->Particles.At(i);
           TLorentzVector nhadp4 = nhadPart->P4();
-          nhadp4.Boost(breitBoostTrue);
+          nhadp4.Transform(breitTransformTrue);
           particlesTrue.push_back(fastjet::PseudoJet(nhadp4.Px(),nhadp4.Py(),nhadp4.Pz(),nhadp4.E()));
         }
       }
     }
   }
 
-  double R = 0.8;
-  contrib::CentauroPlugin centauroPlugin(R);
+  contrib::CentauroPlugin centauroPlugin(jetR);
   fastjet::JetDefinition jet_def(&centauroPlugin);
 
-  csRec = fastjet::ClusterSequence(particles, jet_def);
-  csTrue = fastjet::ClusterSequence(particlesTrue, jet_def);
-  breitJetsRec = sorted_by_pt(csRec.inclusive_jets());
-  breitJetsTrue = sorted_by_pt(csTrue.inclusive_jets());
+  this->ClusterJets(jet_def);
+  breitJetsRec = sorted_by_pt(csRec->inclusive_jets());
+  breitJetsTrue = sorted_by_pt(csTrue->inclusive_jets());
 };
 
 
@@ -908,37 +1163,129 @@ void Kinematics::CalculateJetKinematics(fastjet::PseudoJet jet){
 
 // boost from Lab frame `Lvec` to photon+ion C.o.m. frame `Cvec`
 void Kinematics::BoostToComFrame(TLorentzVector Lvec, TLorentzVector &Cvec) {
-  Cvec=Lvec;
-  Cvec.Boost(Cboost);
+  Cvec = comTransform * Lvec;
 };
 
 // boost from Lab frame `Lvec` to Ion rest frame `Ivec`
 void Kinematics::BoostToIonFrame(TLorentzVector Lvec, TLorentzVector &Ivec) {
-  Ivec=Lvec;
-  Ivec.Boost(Iboost);
+  Ivec = ionTransform * Lvec;
 };
 
 // boost from Lab frame `Lvec` to ion+electron Beam c.o.m. frame `Bvec`
 void Kinematics::BoostToBeamComFrame(TLorentzVector Lvec, TLorentzVector &Bvec) {
-  Bvec=Lvec;
-  Bvec.Boost(Bboost);
+  Bvec = beamComTransform * Lvec;
 };
 
 // transform from Lab frame `Lvec` to Head-on frame `Hvec`
+// - the boosts and rotations of `TransformToHeadOnFrameChained` are composed into
+//   `headOnTransform` in the constructor
 void Kinematics::TransformToHeadOnFrame(TLorentzVector Lvec, TLorentzVector &Hvec) {
-  this->BoostToBeamComFrame(Lvec,Hvec); // boost to c.o.m. frame of beams
+  Hvec = headOnTransform * Lvec;
+};
+
+// transform from Head-on frame `Hvec` back to Lab frame `Lvec`
+void Kinematics::TransformBackToLabFrame(TLorentzVector Hvec, TLorentzVector &Lvec) {
+  Lvec = headOnTransformInv * Hvec;
+};
+
+// reference transformation from Lab frame `Lvec` to Head-on frame `Hvec`
+void Kinematics::TransformToHeadOnFrameChained(TLorentzVector Lvec, TLorentzVector &Hvec) {
+  Hvec=Lvec;
+  Hvec.Boost(Bboost); // boost to c.o.m. frame of beams
   Hvec.RotateY(rotAboutY); // remove x-component of beams
   Hvec.RotateX(rotAboutX); // remove y-component of beams
   Hvec.Boost(Oboost); // return to frame where beam energies are (nearly) the original
 };
 
-// transform from Head-on frame `Hvec` back to Lab frame `Lvec`
-void Kinematics::TransformBackToLabFrame(TLorentzVector Hvec, TLorentzVector &Lvec) {
-  Lvec=Hvec;
-  Lvec.Boost(-1*Oboost); // revert boosts and rotations
-  Lvec.RotateX(-rotAboutX);
-  Lvec.RotateY(-rotAboutY);
-  Lvec.Boost(-1*Bboost); // boost from c.o.m. frame of beams back to lab frame
+// batch transformation of `n` 4-momenta (px,py,pz,E), by the matrix `L`
+void Kinematics::ApplyTransform(const TLorentzRotation &L, Int_t n, const Double_t *in, Double_t *out) {
+  // copy the matrix elements to locals, so the loop does not reload them
+  const Double_t xx=L.XX(), xy=L.XY(), xz=L.XZ(), xt=L.XT();
+  const Double_t yx=L.YX(), yy=L.YY(), yz=L.YZ(), yt=L.YT();
+  const Double_t zx=L.ZX(), zy=L.ZY(), zz=L.ZZ(), zt=L.ZT();
+  const Double_t tx=L.TX(), ty=L.TY(), tz=L.TZ(), tt=L.TT();
+  for(Int_t i=0; i<n; i++) {
+    const Double_t px=in[4*i], py=in[4*i+1], pz=in[4*i+2], e=in[4*i+3];
+    out[4*i]   = xx*px + xy*py + xz*pz + xt*e;
+    out[4*i+1] = yx*px + yy*py + yz*pz + yt*e;
+    out[4*i+2] = zx*px + zy*py + zz*pz + zt*e;
+    out[4*i+3] = tx*px + ty*py + tz*pz + tt*e;
+  };
+};
+
+
+// set the observable groups to calculate; the others are reset, since they are no
+// longer updated
+void Kinematics::SetCalcMask(UInt_t mask) {
+  calcMask = mask;
+  const Double_t nan = TMath::QuietNaN();
+  if(!(calcMask & oDepol)) {
+    gamma = epsilon = nan;
+    depolA = depolB = depolC = depolV = depolW = nan;
+    depolP1 = depolP2 = depolP3 = depolP4 = nan;
+  };
+  if(!(calcMask & oLab)) pLab = pTlab = phiLab = etaLab = nan;
+  if(!(calcMask & oZ)) z = nan;
+  if(!(calcMask & oMX)) mX = nan;
+  if(!(calcMask & oXF)) xF = nan;
+  if(!(calcMask & oPhiH)) phiH = nan;
+  if(!(calcMask & oPhiS)) phiS = nan;
+  if(!(calcMask & oPT)) pT = nan;
+  if(!((calcMask & oPT) && (calcMask & oZ))) qT = nan;
+  if(!(calcMask & oSpin)) tSpin = lSpin = 0;
+};
+
+// observable dependencies, for demand-driven evaluation
+// - keys are the names used by bin schemes and `valueMap` (see `Analysis`), the
+//   `Kinematics` member names, and the `SimpleTree` branch names
+UInt_t Kinematics::ObservableDeps(TString obsName) {
+  static const std::map<TString,UInt_t> depsMap = {
+    // DIS
+    {"x",oDIS},    {"X",oDIS},
+    {"q2",oDIS},   {"Q2",oDIS},    {"QSq",oDIS},
+    {"w",oDIS},    {"W",oDIS},
+    {"y",oDIS},    {"Y",oDIS},
+    {"Nu",oDIS},
+    // depolarization
+    {"gamma",oDepol},   {"epsilon",oDepol},
+    {"depolA",oDepol},  {"depolB",oDepol},  {"depolC",oDepol},
+    {"depolV",oDepol},  {"depolW",oDepol},
+    {"depolP1",oDepol}, {"depolP2",oDepol}, {"depolP3",oDepol}, {"depolP4",oDepol},
+    {"Depol1",oDepol},  {"Depol2",oDepol},  {"Depol3",oDepol},  {"Depol4",oDepol},
+    // single hadron
+    {"p",oLab},     {"pLab",oLab},
+    {"eta",oLab},   {"etaLab",oLab},
+    {"ptLab",oLab}, {"pTlab",oLab},
+    {"phiLab",oLab},
+    {"z",oZ},       {"Z",oZ},
+    {"pt",oPT},     {"pT",oPT},      {"PhPerp",oPT},
+    {"qT",oPT|oZ},  {"qTq",oPT|oZ},
+    {"mX",oMX},     {"MX",oMX},
+    {"xF",oXF},
+    {"phiH",oPhiH}, {"PhiH",oPhiH},
+    {"phiS",oPhiS}, {"PhiS",oPhiS},
+    {"tSpin",oSpin},{"Spin_idx",oSpin},
+    {"lSpin",oSpin},{"SpinL_idx",oSpin},
+    // not calculated (set externally, or by the analysis)
+    {"polT",oDIS},  {"PolT",oDIS},
+    {"polL",oDIS},  {"PolL",oDIS},
+    {"polBeam",oDIS}, {"PolB",oDIS},
+    {"hadPID",oDIS}, {"HadPID",oDIS},
+    {"Weight",oDIS},
+    // jets (calculated by `CalculateJetKinematics`)
+    {"ptJet",oDIS}, {"zJet",oDIS}
+  };
+  auto it = depsMap.find(obsName);
+  return it!=depsMap.end() ? it->second : (UInt_t)oAll;
+};
+
+TString Kinematics::ObservableGroups(UInt_t mask) {
+  const TString groupNames[] = { "depol", "lab", "z", "mX", "xF", "phiH", "phiS", "pT", "spin" };
+  TString ret = "DIS";
+  for(Int_t b=0; b<9; b++) {
+    if(mask & (1<<b)) ret += ", " + groupNames[b];
+  };
+  return ret;
 };
 
 
@@ -959,11 +1306,29 @@ void Kinematics::InjectFakeAsymmetry() {
   // apply polarization
   asymInject *= polT;
   // generate random number in [0,1]
-  RN = RNG->Uniform();
+  Double_t unused;
+  this->RandomUniform2(sInject,RN,unused);
   tSpin = (RN<0.5*(1+asymInject)) ? 1 : -1;
 };
 
 
+// counter-based random draws
+// - key: (seed, file ID); counter: (entry, hadron index, stream)
+void Kinematics::SetRandomKey(UInt_t fileID, Long64_t entry) {
+  rngFileID = fileID;
+  rngEntry = entry;
+  rngAutoEntry = false;
+};
+
+// two uniform random numbers for the current hadron and `stream`
+void Kinematics::RandomUniform2(UInt_t stream, Double_t &u0, Double_t &u1) {
+  Philox::Uniform2(
+      { (uint32_t)rngEntry, (uint32_t)((ULong64_t)rngEntry>>32), rngHadron, stream },
+      { randomSeed, rngFileID },
+      u0, u1 );
+};
+
+
 Kinematics::~Kinematics() {
 };
 
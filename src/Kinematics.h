@@ -10,6 +10,7 @@
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
+#include <memory>
 
 // ROOT
 #include "TSystem.h"
@@ -19,9 +20,15 @@
 #include "TH1.h"
 #include "TMath.h"
 #include "TLorentzVector.h"
+#include "TLorentzRotation.h"
 #include "TRandom.h"
 #include "TRandomGen.h"
 
+// sidis-eic
+#include "HadronSoA.h"
+#include "Vec4.h"
+#include "Philox.h"
+
 // Delphes
 #include "classes/DelphesClasses.h"
 
@@ -45,7 +52,14 @@ class Kinematics : public TObject
 
     // SIDIS calculators
     Bool_t CalculateDIS(TString recmethod); // return true if succeeded
+    void PrepareEvent(); // event-level setup for `CalculateHadronKinematics`; called by `CalculateDIS`
     void CalculateHadronKinematics();
+    // batch version of `CalculateHadronKinematics`, for all hadrons of an event at once;
+    // does not assign random spins (`tSpin`,`lSpin`), and does not modify `vecHadron`
+    void CalculateHadronKinematicsBatch(const HadronSoA &in, HadronObsSoA &out);
+    // use hadron `i` of a batch calculated by `CalculateHadronKinematicsBatch`, instead of
+    // `CalculateHadronKinematics`: copies its observables, and assigns its random spins
+    void SetHadronKinematics(const HadronObsSoA &obs, std::size_t i);
 
     // hadronic final state (HFS)
     void GetHFS(
@@ -62,6 +76,7 @@ class Kinematics : public TObject
     void ResetHFS();
     void SubtractElectronFromHFS();
     void AddToHFS(TLorentzVector p4_);
+    void AddToHFS(const Vec4 &p4_);
 
     // PID
     int getTrackPID(
@@ -86,6 +101,35 @@ class Kinematics : public TObject
     void CalculateBreitJetKinematics(fastjet::PseudoJet jet);
     #endif
 
+    // demand-driven evaluation
+    // - observables are grouped by what they need to be calculated; `calcMask` is the
+    //   bitmask of groups calculated by `CalculateDIS` and `CalculateHadronKinematics`,
+    //   and the default is to calculate all of them (`oAll`); set it with `SetCalcMask`
+    // - observables not in `calcMask` are NaN (spins are 0), so reading one by mistake
+    //   does not give a value from a previous event
+    // - `Analysis::Prepare` sets `calcMask` to the groups needed by the bins, histograms,
+    //   `SimpleTree`, and weights (see `Analysis::AddObservable`)
+    enum obsGroup_enum {
+      oDIS   = 0,      // x, Q2, W, y, Nu: always calculated
+      oDepol = 1<<0,   // gamma, epsilon, depolarization factors
+      oLab   = 1<<1,   // pLab, pTlab, phiLab, etaLab
+      oZ     = 1<<2,   // z
+      oMX    = 1<<3,   // mX
+      oXF    = 1<<4,   // xF
+      oPhiH  = 1<<5,   // phiH
+      oPhiS  = 1<<6,   // phiS
+      oPT    = 1<<7,   // pT; also qT, if `oZ` is set
+      oSpin  = 1<<8,   // random spins tSpin, lSpin
+      oAll   = (1<<9)-1
+    };
+    UInt_t calcMask;
+    void SetCalcMask(UInt_t mask);
+    // groups needed for an observable, by name (bin scheme, `valueMap`, or
+    // `SimpleTree` branch name); returns `oAll` if the name is unknown
+    static UInt_t ObservableDeps(TString obsName);
+    // names of the groups in `mask`, for printing
+    static TString ObservableGroups(UInt_t mask);
+
     // kinematics (should be Double_t, if going in SimpleTree)
     Double_t W,Q2,Nu,x,y,s; // DIS
     Double_t pLab,pTlab,phiLab,etaLab,z,pT,qT,mX,xF,phiH,phiS; // hadron
@@ -124,8 +168,16 @@ class Kinematics : public TObject
     std::vector<fastjet::PseudoJet> breitJetsRec, breitJetsTrue;
     std::map<double, int> jetConstituents;
 
-    fastjet::ClusterSequence csRec;
-    fastjet::ClusterSequence csTrue;
+    // cluster sequences of the current event
+    std::unique_ptr<fastjet::ClusterSequence> csRec; //!
+    std::unique_ptr<fastjet::ClusterSequence> csTrue; //!
+
+    // jet clustering settings, for `GetJets` (anti-kt) and `GetBreitFrameJets` (Centauro)
+    Double_t jetR; // jet radius, default 0.8
+    Int_t jetStrategy; // `fastjet::Strategy` for anti-kt, default `fastjet::Best`; not used by Centauro
+    // string of everything that the clustered jets depend on (algorithm, settings, beams),
+    // e.g., to identify cached jets (see `JetCache`)
+    TString JetParams(Bool_t breit=false);
 
     Double_t zjet, pTjet, qTjet;
     std::vector<double> jperp;
@@ -153,6 +205,20 @@ class Kinematics : public TObject
     void TransformToHeadOnFrame(TLorentzVector Lvec, TLorentzVector &Hvec);
     // transform from Head-on frame `Hvec` back to Lab frame `Lvec`
     void TransformBackToLabFrame(TLorentzVector Hvec, TLorentzVector &Lvec);
+    // - each transformation is composed once into a 4x4 matrix (`TLorentzRotation`):
+    //   the head-on and beam c.o.m. frame transformations in the constructor, and the
+    //   photon+ion c.o.m. and ion rest frame boosts in `CalculateDIS`
+    // - batch versions: transform `n` 4-momenta from `in` to `out` (which may be the
+    //   same array), each stored contiguously as (px,py,pz,E)
+    void BoostToComFrame(Int_t n, const Double_t *in, Double_t *out) { ApplyTransform(comTransform,n,in,out); };
+    void BoostToIonFrame(Int_t n, const Double_t *in, Double_t *out) { ApplyTransform(ionTransform,n,in,out); };
+    void TransformToHeadOnFrame(Int_t n, const Double_t *in, Double_t *out) { ApplyTransform(headOnTransform,n,in,out); };
+    void TransformBackToLabFrame(Int_t n, const Double_t *in, Double_t *out) { ApplyTransform(headOnTransformInv,n,in,out); };
+    static void ApplyTransform(const TLorentzRotation &L, Int_t n, const Double_t *in, Double_t *out);
+    // - accessors for the matrices
+    const TLorentzRotation &GetComTransform() { return comTransform; };
+    const TLorentzRotation &GetIonTransform() { return ionTransform; };
+    const TLorentzRotation &GetHeadOnTransform() { return headOnTransform; };
 
 
     // misc calculations
@@ -160,26 +226,36 @@ class Kinematics : public TObject
     static Double_t EMtoP(Double_t energy, Double_t mass) {
       return TMath::Sqrt( TMath::Power(energy,2) - TMath::Power(mass,2) );
     };
+    // - vector helpers are implemented for `Vec3` (see `Vec4.h`); the `TVector3`
+    //   overloads convert and call them
     // - vector projection: returns vA projected onto vB
-    static TVector3 Project(TVector3 vA, TVector3 vB) {
+    static Vec3 Project(const Vec3 &vA, const Vec3 &vB) {
       if(fabs(vB.Dot(vB))<0.0001) {
         //cerr << "WARNING: Kinematics::Project to null vector" << endl;
-        return TVector3(0,0,0);
+        return Vec3(0,0,0);
       };
       return vB * ( vA.Dot(vB) / ( vB.Dot(vB) ) );
     };
+    static TVector3 Project(TVector3 vA, TVector3 vB) { return Project(Vec3(vA),Vec3(vB)); };
     // - vector rejection: returns vC projected onto plane transverse to vD
-    static TVector3 Reject(TVector3 vC, TVector3 vD) {
+    static Vec3 Reject(const Vec3 &vC, const Vec3 &vD) {
       if(fabs(vD.Dot(vD))<0.0001) {
         //cerr << "WARNING: Kinematics::Reject to null vector" << endl;
-        return TVector3(0,0,0);
+        return Vec3(0,0,0);
       };
       return vC - Project(vC,vD);
     };
+    static TVector3 Reject(TVector3 vC, TVector3 vD) { return Reject(Vec3(vC),Vec3(vD)); };
     // - calculate angle between two planes, spanned by vectors
+    static Double_t PlaneAngle(const Vec3 &vA, const Vec3 &vB, const Vec3 &vC, const Vec3 &vD) {
+      return PlaneAngle(vA.Cross(vB),vC,vD);
+    };
     static Double_t PlaneAngle(TVector3 vA, TVector3 vB, TVector3 vC, TVector3 vD) {
-      TVector3 crossAB = vA.Cross(vB); // AxB
-      TVector3 crossCD = vC.Cross(vD); // CxD
+      return PlaneAngle(Vec3(vA),Vec3(vB),Vec3(vC),Vec3(vD));
+    };
+    // - same, but with the normal of the first plane `crossAB`=AxB already calculated
+    static Double_t PlaneAngle(const Vec3 &crossAB, const Vec3 &vC, const Vec3 &vD) {
+      Vec3 crossCD = vC.Cross(vD); // CxD
       Double_t sgn = crossAB.Dot(vD); // (AxB).D
       if(fabs(sgn)<0.00001) {
         //cerr << "WARNING: Kinematics:PlaneAngle (AxB).D=0" << endl;
@@ -227,8 +303,33 @@ class Kinematics : public TObject
     // asymmetry injection
     void InjectFakeAsymmetry(); // test your own asymmetry, for fit code validation
 
+    // random draws (spins, asymmetry injection)
+    // - draws are counter-based (see `Philox.h`): each one is a pure function of
+    //   (`randomSeed`, file ID, entry, hadron index, stream), so they do not depend on
+    //   the order of events, and skipping events does not change the draws of others
+    // - call `SetRandomKey` for each event, before `CalculateDIS`, and `SetRandomHadron`
+    //   for each hadron, before `CalculateHadronKinematics`, with the index of its track
+    //   in the input event, so that the draws do not depend on which tracks are analyzed
+    // - if `SetRandomKey` is never called, the entry is incremented by each `CalculateDIS`;
+    //   if `SetRandomHadron` is never called, the hadron index is reset by `CalculateDIS`,
+    //   and incremented by `CalculateHadronKinematics`
+    void SetRandomKey(UInt_t fileID, Long64_t entry);
+    void SetRandomHadron(UInt_t hadronIdx) { rngHadron = hadronIdx; rngAutoHadron = false; };
+    UInt_t GetRandomHadron() { return rngHadron; }; // (e.g., to write it to a skim)
+    // - the current key, which identifies the event (e.g., for grouping hadrons by event)
+    void GetRandomKey(UInt_t &fileID, Long64_t &entry) { fileID = rngFileID; entry = rngEntry; };
+    UInt_t randomSeed; // default 91874
+
     // tests and validation
     void ValidateHeadOnFrame();
+    // - reference head-on frame transformation, chaining boosts and rotations
+    //   (used to validate the composed matrix)
+    void TransformToHeadOnFrameChained(TLorentzVector Lvec, TLorentzVector &Hvec);
+    // - compare `CalculateHadronKinematicsBatch` to `CalculateHadronKinematics`, for
+    //   hadrons `in`; returns true if all observables agree within relative `tolerance`
+    //   (note: this calls `CalculateHadronKinematics`, which overwrites the hadron
+    //   kinematics members and the spins)
+    Bool_t ValidateHadronKinematicsBatch(const HadronSoA &in, Double_t tolerance=1e-9);
 
     Long64_t countPIDsmeared,countPIDtrue,countHadrons;
 
@@ -260,8 +361,14 @@ class Kinematics : public TObject
     Double_t moduVal[asymInjectN];
     Double_t ampVal[asymInjectN];
     Double_t asymInject;
-    TRandom *RNG;
-    Float_t RN;
+    UInt_t rngFileID;
+    Long64_t rngEntry;
+    UInt_t rngHadron; // track index of the hadron (see `SetRandomHadron`)
+    Bool_t rngAutoEntry; // true until `SetRandomKey` is called
+    Bool_t rngAutoHadron; // true until `SetRandomHadron` is called
+    enum rngStream_enum {sSpin, sInject}; // independent streams of draws, for each hadron
+    void RandomUniform2(UInt_t stream, Double_t &u0, Double_t &u1);
+    Double_t RN;
     Bool_t reconOK;
 
     // - c.o.m. frame of virtual photon and ion
@@ -285,11 +392,30 @@ class Kinematics : public TObject
     TVector3 Bboost, Oboost;
     TLorentzVector BvecEleBeam, BvecIonBeam;
     Double_t rotAboutX, rotAboutY;
+    // - composed transformation matrices
+    TLorentzRotation comTransform, ionTransform;
+    TLorentzRotation beamComTransform;
+    TLorentzRotation headOnTransform, headOnTransformInv;
     // other
     TLorentzVector vecSpin, IvecSpin;
-
-
-  ClassDef(Kinematics,1);
+    // event-level quantities for `CalculateHadronKinematics`, set by `PrepareEvent`
+    Vec3 IvecQ3; //! q, in ion rest frame
+    Vec3 IleptonNormal; //! normal of the lepton plane, q x l, in ion rest frame
+    Vec3 CvecQ3; //! q, in photon+ion c.o.m. frame
+    Vec4 vecIonBeam4; //! copy of `vecIonBeam`
+    Vec4 vecW4; //! copy of `vecW`
+    Double_t IvecQmag2; //! |q|^2, in ion rest frame
+    Double_t zDenom; //! P.q
+    Double_t xFnorm; //! 2/(W|q|), with q in photon+ion c.o.m. frame
+    Double_t phiSevent; //! phiS, for the fixed spin reference vector
+    std::vector<Double_t> batchSign; //! scratch array for `CalculateHadronKinematicsBatch`
+    // jet clustering inputs, reused for each event
+    std::vector<fastjet::PseudoJet> jetInputRec; //!
+    std::vector<fastjet::PseudoJet> jetInputTrue; //!
+    void ClusterJets(const fastjet::JetDefinition &jetDef);
+
+
+  ClassDef(Kinematics,3);
 };
 
 #endif
@@ -12,13 +12,22 @@
 #pragma link C++ class HistosDAG+;
 #pragma link C++ class HistConfig+;
 #pragma link C++ class Histos+;
+#pragma link C++ class HistosStore+;
 #pragma link C++ class Hist4D+;
+#pragma link C++ class Moments+;
+#pragma link C++ class AsymMoments+;
 #pragma link C++ class Kinematics+;
+#pragma link C++ class JetCache+;
+#pragma link C++ class InputMetadata+;
+#pragma link C++ class ZoneMap+;
+#pragma link C++ class SkimFile+;
 #pragma link C++ class SimpleTree+;
+#pragma link C++ class SimpleTreeReader+;
 #pragma link C++ class Analysis+;
 #pragma link C++ class AnalysisDelphes+;
 #pragma link C++ class AnalysisDD4hep+;
 #pragma link C++ class AnalysisEE+;
+#pragma link C++ class AnalysisSkim+;
 #pragma link C++ class PostProcessor+;
 #pragma link C++ class Weights+;
 #pragma link C++ class WeightsUniform+;
@@ -0,0 +1,188 @@
+#include "Moments.h"
+
+ClassImp(Moments)
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// constructor
+Moments::Moments(TString name_, TString title_, std::vector<TString> varNames_)
+  : varNames(varNames_)
+{
+  this->SetNameTitle(name_,title_);
+  mean.resize(varNames.size());
+  m2.resize(varNames.size());
+  Reset();
+};
+
+
+// request the covariance of two variables
+void Moments::AddCovariance(TString varA, TString varB) {
+  Int_t a = GetVarIndex(varA);
+  Int_t b = GetVarIndex(varB);
+  if(a<0 || b<0) {
+    cerr << "ERROR: unknown variable in Moments::AddCovariance(" << varA << "," << varB << ")" << endl;
+    return;
+  };
+  if(entries>0) {
+    cerr << "ERROR: Moments::AddCovariance must be called before filling" << endl;
+    return;
+  };
+  if(GetCovIndex(a,b)>=0) return;
+  covA.push_back(a);
+  covB.push_back(b);
+  comoment.push_back(0.);
+};
+
+
+// fill (weighted Welford update; see West, Commun. ACM 22, 532 (1979))
+void Moments::Fill(const Double_t *vals, Double_t w) {
+  if(w==0) return;
+  entries++;
+  sumW += w;
+  sumW2 += w*w;
+  Double_t r = sumW!=0 ? w/sumW : 0.;
+  delta.resize(varNames.size());
+  for(std::size_t i=0; i<varNames.size(); i++) {
+    delta[i] = vals[i] - mean[i];
+    mean[i] += r * delta[i];
+    m2[i] += w * delta[i] * (vals[i] - mean[i]);
+  };
+  for(std::size_t p=0; p<comoment.size(); p++)
+    comoment[p] += w * delta[covA[p]] * (vals[covB[p]] - mean[covB[p]]);
+};
+
+
+// combine with another accumulator (pairwise update; see Chan, Golub, LeVeque (1979))
+void Moments::Add(const Moments *other) {
+  if(other->varNames.size()!=varNames.size() || other->comoment.size()!=comoment.size()) {
+    cerr << "ERROR: cannot add Moments " << other->GetName() << " to " << GetName()
+         << ", since they have different variables" << endl;
+    return;
+  };
+  if(other->sumW==0) return;
+  if(sumW==0) {
+    entries = other->entries;
+    sumW = other->sumW;
+    sumW2 = other->sumW2;
+    mean = other->mean;
+    m2 = other->m2;
+    comoment = other->comoment;
+    return;
+  };
+  Double_t sumWnew = sumW + other->sumW;
+  Double_t f = sumW * other->sumW / sumWnew;
+  std::vector<Double_t> d(varNames.size());
+  for(std::size_t i=0; i<varNames.size(); i++) {
+    d[i] = other->mean[i] - mean[i];
+    mean[i] += d[i] * other->sumW / sumWnew;
+    m2[i] += other->m2[i] + d[i]*d[i]*f;
+  };
+  for(std::size_t p=0; p<comoment.size(); p++)
+    comoment[p] += other->comoment[p] + d[covA[p]]*d[covB[p]]*f;
+  entries += other->entries;
+  sumW = sumWnew;
+  sumW2 += other->sumW2;
+};
+
+// merge a list of accumulators into this one (used by `hadd` and `TFileMerger`)
+Long64_t Moments::Merge(TCollection *list) {
+  if(list==nullptr) return 0;
+  TIter next(list);
+  while(TObject *obj = next()) {
+    if(!obj->InheritsFrom(Moments::Class())) {
+      cerr << "ERROR: cannot merge " << obj->ClassName() << " into Moments" << endl;
+      return -1;
+    };
+    Add((Moments*)obj);
+  };
+  return entries;
+};
+
+void Moments::Reset() {
+  entries = 0;
+  sumW = 0.;
+  sumW2 = 0.;
+  std::fill(mean.begin(),mean.end(),0.);
+  std::fill(m2.begin(),m2.end(),0.);
+  std::fill(comoment.begin(),comoment.end(),0.);
+};
+
+
+// accessors
+Int_t Moments::GetVarIndex(TString varName) {
+  for(std::size_t i=0; i<varNames.size(); i++) {
+    if(varNames[i]==varName) return (Int_t)i;
+  };
+  return -1;
+};
+
+Int_t Moments::GetCovIndex(Int_t a, Int_t b) {
+  for(std::size_t p=0; p<comoment.size(); p++) {
+    if( (covA[p]==a && covB[p]==b) || (covA[p]==b && covB[p]==a) ) return (Int_t)p;
+  };
+  return -1;
+};
+
+Double_t Moments::GetMean(TString varName) {
+  Int_t i = GetVarIndex(varName);
+  if(i<0) {
+    cerr << "ERROR: Moments " << GetName() << " has no variable " << varName << endl;
+    return 0.;
+  };
+  return mean[i];
+};
+
+Double_t Moments::GetVariance(TString varName) {
+  Int_t i = GetVarIndex(varName);
+  if(i<0) {
+    cerr << "ERROR: Moments " << GetName() << " has no variable " << varName << endl;
+    return 0.;
+  };
+  return sumW>0 ? m2[i]/sumW : 0.;
+};
+
+Double_t Moments::GetMeanError(TString varName) {
+  Double_t nEff = GetEffectiveEntries();
+  return nEff>0 ? TMath::Sqrt(GetVariance(varName)/nEff) : 0.;
+};
+
+Double_t Moments::GetCovariance(TString varA, TString varB) {
+  Int_t a = GetVarIndex(varA);
+  Int_t b = GetVarIndex(varB);
+  if(a>=0 && a==b) return GetVariance(varA);
+  Int_t p = (a>=0 && b>=0) ? GetCovIndex(a,b) : -1;
+  if(p<0) {
+    cerr << "ERROR: Moments " << GetName() << " has no covariance for ("
+         << varA << "," << varB << "); call `AddCovariance` before filling" << endl;
+    return 0.;
+  };
+  return sumW>0 ? comoment[p]/sumW : 0.;
+};
+
+Double_t Moments::GetCorrelation(TString varA, TString varB) {
+  Double_t denom = GetRMS(varA) * GetRMS(varB);
+  return denom>0 ? GetCovariance(varA,varB)/denom : 0.;
+};
+
+
+// print
+void Moments::Print(Option_t *option) const {
+  cout << "Moments " << GetName() << " (" << GetTitle() << "): "
+       << entries << " entries, sum of weights " << sumW << endl;
+  for(std::size_t i=0; i<varNames.size(); i++) {
+    cout << "  " << varNames[i]
+         << ": mean=" << mean[i]
+         << " rms=" << (sumW>0 ? TMath::Sqrt(m2[i]/sumW) : 0.)
+         << endl;
+  };
+  for(std::size_t p=0; p<comoment.size(); p++) {
+    cout << "  cov(" << varNames[covA[p]] << "," << varNames[covB[p]] << ")="
+         << (sumW>0 ? comoment[p]/sumW : 0.) << endl;
+  };
+};
+
+
+Moments::~Moments() {
+};
@@ -0,0 +1,77 @@
+#ifndef Moments_
+#define Moments_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+// ROOT
+#include "TObject.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TMath.h"
+#include "TCollection.h"
+
+/* streaming weighted moments of one or more variables
+ * - stores the sum of weights, weighted means, and weighted sums of squared
+ *   deviations (Welford's algorithm, generalized to weights), plus optional
+ *   co-moments for selected pairs of variables
+ * - costs a few doubles per variable, instead of a histogram
+ * - `Add` and `Merge` combine accumulators exactly (e.g., from different files
+ *   or threads), so `hadd` works too
+ */
+class Moments : public TNamed
+{
+  public:
+    Moments(
+        TString name_="moments",
+        TString title_="",
+        std::vector<TString> varNames_={}
+        );
+    ~Moments();
+
+    // request the covariance of two variables; call before filling
+    void AddCovariance(TString varA, TString varB);
+
+    // fill; `vals` must have one entry per variable, in the order of `GetVarNames()`
+    void Fill(const Double_t *vals, Double_t w=1.0);
+    void Fill(Double_t val, Double_t w=1.0) { Fill(&val,w); }; // single-variable accumulator
+
+    // combine with another accumulator, which must have the same variables
+    void Add(const Moments *other);
+    Long64_t Merge(TCollection *list);
+    void Reset();
+
+    // accessors
+    std::vector<TString> GetVarNames() { return varNames; };
+    Int_t GetVarIndex(TString varName); // returns -1 if not found
+    Long64_t GetEntries() { return entries; };
+    Double_t GetSumW() { return sumW; };
+    Double_t GetSumW2() { return sumW2; };
+    Double_t GetEffectiveEntries() { return sumW2>0 ? sumW*sumW/sumW2 : 0; };
+    Double_t GetMean(TString varName);
+    Double_t GetVariance(TString varName); // (population) variance
+    Double_t GetRMS(TString varName) { return TMath::Sqrt(GetVariance(varName)); };
+    Double_t GetMeanError(TString varName); // uses effective entries
+    Double_t GetCovariance(TString varA, TString varB); // requires `AddCovariance`
+    Double_t GetCorrelation(TString varA, TString varB);
+
+    void Print(Option_t *option="") const override;
+
+  private:
+    std::vector<TString> varNames;
+    Long64_t entries;
+    Double_t sumW, sumW2;
+    std::vector<Double_t> mean; // weighted mean, per variable
+    std::vector<Double_t> m2; // weighted sum of squared deviations, per variable
+    std::vector<Int_t> covA, covB; // variable indices of covariance pairs
+    std::vector<Double_t> comoment; // weighted sum of products of deviations, per pair
+    std::vector<Double_t> delta; //! temporary deviations, used by `Fill`
+    Int_t GetCovIndex(Int_t a, Int_t b);
+
+  ClassDefOverride(Moments,1);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef Philox_
+#define Philox_
+
+#include <array>
+#include <cstdint>
+
+// ROOT
+#include "Rtypes.h"
+
+/* Philox4x32-10 counter-based random number generator [Salmon et al., SC11]
+ * - each draw is a pure function of a 128-bit counter and a 64-bit key: there is
+ *   no state to advance, so the same (key,counter) always gives the same numbers,
+ *   regardless of the order in which they are requested
+ * - one call gives 4 random 32-bit integers, or 2 uniform doubles
+ * - used by `Kinematics` for spin draws, keyed by event identity (see
+ *   `Kinematics::SetRandomKey`)
+ */
+struct Philox {
+  typedef std::array<uint32_t,4> Counter;
+  typedef std::array<uint32_t,2> Key;
+
+  // 10-round Philox4x32 bijection of `ctr`, for key `key`
+  static Counter Generate(Counter ctr, Key key) {
+    for(int r=0; r<10; r++) {
+      if(r>0) {
+        key[0] += 0x9E3779B9; // Weyl sequence key schedule
+        key[1] += 0xBB67AE85;
+      };
+      const uint64_t p0 = (uint64_t)0xD2511F53 * ctr[0];
+      const uint64_t p1 = (uint64_t)0xCD9E8D57 * ctr[2];
+      ctr = {
+        (uint32_t)(p1>>32) ^ ctr[1] ^ key[0],
+        (uint32_t)p1,
+        (uint32_t)(p0>>32) ^ ctr[3] ^ key[1],
+        (uint32_t)p0
+      };
+    };
+    return ctr;
+  };
+
+  // uniform double in the open interval (0,1), from 53 of the 64 bits `hi`,`lo`
+  static Double_t ToUniform(uint32_t hi, uint32_t lo) {
+    const uint64_t bits = ( ((uint64_t)hi << 32) | lo ) >> 11;
+    return ( bits + 0.5 ) * ( 1.0 / 9007199254740992.0 ); // 2^-53
+  };
+
+  // two uniform doubles in (0,1), for counter `ctr` and key `key`
+  static void Uniform2(const Counter &ctr, const Key &key, Double_t &u0, Double_t &u1) {
+    Counter out = Generate(ctr,key);
+    u0 = ToUniform(out[0],out[1]);
+    u1 = ToUniform(out[2],out[3]);
+  };
+};
+
+#endif
@@ -73,6 +73,8 @@ void PostProcessor::ResetVars() {
 void PostProcessor::DumpHist(TString datFile, TString histSet, TString varName) {
   cout << "dump " << histSet << " : " << varName << " to " << datFile << endl;
   Histos *H = (Histos*) infile->Get(histSet);
+  if(H==nullptr) H = HD->GetHistos(histSet); // consolidated output
+  if(H==nullptr) return;
   TH1 *hist = H->Hist(varName);
   if(hist->GetDimension()>1) return;
   TString histTformatted = hist->GetTitle();
@@ -212,6 +214,78 @@ void PostProcessor::FinishDumpAve(TString datFile) {
 };
 
 
+//=========================================================================
+/* ALGORITHM: dump a moments accumulator `momName` from `H` to the file `datFile`
+ * - moments accumulators are booked when `Analysis` is run with `useMoments`
+ * - appends a table with one row per variable: the mean, its statistical
+ *   uncertainty, and the RMS; this is a cheaper alternative to `DumpAve`
+ */
+void PostProcessor::DumpMoments(TString datFile, Histos *H, TString momName) {
+  Moments *mom = H->Mom(momName);
+  if(mom==nullptr) return;
+  cout << "dump moments " << momName << " from " << H->GetSetName()
+       << " to " << datFile << endl;
+  TString setT = H->GetSetTitle();
+  setT.ReplaceAll("#in"," in ");
+  setT.ReplaceAll("#pm","+-");
+  gSystem->RedirectOutput(datFile,"a");
+  cout << endl << "Histogram Set: " << setT << endl;
+  cout << "Moments: " << mom->GetTitle()
+       << ", entries=" << mom->GetEntries()
+       << ", sum of weights=" << mom->GetSumW() << endl;
+  cout << std::left << std::setw(12) << "variable"
+       << std::right << std::setw(14) << "mean"
+       << std::setw(14) << "mean_err"
+       << std::setw(14) << "rms" << endl;
+  for(TString varName : mom->GetVarNames()) {
+    cout << std::left << std::setw(12) << varName
+         << std::right << std::setw(14) << mom->GetMean(varName)
+         << std::setw(14) << mom->GetMeanError(varName)
+         << std::setw(14) << mom->GetRMS(varName) << endl;
+  };
+  gSystem->RedirectOutput(0);
+};
+
+
+//=========================================================================
+/* ALGORITHM: dump single-spin asymmetries from the accumulator `asymName` of `H`
+ * to the file `datFile`
+ * - asymmetry accumulators are booked when `Analysis` is run with `useAsymMoments`
+ * - appends a table with one row per modulation: the asymmetry and its statistical
+ *   uncertainty, the average polarization times depolarization factor, and the
+ *   moments for each spin state
+ */
+void PostProcessor::DumpAsymmetries(TString datFile, Histos *H, TString asymName) {
+  AsymMoments *asym = H->Asym(asymName);
+  if(asym==nullptr) return;
+  cout << "dump asymmetries " << asymName << " from " << H->GetSetName()
+       << " to " << datFile << endl;
+  TString setT = H->GetSetTitle();
+  setT.ReplaceAll("#in"," in ");
+  setT.ReplaceAll("#pm","+-");
+  gSystem->RedirectOutput(datFile,"a");
+  cout << endl << "Histogram Set: " << setT << endl;
+  cout << "Asymmetry moments: " << asym->GetTitle()
+       << ", spin-up entries=" << asym->GetEntries(1)
+       << ", spin-down entries=" << asym->GetEntries(-1) << endl;
+  cout << std::left << std::setw(14) << "modulation"
+       << std::right << std::setw(14) << "asym"
+       << std::setw(14) << "asym_err"
+       << std::setw(14) << "<P*D>"
+       << std::setw(14) << "<m>_up"
+       << std::setw(14) << "<m>_down" << endl;
+  for(TString modName : asym->GetModNames()) {
+    cout << std::left << std::setw(14) << modName
+         << std::right << std::setw(14) << asym->GetAsymmetry(modName)
+         << std::setw(14) << asym->GetAsymmetryError(modName)
+         << std::setw(14) << asym->GetMeanPolDepol(modName)
+         << std::setw(14) << asym->GetMoment(modName,1)
+         << std::setw(14) << asym->GetMoment(modName,-1) << endl;
+  };
+  gSystem->RedirectOutput(0);
+};
+
+
 //=========================================================================
 /* ALGORITHM: draw a single histogram to a canvas, and write it
  * - `histName` is the name of the histogram given in Histos
@@ -266,6 +340,8 @@ void PostProcessor::DrawSingle(Histos *H, TString histName, TString drawFormat,
 void PostProcessor::DrawSingle(TString histSet, TString histName) {
 
   Histos *H = (Histos*) infile->Get(histSet);
+  if(H==nullptr) H = HD->GetHistos(histSet); // consolidated output
+  if(H==nullptr) return;
   TH1 *hist = H->Hist(histName,true);
   Hist4D *hist4 = H->Hist4(histName,true);
 
@@ -773,6 +849,93 @@ void PostProcessor::FinishDrawRatios(TString summaryDir) {
 
 
 
+//=========================================================================
+/* REBINNING: build a new HistosDAG from a fine-grained THnSparse, written by
+ * `Analysis` when `writeSparse` is enabled; no event data are needed
+ * - `sparseName` is the name of the THnSparse, `sparse__<finalState>__<reconMethod>`
+ * - `binSets` are the bin schemes of the new HistosDAG; their variable names must be
+ *   axis names of the THnSparse (by default x, q2, y, z, pt, phiH, phiS, eta; see
+ *   `Analysis::SetSparseAxis`), and their bin edges should coincide with the fine bin
+ *   edges, otherwise the cuts are approximate
+ * - each Histos will have one 1D histogram per THnSparse axis (named after the axis),
+ *   with `rebin` fine bins merged into one, and a 2D `Q2vsX` histogram
+ * - the returned HistosDAG is independent of the one from the input file; use it like
+ *   `GetHistosDAG()`, e.g., `BuildFromSparse(...)->Payload(...)`, then `ExecuteAndClearOps()`
+ */
+HistosDAG *PostProcessor::BuildFromSparse(TString sparseName, std::vector<BinSet*> binSets, Int_t rebin) {
+  THnSparse *sparse = infile->Get<THnSparse>(sparseName);
+  if(sparse==nullptr) {
+    cerr << "ERROR: THnSparse " << sparseName << " not found in " << infileN << endl;
+    return nullptr;
+  };
+  TObjArray *axes = sparse->GetListOfAxes();
+  // build the DAG
+  std::map<TString,BinSet*> binSchemes;
+  for(BinSet *B : binSets) {
+    if(axes->FindObject(B->GetVarName())==nullptr) {
+      cerr << "ERROR: BinSet variable " << B->GetVarName() << " is not an axis of " << sparseName << endl;
+      return nullptr;
+    };
+    binSchemes.insert(std::pair<TString,BinSet*>(B->GetVarName(),B));
+  };
+  HistosDAG *HDS = new HistosDAG();
+  HDS->Build(binSchemes);
+  // fill Histos by projection
+  Long64_t nWarn = 0;
+  HDS->Payload([sparse,axes,rebin,&nWarn](Histos *H){
+    // set axis ranges from this bin's cuts
+    for(Int_t d=0; d<sparse->GetNdimensions(); d++) sparse->GetAxis(d)->SetRange(0,0);
+    for(CutDef *cut : H->CutDefList) {
+      Double_t low, high;
+      if(!cut->GetInterval(low,high)) continue;
+      TAxis *ax = (TAxis*) axes->FindObject(cut->GetVarName());
+      Int_t binLow = low==-DBL_MAX ? 0 : ax->FindFixBin(low);
+      Int_t binHigh = high==DBL_MAX ? ax->GetNbins()+1 : ax->FindFixBin(high);
+      // `high` on a fine bin edge: exclude the bin starting at `high`
+      if(high!=DBL_MAX && binHigh>binLow && TMath::Abs(ax->GetBinLowEdge(binHigh)-high) <= 1e-5*TMath::Abs(high)) binHigh--;
+      Bool_t aligned = (low==-DBL_MAX || TMath::Abs(ax->GetBinLowEdge(binLow)-low) <= 1e-5*TMath::Abs(low)) &&
+                       (high==DBL_MAX || TMath::Abs(ax->GetBinUpEdge(binHigh)-high) <= 1e-5*TMath::Abs(high));
+      if(!aligned && nWarn++ < 10)
+        cerr << "WARNING: cut " << cut->GetCutTitle() << " is not aligned with the fine bins of "
+             << cut->GetVarName() << "; using [" << ax->GetBinLowEdge(binLow) << "," << ax->GetBinUpEdge(binHigh) << "]" << endl;
+      ax->SetRange(binLow,binHigh);
+    };
+    // project onto each axis
+    for(Int_t d=0; d<sparse->GetNdimensions(); d++) {
+      TAxis *ax = sparse->GetAxis(d);
+      TString varName = ax->GetName();
+      TH1D *hist = sparse->Projection(d,"E");
+      hist->SetName(H->GetSetName()+"_hist_"+varName);
+      hist->SetTitle(TString(ax->GetTitle())+" distribution, "+H->GetSetTitle()+";"+ax->GetTitle());
+      hist->SetDirectory(nullptr);
+      if(rebin>1) hist->Rebin(rebin);
+      HistConfig *config = new HistConfig();
+      config->logx = ax->GetXbins()->GetSize()>0; // variable bins are from `BinSet::BinLog`
+      H->RegisterHist(varName,hist,config);
+    };
+    // Q2 vs. x
+    TAxis *axX = (TAxis*) axes->FindObject("x");
+    TAxis *axQ2 = (TAxis*) axes->FindObject("q2");
+    if(axX && axQ2) {
+      TH2D *hist2 = sparse->Projection(axes->IndexOf(axQ2),axes->IndexOf(axX),"E");
+      hist2->SetName(H->GetSetName()+"_hist_Q2vsX");
+      hist2->SetTitle("Q^{2} vs. x distribution, "+H->GetSetTitle()+";x;Q^{2} [GeV^{2}]");
+      hist2->SetDirectory(nullptr);
+      if(rebin>1) hist2->Rebin2D(rebin,rebin);
+      HistConfig *config = new HistConfig();
+      config->logx = true;
+      config->logy = true;
+      config->logz = true;
+      H->RegisterHist("Q2vsX",hist2,config);
+    };
+  });
+  HDS->ExecuteAndClearOps();
+  for(Int_t d=0; d<sparse->GetNdimensions(); d++) sparse->GetAxis(d)->SetRange(0,0);
+  cout << "built " << HDS->GetNumHistos() << " Histos from " << sparseName << endl;
+  return HDS;
+};
+
+
 //=========================================================================
 // TEXT FILE: start new text file, append to text file, print text file
 void PostProcessor::StartTextFile(TString datFile, TString firstLine) {
@@ -14,6 +14,7 @@
 #include "TGaxis.h"
 #include "TLegend.h"
 #include "TProfile.h"
+#include "THnSparse.h"
 
 // sidis-eic
 #include "Histos.h"
@@ -64,6 +65,8 @@ class PostProcessor : public TNamed
     // - you are welcome to add your own algorithms
     void DumpHist(TString datFile, TString histSet, TString varName);
     void DumpAve(TString datFile, Histos *H, TString cutName);
+    void DumpMoments(TString datFile, Histos *H, TString momName);
+    void DumpAsymmetries(TString datFile, Histos *H, TString asymName="spin");
     void DrawSingle(Histos *H, TString histName, TString drawFormat="", Int_t profileAxis=0, Bool_t profileOnly=false);
     void DrawSingle(TString histSet, TString histName);
     void DrawRatios(
@@ -86,6 +89,9 @@ class PostProcessor : public TNamed
         bool renormalize=false
         );
 
+    // rebinning: build a new HistosDAG from a fine-grained THnSparse (see PostProcessor.cxx)
+    HistosDAG *BuildFromSparse(TString sparseName, std::vector<BinSet*> binSets, Int_t rebin=1);
+
     // algorithm finish methods; to be called after loops
     void FinishDumpAve(TString datFile);
     void FinishDrawRatios(TString summaryDir);
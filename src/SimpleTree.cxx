@@ -1,41 +1,395 @@
 #include "SimpleTree.h"
 
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "TROOT.h"
+#include "TDirectory.h"
+
+#if INCRNTUPLE == 1
+#include <memory>
+#include "RVersion.h"
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleWriter.hxx>
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,35,0)
+namespace rntuple = ROOT;
+#else
+namespace rntuple = ROOT::Experimental;
+#endif
+struct SimpleTreeNTuple {
+  std::unique_ptr<rntuple::RNTupleWriter> writer;
+  std::vector<std::shared_ptr<Double_t>> dFields; // same order as the `Double_t` columns
+  std::vector<std::shared_ptr<Int_t>> iFields; // same order as the `Int_t` columns
+  // `lEvent` layout: `dFields` and `iFields` are the event-level columns, and these are the hadron columns
+  std::vector<std::shared_ptr<std::vector<Double_t>>> vdFields;
+  std::vector<std::shared_ptr<std::vector<Int_t>>> viFields;
+  std::shared_ptr<Int_t> nHadField;
+};
+#else
+struct SimpleTreeNTuple {};
+#endif
+
+// asynchronous writer: two blocks of rows, stored by column; the event thread fills one,
+// while the writer thread writes the other
+struct SimpleTreeBlock {
+  std::vector<Double_t> d; // column-major: d[idx*blockRows + row]
+  std::vector<Int_t> i;
+  std::vector<UInt_t> fileID; // event keys
+  std::vector<Long64_t> entry;
+  Long64_t rows = 0;
+};
+struct SimpleTreeAsync {
+  std::thread thread;
+  std::mutex mtx;
+  std::condition_variable cv;
+  SimpleTreeBlock blocks[2];
+  Long64_t blockRows;
+  Int_t fillIdx = 0; // block being filled by the event thread
+  Bool_t pending = false; // true if the other block is waiting for, or being written by, the writer
+  Bool_t stop = false;
+  Long64_t numBlocks = 0; // number of blocks written
+  Long64_t numWaits = 0; // number of times the event thread waited for the writer
+};
+
 ClassImp(SimpleTree)
 
 // constructor
-SimpleTree::SimpleTree(TString treeName_, Kinematics *K_, Kinematics *Ktrue_) 
-  : treeName(treeName_)
+SimpleTree::SimpleTree(TString treeName_, Kinematics *K_, Kinematics *Ktrue_, TString columns_, Int_t format_, Int_t layout_, TString fileName_)
+  : T(nullptr)
   , K(K_)
   , Ktrue(Ktrue_)
+  , treeName(treeName_)
+  , format(format_)
+  , layout(layout_)
+  , rowFileID(0)
+  , rowEntry(0)
+  , nHad(0)
+  , evFileID(0)
+  , evEntry(0)
+  , NT(nullptr)
+  , AS(nullptr)
+  , ownFile(nullptr)
 {
-  // branch names are set to match `brufit` implementation
+  if(layout!=lTrack && layout!=lEvent) {
+    cerr << "ERROR: unknown SimpleTree layout " << layout << "; using lTrack" << endl;
+    layout = lTrack;
+  };
+
+  // column names are set to match `brufit` implementation
   // (see `https://github.com/c-dilks/dispin/tree/master/src`)
+  const std::vector<SimpleTreeColumn> allColumns = {
+    // name,       Double_t address, Int_t address,   event-level
+    { "QSq",       &(K->Q2),        nullptr,         true  },
+    { "X",         &(K->x),         nullptr,         true  },
+    { "Y",         &(K->y),         nullptr,         true  },
+    { "Z",         &(K->z),         nullptr,         false },
+    { "W",         &(K->W),         nullptr,         true  },
+    { "MX",        &(K->mX),        nullptr,         false },
+    { "PhPerp",    &(K->pT),        nullptr,         false },
+    { "PhiH",      &(K->phiH),      nullptr,         false },
+    { "PhiS",      &(K->phiS),      nullptr,         true  },
+    { "TruePhiH",  &(Ktrue->phiH),  nullptr,         false },
+    { "TruePhiS",  &(Ktrue->phiS),  nullptr,         true  },
+    { "PolT",      &(K->polT),      nullptr,         true  },
+    { "PolL",      &(K->polL),      nullptr,         true  },
+    { "PolB",      &(K->polBeam),   nullptr,         true  },
+    { "Depol1",    &(K->depolP1),   nullptr,         true  },
+    { "Depol2",    &(K->depolP2),   nullptr,         true  },
+    { "Depol3",    &(K->depolP3),   nullptr,         true  },
+    { "Depol4",    &(K->depolP4),   nullptr,         true  },
+    { "HadPID",    nullptr,         &(K->hadPID),    false },
+    { "Spin_idx",  nullptr,         &(K->tSpin),     false },
+    { "SpinL_idx", nullptr,         &(K->lSpin),     false },
+    { "Weight",    &(weight),       nullptr,         false }
+  };
+
+  // select columns
+  std::set<TString> selected;
+  TString columnsStr = columns_;
+  columnsStr.ReplaceAll(","," ");
+  TString token;
+  Ssiz_t pos = 0;
+  while(columnsStr.Tokenize(token,pos," ")) selected.insert(token);
+  const Bool_t selectAll = selected.empty(); // (`selected` is emptied by the loop)
+  for(const SimpleTreeColumn &column : allColumns) {
+    if(selectAll || column.name=="Weight" || selected.erase(column.name)>0) {
+      columns.push_back(column);
+      SimpleTreeColumn &c = columns.back();
+      if(c.d) { c.idx = rowD.size(); rowD.push_back(0); }
+      else    { c.idx = rowI.size(); rowI.push_back(0); };
+      if(c.event) c.evIdx = c.d ? evD.size() : evI.size();
+      else        c.evIdx = c.d ? hadD.size() : hadI.size();
+      if(c.event) { if(c.d) evD.push_back(0);    else evI.push_back(0); }
+      else        { if(c.d) hadD.emplace_back(); else hadI.emplace_back(); };
+    };
+  };
+  for(TString name : selected) {
+    if(name!="Weight") cerr << "ERROR: SimpleTree has no column " << name << "; ignoring" << endl;
+  };
+
+  // book the output, in the current directory or in a file of its own
+  TDirectory::TContext context; // (restores the current directory)
+  if(fileName_!="") {
+    TDirectory *dir = gDirectory;
+    ownFile = new TFile(fileName_,"RECREATE");
+    if(ownFile->IsZombie()) {
+      cerr << "ERROR: SimpleTree cannot create " << fileName_ << "; using the current directory" << endl;
+      delete ownFile;
+      ownFile = nullptr;
+      dir->cd();
+    }
+    else cout << "SimpleTree: writing " << treeName << " to " << fileName_ << endl;
+  };
+  if(format==fRNTuple && !BookRNTuple()) format = fTTree;
+  if(format==fTTree) BookTTree();
+};
+
+
+// book TTree, with branches reading from the row buffers (`lTrack`), or from the event
+// buffers (`lEvent`)
+void SimpleTree::BookTTree() {
   T = new TTree(treeName,treeName);
-  T->Branch("QSq",       &(K->Q2),        "QSq/D");
-  T->Branch("X",         &(K->x),         "X/D");
-  T->Branch("Y",         &(K->y),         "Y/D");
-  T->Branch("Z",         &(K->z),         "Z/D");
-  T->Branch("W",         &(K->W),         "W/D");
-  T->Branch("MX",        &(K->mX),        "MX/D");
-  T->Branch("PhPerp",    &(K->pT),        "PhPerp/D");
-  T->Branch("PhiH",      &(K->phiH),      "PhiH/D");
-  T->Branch("PhiS",      &(K->phiS),      "PhiS/D");
-  T->Branch("TruePhiH",  &(Ktrue->phiH),  "TruePhiH/D");
-  T->Branch("TruePhiS",  &(Ktrue->phiS),  "TruePhiS/D");
-  T->Branch("PolT",      &(K->polT),      "PolT/D");
-  T->Branch("PolL",      &(K->polL),      "PolL/D");
-  T->Branch("PolB",      &(K->polBeam),   "PolB/D");
-  T->Branch("Depol1",    &(K->depolP1),   "Depol1/D");
-  T->Branch("Depol2",    &(K->depolP2),   "Depol2/D");
-  T->Branch("Depol3",    &(K->depolP3),   "Depol3/D");
-  T->Branch("Depol4",    &(K->depolP4),   "Depol4/D");
-  T->Branch("HadPID",    &(K->hadPID),    "HadPID/I");
-  T->Branch("Spin_idx",  &(K->tSpin),     "Spin_idx/I");
-  T->Branch("SpinL_idx", &(K->lSpin),     "SpinL_idx/I");
-  T->Branch("Weight",    &(weight),       "Weight/D");
+  if(layout==lEvent) T->Branch("nHad", &nHad, "nHad/I");
+  for(const SimpleTreeColumn &column : columns) {
+    if(layout==lTrack) {
+      if(column.d) T->Branch(column.name, &(rowD[column.idx]), column.name+"/D");
+      else         T->Branch(column.name, &(rowI[column.idx]), column.name+"/I");
+    }
+    else if(column.event) {
+      if(column.d) T->Branch(column.name, &(evD[column.evIdx]), column.name+"/D");
+      else         T->Branch(column.name, &(evI[column.evIdx]), column.name+"/I");
+    }
+    else {
+      if(column.d) T->Branch(column.name, &(hadD[column.evIdx]));
+      else         T->Branch(column.name, &(hadI[column.evIdx]));
+    };
+  };
+};
+
+// book RNTuple, in the file of the current directory
+Bool_t SimpleTree::BookRNTuple() {
+#if INCRNTUPLE == 1
+  TFile *file = gDirectory->GetFile();
+  if(file==nullptr) {
+    cerr << "ERROR: SimpleTree RNTuple needs an open file; using TTree instead" << endl;
+    return false;
+  };
+  auto model = rntuple::RNTupleModel::Create();
+  NT = new SimpleTreeNTuple();
+  if(layout==lEvent) NT->nHadField = model->MakeField<Int_t>("nHad");
+  for(const SimpleTreeColumn &column : columns) {
+    if(layout==lEvent && !column.event) {
+      if(column.d) NT->vdFields.push_back(model->MakeField<std::vector<Double_t>>(column.name.Data()));
+      else         NT->viFields.push_back(model->MakeField<std::vector<Int_t>>(column.name.Data()));
+    }
+    else {
+      if(column.d) NT->dFields.push_back(model->MakeField<Double_t>(column.name.Data()));
+      else         NT->iFields.push_back(model->MakeField<Int_t>(column.name.Data()));
+    };
+  };
+  NT->writer = rntuple::RNTupleWriter::Append(std::move(model), treeName.Data(), *file);
+  return true;
+#else
+  cerr << "ERROR: SimpleTree RNTuple format requires building with INCRNTUPLE=1; using TTree instead" << endl;
+  return false;
+#endif
+};
+
+
+// column names
+std::vector<TString> SimpleTree::GetColumnNames() {
+  std::vector<TString> names;
+  for(const SimpleTreeColumn &column : columns) names.push_back(column.name);
+  return names;
+};
+
+
+// fill
+// - synchronous: copy the row to the row buffers, and fill the output
+// - asynchronous: copy the row to the block being filled; if it is full, pass it to
+//   the writer thread
+void SimpleTree::FillTree(Double_t w) {
+  weight = w;
+  if(AS==nullptr) {
+    for(const SimpleTreeColumn &column : columns) {
+      if(column.d) rowD[column.idx] = *(column.d);
+      else         rowI[column.idx] = *(column.i);
+    };
+    K->GetRandomKey(rowFileID, rowEntry);
+    WriteRow();
+    return;
+  };
+  SimpleTreeBlock *block = &(AS->blocks[AS->fillIdx]);
+  const Long64_t r = block->rows++;
+  K->GetRandomKey(block->fileID[r], block->entry[r]);
+  for(const SimpleTreeColumn &column : columns) {
+    if(column.d) block->d[column.idx*AS->blockRows + r] = *(column.d);
+    else         block->i[column.idx*AS->blockRows + r] = *(column.i);
+  };
+  if(block->rows == AS->blockRows) {
+    std::unique_lock<std::mutex> lock(AS->mtx);
+    if(AS->pending) AS->numWaits++;
+    AS->cv.wait(lock, [this]{ return !AS->pending; });
+    AS->pending = true;
+    AS->fillIdx = 1 - AS->fillIdx;
+    AS->blocks[AS->fillIdx].rows = 0;
+    AS->cv.notify_all();
+  };
+};
+
+// fill the output from the row buffers
+// - `lEvent` layout: add the row to the event buffers instead; the event is written when
+//   a row of the next event arrives, or by `WriteTree`
+void SimpleTree::WriteRow() {
+  if(layout==lEvent) {
+    if(nHad>0 && (rowFileID!=evFileID || rowEntry!=evEntry)) WriteEvent();
+    evFileID = rowFileID;
+    evEntry = rowEntry;
+    for(const SimpleTreeColumn &column : columns) {
+      if(column.event) {
+        if(column.d) evD[column.evIdx] = rowD[column.idx];
+        else         evI[column.evIdx] = rowI[column.idx];
+      }
+      else {
+        if(column.d) hadD[column.evIdx].push_back(rowD[column.idx]);
+        else         hadI[column.evIdx].push_back(rowI[column.idx]);
+      };
+    };
+    nHad++;
+    return;
+  };
+  if(T) T->Fill();
+#if INCRNTUPLE == 1
+  else if(NT && NT->writer) {
+    std::size_t iD = 0, iI = 0;
+    for(const SimpleTreeColumn &column : columns) {
+      if(column.d) *(NT->dFields[iD++]) = rowD[column.idx];
+      else         *(NT->iFields[iI++]) = rowI[column.idx];
+    };
+    NT->writer->Fill();
+  };
+#endif
+};
+
+// `lEvent` layout: fill the output from the event buffers, and clear them
+void SimpleTree::WriteEvent() {
+  if(nHad==0) return;
+  if(T) T->Fill();
+#if INCRNTUPLE == 1
+  else if(NT && NT->writer) {
+    std::size_t iD = 0, iI = 0, iVD = 0, iVI = 0;
+    for(const SimpleTreeColumn &column : columns) {
+      if(column.event) {
+        if(column.d) *(NT->dFields[iD++]) = evD[column.evIdx];
+        else         *(NT->iFields[iI++]) = evI[column.evIdx];
+      }
+      else { // swap, rather than copy; the swapped-out vectors are cleared below
+        if(column.d) NT->vdFields[iVD++]->swap(hadD[column.evIdx]);
+        else         NT->viFields[iVI++]->swap(hadI[column.evIdx]);
+      };
+    };
+    *(NT->nHadField) = nHad;
+    NT->writer->Fill();
+  };
+#endif
+  for(auto &v : hadD) v.clear();
+  for(auto &v : hadI) v.clear();
+  nHad = 0;
+};
+
+
+// asynchronous writer
+void SimpleTree::StartAsync(Long64_t blockRows) {
+  if(AS) return;
+  // the writer thread writes to the output file, so nothing else may write to it
+  if(ownFile==nullptr) {
+    cerr << "ERROR: SimpleTree::StartAsync requires the output in a file of its own "
+         << "(constructor argument `fileName_`); writing synchronously" << endl;
+    return;
+  };
+  ROOT::EnableThreadSafety();
+  AS = new SimpleTreeAsync();
+  AS->blockRows = TMath::Max(blockRows,(Long64_t)1);
+  for(SimpleTreeBlock &block : AS->blocks) {
+    block.d.resize(rowD.size()*AS->blockRows);
+    block.i.resize(rowI.size()*AS->blockRows);
+    block.fileID.resize(AS->blockRows);
+    block.entry.resize(AS->blockRows);
+  };
+  AS->thread = std::thread(&SimpleTree::WriterLoop, this);
 };
 
+// writer thread: wait for a full block, and write its rows
+void SimpleTree::WriterLoop() {
+  std::unique_lock<std::mutex> lock(AS->mtx);
+  while(true) {
+    AS->cv.wait(lock, [this]{ return AS->pending || AS->stop; });
+    if(!AS->pending) break; // stopped, and nothing left to write
+    const SimpleTreeBlock &block = AS->blocks[1 - AS->fillIdx];
+    lock.unlock();
+    for(Long64_t r=0; r<block.rows; r++) {
+      for(const SimpleTreeColumn &column : columns) {
+        if(column.d) rowD[column.idx] = block.d[column.idx*AS->blockRows + r];
+        else         rowI[column.idx] = block.i[column.idx*AS->blockRows + r];
+      };
+      rowFileID = block.fileID[r];
+      rowEntry = block.entry[r];
+      WriteRow();
+    };
+    lock.lock();
+    AS->numBlocks++;
+    AS->pending = false;
+    AS->cv.notify_all();
+  };
+};
+
+// pass the partially filled block to the writer, and wait for it to finish
+void SimpleTree::StopAsync() {
+  if(AS==nullptr) return;
+  {
+    std::unique_lock<std::mutex> lock(AS->mtx);
+    AS->cv.wait(lock, [this]{ return !AS->pending; });
+    if(AS->blocks[AS->fillIdx].rows > 0) {
+      AS->pending = true;
+      AS->fillIdx = 1 - AS->fillIdx;
+    };
+    AS->stop = true;
+    AS->cv.notify_all();
+  };
+  AS->thread.join();
+  cout << "SimpleTree: wrote " << AS->numBlocks << " blocks asynchronously; the event loop waited for "
+       << AS->numWaits << " of them" << endl;
+  delete AS;
+  AS = nullptr;
+};
+
+
+// write; for RNTuple, this commits the remaining data and closes the writer; if the
+// output is in a file of its own, the file is closed
+void SimpleTree::WriteTree() {
+  StopAsync();
+  if(layout==lEvent) WriteEvent(); // the last event
+  TDirectory *dir = ownFile;
+  if(dir==nullptr) dir = gDirectory;
+  TDirectory::TContext context(dir);
+  if(T) T->Write();
+#if INCRNTUPLE == 1
+  else if(NT) NT->writer.reset();
+#endif
+  if(ownFile) {
+    cout << "SimpleTree: " << ownFile->GetName() << " written." << endl;
+    ownFile->Close(); // (also deletes `T`)
+    delete ownFile;
+    ownFile = nullptr;
+    T = nullptr;
+  };
+};
+
+
 // destructor
 SimpleTree::~SimpleTree() {
+  StopAsync();
+  if(NT) delete NT;
+  if(ownFile) delete ownFile;
 };
-
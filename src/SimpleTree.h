@@ -3,6 +3,24 @@
  *   Analysis derived class; this tree is designed to be compatible
  *   with BruFit for asymmetry analysis
  *   (see `https://github.com/c-dilks/dispin/tree/master/src`)
+ * - the output may be a `TTree` (default) or an `RNTuple` (requires building
+ *   with `INCRNTUPLE=1`, see `config.mk`), with the same column names
+ * - the columns may be restricted to a subset, to reduce the output size
+ * - with `StartAsync`, rows are collected in column blocks, and a background
+ *   thread fills and compresses the output, so `FillTree` does not wait for
+ *   compression or disk writes; there are two blocks, so the event loop only
+ *   waits if the writer falls a whole block behind
+ *   - a `TFile` must not be written by two threads, so this requires the output
+ *     to be in a file of its own, which the `SimpleTree` opens and closes (see
+ *     the constructor argument `fileName_`)
+ * - layouts:
+ *   - `lTrack` (default): one row per hadron, and the event-level columns (DIS
+ *     kinematics, depolarization, polarization, `PhiS`) are repeated for each hadron
+ *   - `lEvent`: one row per event, with the event-level columns written once, the
+ *     number of hadrons `nHad`, and the hadron columns as `std::vector`s of length
+ *     `nHad`; hadrons are grouped by event using `Kinematics::GetRandomKey`
+ *   - use `SimpleTreeReader` to read either layout one hadron at a time, or
+ *     `SimpleTreeReader::Flatten` to convert the `lEvent` layout to `lTrack`
  */
 #ifndef SimpleTree_
 #define SimpleTree_
@@ -11,24 +29,63 @@
 #include <stdlib.h>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 // sidis-eic
 #include "Kinematics.h"
 
 // ROOT
 #include "TTree.h"
+#include "TFile.h"
+
+// a column of the tree: name, and address of its value (one of `d` or `i` is set)
+struct SimpleTreeColumn {
+  TString name;
+  Double_t *d;
+  Int_t *i;
+  Bool_t event; // true if the value is the same for all hadrons of an event
+  Int_t idx; // index in the row buffer of its type
+  Int_t evIdx; // `lEvent` layout: index in the event buffer, or in the hadron arrays, of its type
+};
+
+// RNTuple writer and fields, defined in SimpleTree.cxx (if built with `INCRNTUPLE=1`)
+struct SimpleTreeNTuple;
+// asynchronous writer thread and its blocks, defined in SimpleTree.cxx
+struct SimpleTreeAsync;
 
 class SimpleTree : public TObject
 {
   public:
-    SimpleTree(TString treeName_, Kinematics *K_, Kinematics *Ktrue_);
+    // output formats
+    enum format_enum { fTTree, fRNTuple };
+    // layouts
+    enum layout_enum { lTrack, lEvent };
+
+    // - `columns_` is a list of column names, separated by spaces or commas; if empty,
+    //   all columns are written; `Weight` is always written
+    // - the output is created in the current directory, or if `fileName_` is set, in a
+    //   new file of its own, which is closed by `WriteTree` (required by `StartAsync`)
+    SimpleTree(
+        TString treeName_, Kinematics *K_, Kinematics *Ktrue_,
+        TString columns_="", Int_t format_=fTTree, Int_t layout_=lTrack,
+        TString fileName_=""
+        );
     ~SimpleTree();
 
-    TTree *GetTree() { return T; };
+    TTree *GetTree() { return T; }; // nullptr, if the format is `fRNTuple`
     Kinematics *GetKinematics() { return K; };
     Kinematics *GetKinematicsTrue() { return Ktrue; };
-    void FillTree(Double_t w) { weight = w; T->Fill(); };
-    void WriteTree() { T->Write(); };
+    Int_t GetFormat() { return format; };
+    Int_t GetLayout() { return layout; };
+    // names of the columns written; generated-kinematics columns begin with `True`
+    std::vector<TString> GetColumnNames();
+    void FillTree(Double_t w);
+    void WriteTree(); // if asynchronous, this first waits for the writer thread
+
+    // start the asynchronous writer, with blocks of `blockRows` rows; call before the
+    // first `FillTree`; if the output is not in a file of its own, this prints an error
+    // and the output is written synchronously
+    void StartAsync(Long64_t blockRows=8192);
 
   private:
     Double_t weight;
@@ -36,6 +93,31 @@ class SimpleTree : public TObject
     Kinematics *K;
     Kinematics *Ktrue;
     TString treeName;
+    Int_t format;
+    Int_t layout;
+    std::vector<SimpleTreeColumn> columns; //! selected columns
+    std::vector<Double_t> rowD; //! row buffers, which the `lTrack` output reads from
+    std::vector<Int_t> rowI; //!
+    UInt_t rowFileID; // event key of the row (see `Kinematics::GetRandomKey`)
+    Long64_t rowEntry;
+    // `lEvent` layout: the event being collected, which the output reads from
+    std::vector<Double_t> evD; //! event-level columns
+    std::vector<Int_t> evI; //!
+    std::vector<std::vector<Double_t>> hadD; //! hadron columns
+    std::vector<std::vector<Int_t>> hadI; //!
+    Int_t nHad;
+    UInt_t evFileID;
+    Long64_t evEntry;
+    SimpleTreeNTuple *NT; //!
+    SimpleTreeAsync *AS; //!
+    TFile *ownFile; //! output file, if the constructor opened it
+
+    void BookTTree();
+    Bool_t BookRNTuple();
+    void WriteRow(); // fill the output from the row buffers (`lEvent`: add the row to the event)
+    void WriteEvent(); // `lEvent` layout: fill the output from the event buffers
+    void StopAsync();
+    void WriterLoop();
 
   ClassDef(SimpleTree,1);
 };
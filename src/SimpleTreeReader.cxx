@@ -0,0 +1,185 @@
+#include "SimpleTreeReader.h"
+
+#include "TClass.h"
+
+ClassImp(SimpleTreeReader)
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// constructor: open the file, and bind the branches
+SimpleTreeReader::SimpleTreeReader(TString fileName_, TString treeName_)
+  : file(nullptr)
+  , T(nullptr)
+  , layout(SimpleTree::lTrack)
+  , nHad(0)
+  , entry(-1)
+  , hadIdx(-1)
+  , numHadrons(-1)
+{
+  file = TFile::Open(fileName_);
+  if(file==nullptr || file->IsZombie()) {
+    cerr << "ERROR: SimpleTreeReader cannot open " << fileName_ << endl;
+    return;
+  };
+  TTree *tree = file->Get<TTree>(treeName_);
+  if(tree==nullptr) {
+    cerr << "ERROR: SimpleTreeReader cannot find TTree " << treeName_ << " in " << fileName_
+         << " (the RNTuple format is not supported)" << endl;
+    return;
+  };
+  if(tree->GetBranch("nHad")) layout = SimpleTree::lEvent;
+
+  // find the column types; `lEvent` hadron columns are `std::vector`s
+  for(TObject *obj : *tree->GetListOfBranches()) {
+    TBranch *branch = (TBranch*) obj;
+    SimpleTreeReaderColumn column;
+    column.name = branch->GetName();
+    if(column.name=="nHad") continue;
+    TClass *cls = nullptr;
+    EDataType type = kOther_t;
+    branch->GetExpectedType(cls,type);
+    if(cls) {
+      TString className = cls->GetName();
+      if(className=="vector<double>")   column.isInt = false;
+      else if(className=="vector<int>") column.isInt = true;
+      else {
+        cerr << "ERROR: SimpleTreeReader: unknown type " << className << " of column " << column.name << "; skipping" << endl;
+        continue;
+      };
+      column.arrIdx = column.isInt ? arrI.size() : arrD.size();
+      if(column.isInt) arrI.push_back(new std::vector<Int_t>());
+      else             arrD.push_back(new std::vector<Double_t>());
+    } else {
+      if(type==kDouble_t)   column.isInt = false;
+      else if(type==kInt_t) column.isInt = true;
+      else {
+        cerr << "ERROR: SimpleTreeReader: unknown type of column " << column.name << "; skipping" << endl;
+        continue;
+      };
+      column.arrIdx = -1;
+    };
+    column.idx = column.isInt ? valI.size() : valD.size();
+    if(column.isInt) valI.push_back(0); else valD.push_back(0);
+    columns.push_back(column);
+  };
+
+  // bind the branches (after all buffers are allocated, so their addresses are fixed)
+  if(layout==SimpleTree::lEvent) tree->SetBranchAddress("nHad",&nHad);
+  for(const SimpleTreeReaderColumn &column : columns) {
+    if(column.arrIdx>=0) {
+      if(column.isInt) tree->SetBranchAddress(column.name,&(arrI[column.arrIdx]));
+      else             tree->SetBranchAddress(column.name,&(arrD[column.arrIdx]));
+    } else {
+      if(column.isInt) tree->SetBranchAddress(column.name,&(valI[column.idx]));
+      else             tree->SetBranchAddress(column.name,&(valD[column.idx]));
+    };
+  };
+  T = tree;
+};
+
+
+// columns
+std::vector<TString> SimpleTreeReader::GetColumnNames() {
+  std::vector<TString> names;
+  for(const SimpleTreeReaderColumn &column : columns) names.push_back(column.name);
+  return names;
+};
+
+Double_t *SimpleTreeReader::GetAddressD(TString name) {
+  for(const SimpleTreeReaderColumn &column : columns) {
+    if(column.name==name && !column.isInt) return &(valD[column.idx]);
+  };
+  return nullptr;
+};
+
+Int_t *SimpleTreeReader::GetAddressI(TString name) {
+  for(const SimpleTreeReaderColumn &column : columns) {
+    if(column.name==name && column.isInt) return &(valI[column.idx]);
+  };
+  return nullptr;
+};
+
+
+// number of hadrons
+Long64_t SimpleTreeReader::GetEntries() {
+  if(T==nullptr) return 0;
+  if(layout==SimpleTree::lTrack) return T->GetEntries();
+  if(numHadrons<0) {
+    TBranch *branch = T->GetBranch("nHad");
+    Int_t nHadCurrent = nHad; // `nHad` is the branch address, so restore it after
+    numHadrons = 0;
+    for(Long64_t e=0; e<T->GetEntries(); e++) {
+      branch->GetEntry(e);
+      numHadrons += nHad;
+    };
+    nHad = nHadCurrent;
+  };
+  return numHadrons;
+};
+
+
+// load the next hadron: read the next tree entry if needed, then copy the hadron
+// values from the arrays
+Bool_t SimpleTreeReader::Next() {
+  if(T==nullptr) return false;
+  while(++hadIdx >= nHad) {
+    if(entry+1 >= T->GetEntries()) {
+      hadIdx = nHad;
+      return false;
+    };
+    T->GetEntry(++entry);
+    if(layout==SimpleTree::lTrack) nHad = 1;
+    hadIdx = -1;
+  };
+  if(layout==SimpleTree::lEvent) {
+    for(const SimpleTreeReaderColumn &column : columns) {
+      if(column.arrIdx<0) continue;
+      if(column.isInt) valI[column.idx] = arrI[column.arrIdx]->at(hadIdx);
+      else             valD[column.idx] = arrD[column.arrIdx]->at(hadIdx);
+    };
+  };
+  return true;
+};
+
+void SimpleTreeReader::Rewind() {
+  nHad = 0;
+  entry = -1;
+  hadIdx = -1;
+};
+
+
+// convert to the `lTrack` layout
+Bool_t SimpleTreeReader::Flatten(TString inFileName, TString outFileName, TString treeName) {
+  SimpleTreeReader reader(inFileName,treeName);
+  if(!reader.IsOpen()) return false;
+  TFile *outFile = new TFile(outFileName,"RECREATE");
+  if(outFile->IsZombie()) {
+    cerr << "ERROR: SimpleTreeReader cannot create " << outFileName << endl;
+    delete outFile;
+    return false;
+  };
+  TTree *tree = new TTree(treeName,treeName);
+  for(const SimpleTreeReaderColumn &column : reader.columns) {
+    if(column.isInt) tree->Branch(column.name, &(reader.valI[column.idx]), column.name+"/I");
+    else             tree->Branch(column.name, &(reader.valD[column.idx]), column.name+"/D");
+  };
+  while(reader.Next()) tree->Fill();
+  cout << "SimpleTreeReader: wrote " << tree->GetEntries() << " hadrons to " << outFileName << endl;
+  tree->Write();
+  outFile->Close();
+  delete outFile;
+  return true;
+};
+
+
+SimpleTreeReader::~SimpleTreeReader() {
+  if(T) T->ResetBranchAddresses();
+  if(file) {
+    file->Close();
+    delete file;
+  };
+  for(auto v : arrD) delete v;
+  for(auto v : arrI) delete v;
+};
@@ -0,0 +1,77 @@
+#ifndef SimpleTreeReader_
+#define SimpleTreeReader_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+
+// sidis-eic
+#include "SimpleTree.h"
+
+// ROOT
+#include "TObject.h"
+#include "TString.h"
+#include "TFile.h"
+#include "TTree.h"
+
+// a column of the per-hadron view
+struct SimpleTreeReaderColumn {
+  TString name;
+  Bool_t isInt; // true for `Int_t` columns, otherwise `Double_t`
+  Int_t idx; // index in the value buffer of its type
+  Int_t arrIdx; // `lEvent` layout: index in the hadron arrays of its type, or -1 for event-level columns
+};
+
+/* reads a `SimpleTree` `TTree` one hadron at a time, for either layout (see
+ * `SimpleTree::layout_enum`), so that the same code reads both
+ * - `GetAddressD` and `GetAddressI` return the address of a column value, which is
+ *   updated by each `Next`; event-level columns are repeated for each hadron, as in
+ *   the `lTrack` layout
+ * - `Flatten` converts a file to the `lTrack` layout, for code that reads the tree
+ *   directly (e.g., BruFit)
+ * - the `RNTuple` format is not supported; use `ROOT::RDataFrame` for it
+ */
+class SimpleTreeReader : public TObject
+{
+  public:
+    SimpleTreeReader(TString fileName_, TString treeName_="tree");
+    ~SimpleTreeReader();
+
+    Bool_t IsOpen() { return T!=nullptr; };
+    Int_t GetLayout() { return layout; };
+    std::vector<TString> GetColumnNames();
+    // address of the value of column `name`, or nullptr if there is no such column of this type
+    Double_t *GetAddressD(TString name);
+    Int_t *GetAddressI(TString name);
+
+    // number of hadrons (for `lEvent`, this reads the `nHad` column of all events)
+    Long64_t GetEntries();
+    // load the next hadron; returns false if there are no more
+    Bool_t Next();
+    // go back to before the first hadron
+    void Rewind();
+    Long64_t GetTreeEntry() { return entry; }; // tree entry of the current hadron
+    Int_t GetHadronIndex() { return hadIdx; }; // index of the current hadron in its event
+
+    // write the tree of `inFileName` to `outFileName`, in the `lTrack` layout
+    static Bool_t Flatten(TString inFileName, TString outFileName, TString treeName="tree");
+
+  private:
+    TFile *file;
+    TTree *T;
+    Int_t layout;
+    std::vector<SimpleTreeReaderColumn> columns; //!
+    std::vector<Double_t> valD; //! values of the current hadron
+    std::vector<Int_t> valI; //!
+    std::vector<std::vector<Double_t>*> arrD; //! `lEvent` layout: hadron arrays of the current event
+    std::vector<std::vector<Int_t>*> arrI; //!
+    Int_t nHad; // number of hadrons of the current tree entry
+    Long64_t entry;
+    Int_t hadIdx;
+    Long64_t numHadrons; // cached `GetEntries`, or -1
+
+  ClassDef(SimpleTreeReader,1);
+};
+
+#endif
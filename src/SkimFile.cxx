@@ -0,0 +1,387 @@
+#include "SkimFile.h"
+
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+ClassImp(SkimFile)
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace {
+  const char skimMagic[8] = {'S','I','D','I','S','K','I','M'};
+  const Int_t nEvInt = 4; // entry, fileID, q2Idx, numHadrons
+  const Int_t nHadInt = 3; // pid, pidTrue, index
+}
+
+// constructor
+SkimFile::SkimFile(TString fileName_)
+  : eleBeamEn(0)
+  , ionBeamEn(0)
+  , crossingAngle(0)
+  , numEvents(0)
+  , numHadrons(0)
+  , info("")
+  , inMemory(false)
+  , memPos(0)
+  , fout(nullptr)
+  , writing(false)
+  , blockEvents(4096)
+  , mapData(nullptr)
+  , mapSize(0)
+  , curBlock(-1)
+  , rHadOffset(0)
+{
+  this->SetName(fileName_);
+};
+
+
+// size of a block with `nEv` events and `nHad` hadrons; every column starts 8-byte aligned
+Long64_t SkimFile::BlockBytes(Long64_t nEv, Long64_t nHad) {
+  return (SkimEvent::nVec + nEvInt) * 8 * nEv
+    + SkimHadron::nVec * 8 * nHad
+    + nHadInt * Pad8(4 * nHad);
+};
+
+Bool_t SkimFile::LittleEndian() {
+  const uint16_t one = 1;
+  return *(reinterpret_cast<const uint8_t*>(&one)) == 1;
+};
+
+
+// write
+//-----------------------------------------------
+Bool_t SkimFile::OpenWrite(Double_t eleBeamEn_, Double_t ionBeamEn_, Double_t crossingAngle_, Long64_t blockEvents_, Bool_t inMemory_) {
+  if(!LittleEndian()) {
+    cerr << "ERROR: SkimFile requires a little-endian machine" << endl;
+    return false;
+  };
+  Close();
+  inMemory = inMemory_;
+  memBuf.clear();
+  memPos = 0;
+  if(!inMemory) {
+    fout = fopen(GetName(),"wb");
+    if(fout==nullptr) {
+      cerr << "ERROR: cannot open skim file " << GetName() << " for writing" << endl;
+      return false;
+    };
+  };
+  writing = true;
+  eleBeamEn = eleBeamEn_;
+  ionBeamEn = ionBeamEn_;
+  crossingAngle = crossingAngle_;
+  blockEvents = std::max(blockEvents_,(Long64_t)1);
+  numEvents = numHadrons = 0;
+  blocks.clear();
+  wEvVec.assign(SkimEvent::nVec, std::vector<Double_t>());
+  wEvInt.assign(nEvInt, std::vector<Long64_t>());
+  wHadVec.assign(SkimHadron::nVec, std::vector<Double_t>());
+  wHadInt.assign(nHadInt, std::vector<Int_t>());
+  // placeholder header, rewritten by `Close`
+  Header header;
+  memset(&header,0,sizeof(Header));
+  WriteBytes(&header,sizeof(Header));
+  return true;
+};
+
+void SkimFile::BeginEvent(const SkimEvent &ev) {
+  if(!writing) return;
+  if((Long64_t)wEvInt[0].size() >= blockEvents) FlushBlock();
+  for(Int_t k=0; k<SkimEvent::nVec; k++) wEvVec[k].push_back(ev.vec[k]);
+  wEvInt[0].push_back(ev.entry);
+  wEvInt[1].push_back(ev.fileID);
+  wEvInt[2].push_back(ev.q2Idx);
+  wEvInt[3].push_back(0);
+  numEvents++;
+};
+
+void SkimFile::AddHadron(const SkimHadron &had) {
+  if(!writing || wEvInt[3].empty()) return;
+  for(Int_t k=0; k<SkimHadron::nVec; k++) wHadVec[k].push_back(had.vec[k]);
+  wHadInt[0].push_back(had.pid);
+  wHadInt[1].push_back(had.pidTrue);
+  wHadInt[2].push_back(had.index);
+  wEvInt[3].back()++;
+  numHadrons++;
+};
+
+void SkimFile::SetQ2Table(std::vector<Double_t> Q2min_, std::vector<Double_t> xs_, std::vector<Long64_t> entries_) {
+  Q2min = Q2min_;
+  xs = xs_;
+  entries = entries_;
+};
+
+// write the buffered events as one block, one column after another
+void SkimFile::FlushBlock() {
+  Long64_t nEv = wEvInt[0].size();
+  if(nEv==0) return;
+  Long64_t nHad = wHadInt[0].size();
+  BlockInfo block;
+  block.offset = Tell();
+  block.firstEvent = numEvents - nEv;
+  block.numEvents = nEv;
+  block.numHadrons = nHad;
+  for(auto &col : wEvVec) WriteBytes(col.data(), 8*nEv);
+  for(auto &col : wEvInt) WriteBytes(col.data(), 8*nEv);
+  for(auto &col : wHadVec) WriteBytes(col.data(), 8*nHad);
+  for(auto &col : wHadInt) {
+    WriteBytes(col.data(), 4*nHad);
+    WritePadding(Pad8(4*nHad)-4*nHad);
+  };
+  blocks.push_back(block);
+  for(auto &col : wEvVec) col.clear();
+  for(auto &col : wEvInt) col.clear();
+  for(auto &col : wHadVec) col.clear();
+  for(auto &col : wHadInt) col.clear();
+};
+
+void SkimFile::WriteBytes(const void *buf, Long64_t n) {
+  if(inMemory) {
+    if(n<=0) return;
+    if(memPos+n > (Long64_t)memBuf.size()) memBuf.resize(memPos+n);
+    memcpy(memBuf.data()+memPos, buf, n);
+    memPos += n;
+    return;
+  };
+  if(n>0 && fwrite(buf,1,n,fout)!=(size_t)n)
+    cerr << "ERROR: failed to write skim file " << GetName() << endl;
+};
+
+void SkimFile::WritePadding(Long64_t n) {
+  const char zeros[8] = {0};
+  WriteBytes(zeros,n);
+};
+
+Long64_t SkimFile::Tell() {
+  return inMemory ? memPos : ftell(fout);
+};
+
+
+// read
+//-----------------------------------------------
+Bool_t SkimFile::OpenRead() {
+  if(!LittleEndian()) {
+    cerr << "ERROR: SkimFile requires a little-endian machine" << endl;
+    return false;
+  };
+  if(writing) Close();
+  if(inMemory) {
+    // in-memory skim: read the buffer
+    if(memBuf.size()<sizeof(Header)) {
+      cerr << "ERROR: skim " << GetName() << " is empty" << endl;
+      return false;
+    };
+    mapData = memBuf.data();
+    mapSize = memBuf.size();
+  }
+  else {
+    int fd = open(GetName(),O_RDONLY);
+    if(fd<0) {
+      cerr << "ERROR: cannot open skim file " << GetName() << endl;
+      return false;
+    };
+    struct stat st;
+    if(fstat(fd,&st)!=0 || st.st_size<(off_t)sizeof(Header)) {
+      cerr << "ERROR: skim file " << GetName() << " is too short" << endl;
+      close(fd);
+      return false;
+    };
+    mapSize = st.st_size;
+    void *ptr = mmap(nullptr,mapSize,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd); // the mapping stays valid
+    if(ptr==MAP_FAILED) {
+      cerr << "ERROR: cannot memory-map skim file " << GetName() << endl;
+      return false;
+    };
+    mapData = static_cast<char*>(ptr);
+    madvise(mapData,mapSize,MADV_SEQUENTIAL);
+  };
+
+  // header
+  Header header;
+  memcpy(&header,mapData,sizeof(Header));
+  if(memcmp(header.magic,skimMagic,8)!=0 || header.version!=formatVersion) {
+    cerr << "ERROR: " << GetName() << " is not a skim file of version " << formatVersion << endl;
+    Close();
+    return false;
+  };
+  if(header.indexOffset + header.numBlocks*sizeof(BlockInfo) > (uint64_t)mapSize
+      || header.q2Offset + 8 > (uint64_t)mapSize || header.infoOffset + 8 > (uint64_t)mapSize) {
+    cerr << "ERROR: skim file " << GetName() << " is truncated" << endl;
+    Close();
+    return false;
+  };
+  eleBeamEn = header.eleBeamEn;
+  ionBeamEn = header.ionBeamEn;
+  crossingAngle = header.crossingAngle;
+  numEvents = header.numEvents;
+  numHadrons = header.numHadrons;
+  blockEvents = header.blockEvents;
+
+  // block index
+  blocks.resize(header.numBlocks);
+  if(header.numBlocks>0)
+    memcpy(blocks.data(), mapData+header.indexOffset, header.numBlocks*sizeof(BlockInfo));
+  for(const BlockInfo &block : blocks) {
+    if(block.offset + BlockBytes(block.numEvents,block.numHadrons) > (uint64_t)mapSize) {
+      cerr << "ERROR: skim file " << GetName() << " is truncated" << endl;
+      Close();
+      return false;
+    };
+  };
+
+  // Q2 table
+  uint64_t nQ2;
+  memcpy(&nQ2, mapData+header.q2Offset, 8);
+  if(header.q2Offset + 8 + nQ2*24 > (uint64_t)mapSize) {
+    cerr << "ERROR: skim file " << GetName() << " is truncated" << endl;
+    Close();
+    return false;
+  };
+  Q2min.resize(nQ2);
+  xs.resize(nQ2);
+  entries.resize(nQ2);
+  const char *q2Ptr = mapData + header.q2Offset + 8;
+  for(uint64_t i=0; i<nQ2; i++) {
+    memcpy(&Q2min[i],  q2Ptr+24*i,    8);
+    memcpy(&xs[i],     q2Ptr+24*i+8,  8);
+    memcpy(&entries[i],q2Ptr+24*i+16, 8);
+  };
+
+  // info string
+  uint64_t infoLen;
+  memcpy(&infoLen, mapData+header.infoOffset, 8);
+  if(header.infoOffset + 8 + infoLen <= (uint64_t)mapSize)
+    info = TString(mapData+header.infoOffset+8, infoLen);
+
+  curBlock = -1;
+  cout << (inMemory ? "in-memory skim " : "skim file ") << GetName() << ": " << numEvents << " events, "
+       << numHadrons << " hadrons, in " << blocks.size() << " blocks" << endl;
+  return true;
+};
+
+// set the column pointers for block `b`
+Bool_t SkimFile::LoadBlock(Long64_t b) {
+  if(b<0 || b>=(Long64_t)blocks.size()) return false;
+  const BlockInfo &block = blocks[b];
+  const char *ptr = mapData + block.offset;
+  const Long64_t nEv = block.numEvents;
+  const Long64_t nHad = block.numHadrons;
+  for(Int_t k=0; k<SkimEvent::nVec; k++) { rEvVec[k] = reinterpret_cast<const Double_t*>(ptr); ptr += 8*nEv; };
+  for(Int_t k=0; k<nEvInt; k++) { rEvInt[k] = reinterpret_cast<const Long64_t*>(ptr); ptr += 8*nEv; };
+  for(Int_t k=0; k<SkimHadron::nVec; k++) { rHadVec[k] = reinterpret_cast<const Double_t*>(ptr); ptr += 8*nHad; };
+  for(Int_t k=0; k<nHadInt; k++) { rHadInt[k] = reinterpret_cast<const Int_t*>(ptr); ptr += Pad8(4*nHad); };
+  rHadStart.resize(nEv);
+  Long64_t start = 0;
+  for(Long64_t i=0; i<nEv; i++) {
+    rHadStart[i] = start;
+    start += rEvInt[3][i];
+  };
+  if(start!=nHad) {
+    cerr << "ERROR: skim file " << GetName() << " block " << b << " is inconsistent" << endl;
+    return false;
+  };
+  curBlock = b;
+  return true;
+};
+
+Bool_t SkimFile::ReadEvent(Long64_t i, SkimEvent &ev) {
+  if(mapData==nullptr || i<0 || i>=numEvents) return false;
+  // find the block, if not the loaded one
+  if(curBlock<0 || i<(Long64_t)blocks[curBlock].firstEvent
+      || i>=(Long64_t)(blocks[curBlock].firstEvent+blocks[curBlock].numEvents)) {
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), (uint64_t)i,
+        [](uint64_t e, const BlockInfo &block){ return e < block.firstEvent; });
+    if(!LoadBlock(std::distance(blocks.begin(),it)-1)) return false;
+  };
+  Long64_t k = i - blocks[curBlock].firstEvent;
+  for(Int_t c=0; c<SkimEvent::nVec; c++) ev.vec[c] = rEvVec[c][k];
+  ev.entry = rEvInt[0][k];
+  ev.fileID = rEvInt[1][k];
+  ev.q2Idx = rEvInt[2][k];
+  ev.numHadrons = rEvInt[3][k];
+  rHadOffset = rHadStart[k];
+  return true;
+};
+
+void SkimFile::ReadHadron(Long64_t j, SkimHadron &had) {
+  Long64_t k = rHadOffset + j;
+  for(Int_t c=0; c<SkimHadron::nVec; c++) had.vec[c] = rHadVec[c][k];
+  had.pid = rHadInt[0][k];
+  had.pidTrue = rHadInt[1][k];
+  had.index = rHadInt[2][k];
+};
+
+
+// close
+//-----------------------------------------------
+void SkimFile::Close() {
+  // write: last block, trailer, and header
+  if(writing) {
+    FlushBlock();
+    Header header;
+    memset(&header,0,sizeof(Header));
+    memcpy(header.magic,skimMagic,8);
+    header.version = formatVersion;
+    header.blockEvents = blockEvents;
+    header.eleBeamEn = eleBeamEn;
+    header.ionBeamEn = ionBeamEn;
+    header.crossingAngle = crossingAngle;
+    header.numEvents = numEvents;
+    header.numHadrons = numHadrons;
+    header.numBlocks = blocks.size();
+    // - Q2 table
+    header.q2Offset = Tell();
+    uint64_t nQ2 = Q2min.size();
+    WriteBytes(&nQ2,8);
+    for(uint64_t i=0; i<nQ2; i++) {
+      Double_t xs_ = i<xs.size() ? xs[i] : 0;
+      Long64_t entries_ = i<entries.size() ? entries[i] : 0;
+      WriteBytes(&Q2min[i],8);
+      WriteBytes(&xs_,8);
+      WriteBytes(&entries_,8);
+    };
+    // - info string
+    header.infoOffset = Tell();
+    uint64_t infoLen = info.Length();
+    WriteBytes(&infoLen,8);
+    WriteBytes(info.Data(),infoLen);
+    WritePadding(Pad8(infoLen)-infoLen);
+    // - block index
+    header.indexOffset = Tell();
+    if(!blocks.empty()) WriteBytes(blocks.data(),blocks.size()*sizeof(BlockInfo));
+    // - header
+    if(inMemory) {
+      memPos = 0;
+      WriteBytes(&header,sizeof(Header));
+      memBuf.shrink_to_fit();
+    }
+    else {
+      fseek(fout,0,SEEK_SET);
+      WriteBytes(&header,sizeof(Header));
+      fclose(fout);
+      fout = nullptr;
+    };
+    writing = false;
+    cout << (inMemory ? "in-memory skim " : "skim file ") << GetName() << " written: " << numEvents << " events, "
+         << numHadrons << " hadrons, in " << blocks.size() << " blocks" << endl;
+  };
+  // read: unmap (in-memory skims keep the buffer)
+  if(mapData!=nullptr) {
+    if(!inMemory) munmap(mapData,mapSize);
+    mapData = nullptr;
+    mapSize = 0;
+    curBlock = -1;
+  };
+};
+
+
+SkimFile::~SkimFile() {
+  Close();
+};
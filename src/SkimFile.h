@@ -0,0 +1,156 @@
+#ifndef SkimFile_
+#define SkimFile_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+#include <cstdint>
+
+// ROOT
+#include "TObject.h"
+#include "TNamed.h"
+#include "TString.h"
+
+// one event of a skim: everything the analysis needs before the hadron loop
+struct SkimEvent {
+  // 4-momenta (px,py,pz,E) and hadronic final state (HFS) sums, at offsets `k*` in `vec`
+  enum vec_enum {
+    kEle         = 0,  // reconstructed scattered electron
+    kEleTrue     = 4,  // generated scattered electron
+    kEleBeamTrue = 8,  // generated electron beam
+    kIonBeamTrue = 12, // generated ion beam
+    kHFS         = 16, // reconstructed HFS: sigmah, Pxh, Pyh, hadronSumVec (px,py,pz,E)
+    kHFSTrue     = 23, // generated HFS
+    nVec         = 30
+  };
+  Double_t vec[nVec];
+  Long64_t entry; // entry in the input file, and
+  Long64_t fileID; // input file ID, for the random draws (see `Kinematics::SetRandomKey`)
+  Long64_t q2Idx; // Q2 range of the input file (see `Analysis::GetEventQ2Weight`)
+  Long64_t numHadrons;
+};
+
+// one hadron of a skim
+struct SkimHadron {
+  enum vec_enum {
+    kP4     = 0, // reconstructed 4-momentum (px,py,pz,E)
+    kP4True = 4, // matching generated 4-momentum
+    nVec    = 8
+  };
+  Double_t vec[nVec];
+  Int_t pid; // PID used for the final state (e.g., smeared PID)
+  Int_t pidTrue; // PID of `Kinematics::hadPID` of the generated kinematics
+  Int_t index; // index of the track in the input event, for the random draws (see `Kinematics::SetRandomHadron`)
+};
+
+/* compact skim of the analysis input, so that changes of bins or histograms can be
+ * rerun without decoding Delphes or EDM4hep objects (see `AnalysisSkim`)
+ * - binary file, little-endian, in blocks of up to `blockEvents` events; each block
+ *   is columnar: one contiguous array per `SkimEvent` and `SkimHadron` member, so the
+ *   reader accesses it directly from a memory map
+ * - layout: header, blocks, Q2 table (Q2min, cross section, and number of entries of
+ *   each Q2 range), info string, and block index; the header holds their offsets
+ * - write: `OpenWrite`, then for each event `BeginEvent` and `AddHadron` for each of
+ *   its hadrons, then `Close`
+ * - read: `OpenRead`, then `ReadEvent` and `ReadHadron`
+ * - in-memory skims (`OpenWrite` with `inMemory_=true`) are written to a buffer instead
+ *   of the file, and `OpenRead` then reads the buffer, which is kept until deletion, so
+ *   it may be read again (see `Analysis::eventCacheMB`)
+ */
+class SkimFile : public TNamed
+{
+  public:
+    SkimFile(TString fileName_="skim.bin");
+    ~SkimFile();
+
+    // write
+    Bool_t OpenWrite(Double_t eleBeamEn_, Double_t ionBeamEn_, Double_t crossingAngle_, Long64_t blockEvents_=4096, Bool_t inMemory_=false);
+    void BeginEvent(const SkimEvent &ev); // `ev.numHadrons` is ignored, and counted by `AddHadron`
+    void AddHadron(const SkimHadron &had); // add a hadron to the last event
+    void SetQ2Table(std::vector<Double_t> Q2min_, std::vector<Double_t> xs_, std::vector<Long64_t> entries_);
+    void SetInfo(TString info_) { info = info_; }; // free text, e.g., recon methods and final states
+
+    // read
+    Bool_t OpenRead();
+    Bool_t ReadEvent(Long64_t i, SkimEvent &ev);
+    void ReadHadron(Long64_t j, SkimHadron &had); // hadron `j` of the last event read
+
+    // write the remaining block and the trailer (if writing), or unmap the file (if reading);
+    // called by the destructor
+    void Close();
+
+    // accessors
+    Long64_t GetNumEvents() { return numEvents; };
+    Long64_t GetNumHadrons() { return numHadrons; };
+    Double_t GetEleBeamEn() { return eleBeamEn; };
+    Double_t GetIonBeamEn() { return ionBeamEn; };
+    Double_t GetCrossingAngle() { return crossingAngle; };
+    const std::vector<Double_t> &GetQ2min() { return Q2min; };
+    const std::vector<Double_t> &GetXs() { return xs; };
+    const std::vector<Long64_t> &GetEntries() { return entries; };
+    TString GetInfo() { return info; };
+    Bool_t IsWriting() { return writing; };
+    Long64_t GetMemorySize() { return memBuf.capacity(); }; // in-memory skims: buffer size [bytes]
+
+    static const UInt_t formatVersion = 3;
+
+  private:
+    // header, at the start of the file
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t blockEvents;
+      double eleBeamEn, ionBeamEn, crossingAngle;
+      uint64_t numEvents, numHadrons, numBlocks;
+      uint64_t q2Offset, infoOffset, indexOffset;
+    };
+    // block index entry
+    struct BlockInfo {
+      uint64_t offset, firstEvent, numEvents, numHadrons;
+    };
+    static Long64_t BlockBytes(Long64_t nEv, Long64_t nHad);
+    static Long64_t Pad8(Long64_t n) { return (n+7) & ~((Long64_t)7); };
+    static Bool_t LittleEndian();
+
+    // common
+    Double_t eleBeamEn, ionBeamEn, crossingAngle;
+    Long64_t numEvents, numHadrons;
+    std::vector<Double_t> Q2min; //!
+    std::vector<Double_t> xs; //!
+    std::vector<Long64_t> entries; //!
+    TString info;
+    std::vector<BlockInfo> blocks; //!
+    Bool_t inMemory; //! if true, the skim is in `memBuf` instead of the file
+    std::vector<char> memBuf; //!
+    Long64_t memPos; //! write position in `memBuf`
+
+    // write
+    FILE *fout; //!
+    Bool_t writing; //!
+    Long64_t blockEvents;
+    std::vector<std::vector<Double_t>> wEvVec; //! event columns
+    std::vector<std::vector<Long64_t>> wEvInt; //! entry, fileID, q2Idx, numHadrons
+    std::vector<std::vector<Double_t>> wHadVec; //! hadron columns
+    std::vector<std::vector<Int_t>> wHadInt; //! pid, pidTrue, index
+    void FlushBlock();
+    void WriteBytes(const void *buf, Long64_t n);
+    void WritePadding(Long64_t n);
+    Long64_t Tell(); // write position
+
+    // read
+    char *mapData; //!
+    Long64_t mapSize;
+    Long64_t curBlock; // loaded block, or -1
+    const Double_t *rEvVec[SkimEvent::nVec]; //!
+    const Long64_t *rEvInt[4]; //!
+    const Double_t *rHadVec[SkimHadron::nVec]; //!
+    const Int_t *rHadInt[3]; //!
+    std::vector<Long64_t> rHadStart; //! first hadron of each event of the loaded block
+    Long64_t rHadOffset; // first hadron of the last event read, in the loaded block
+    Bool_t LoadBlock(Long64_t b);
+
+  ClassDefOverride(SkimFile,1);
+};
+
+#endif
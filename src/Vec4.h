@@ -0,0 +1,83 @@
+#ifndef Vec4_
+#define Vec4_
+
+#include <cmath>
+
+// ROOT
+#include "Rtypes.h"
+#include "TVector3.h"
+#include "TLorentzVector.h"
+#include "TLorentzRotation.h"
+
+/* lightweight value-type 3-vector and 4-vector, for the `Kinematics` hot path
+ * - plain structs (no TObject base, no virtual methods), so they can live on
+ *   the stack and in contiguous arrays without allocation
+ * - method names follow `TVector3` and `TLorentzVector`, and convert implicitly
+ *   to them at the public boundary (e.g., `kin->vecHadron = part.vecPart`)
+ */
+struct Vec3 {
+  Double_t x, y, z;
+
+  Vec3() : x(0), y(0), z(0) {};
+  Vec3(Double_t x_, Double_t y_, Double_t z_) : x(x_), y(y_), z(z_) {};
+  Vec3(const TVector3 &v) : x(v.X()), y(v.Y()), z(v.Z()) {};
+  operator TVector3() const { return TVector3(x,y,z); };
+
+  Double_t X() const { return x; };
+  Double_t Y() const { return y; };
+  Double_t Z() const { return z; };
+  Double_t Dot(const Vec3 &v) const { return x*v.x + y*v.y + z*v.z; };
+  Vec3 Cross(const Vec3 &v) const { return Vec3( y*v.z - z*v.y, z*v.x - x*v.z, x*v.y - y*v.x ); };
+  Double_t Mag2() const { return Dot(*this); };
+  Double_t Mag() const { return std::sqrt(Mag2()); };
+  Double_t Perp() const { return std::sqrt(x*x + y*y); };
+
+  Vec3 operator+(const Vec3 &v) const { return Vec3(x+v.x, y+v.y, z+v.z); };
+  Vec3 operator-(const Vec3 &v) const { return Vec3(x-v.x, y-v.y, z-v.z); };
+  Vec3 operator*(Double_t a) const { return Vec3(a*x, a*y, a*z); };
+};
+
+struct Vec4 {
+  Double_t px, py, pz, e;
+
+  Vec4() : px(0), py(0), pz(0), e(0) {};
+  Vec4(Double_t px_, Double_t py_, Double_t pz_, Double_t e_) : px(px_), py(py_), pz(pz_), e(e_) {};
+  Vec4(const TLorentzVector &v) : px(v.Px()), py(v.Py()), pz(v.Pz()), e(v.E()) {};
+  operator TLorentzVector() const { return TLorentzVector(px,py,pz,e); };
+
+  void SetPxPyPzE(Double_t px_, Double_t py_, Double_t pz_, Double_t e_) { px=px_; py=py_; pz=pz_; e=e_; };
+  Double_t Px() const { return px; };
+  Double_t Py() const { return py; };
+  Double_t Pz() const { return pz; };
+  Double_t E() const { return e; };
+  Vec3 Vect() const { return Vec3(px,py,pz); };
+  Double_t Dot(const Vec4 &v) const { return e*v.e - px*v.px - py*v.py - pz*v.pz; };
+  Double_t M2() const { return Dot(*this); };
+  Double_t M() const { Double_t mm = M2(); return mm<0 ? -std::sqrt(-mm) : std::sqrt(mm); };
+  Double_t P() const { return Vect().Mag(); };
+  Double_t Pt() const { return std::sqrt(px*px + py*py); };
+  Double_t Phi() const { return (px==0 && py==0) ? 0. : std::atan2(py,px); };
+  // pseudorapidity, with the same conventions as `TVector3::PseudoRapidity`
+  Double_t Eta() const {
+    Double_t p = P();
+    Double_t cosTheta = p==0 ? 1. : pz/p;
+    if(cosTheta*cosTheta < 1) return -0.5 * std::log( (1.0-cosTheta)/(1.0+cosTheta) );
+    if(pz==0) return 0;
+    return pz>0 ? 10e10 : -10e10;
+  };
+
+  Vec4 operator+(const Vec4 &v) const { return Vec4(px+v.px, py+v.py, pz+v.pz, e+v.e); };
+  Vec4 operator-(const Vec4 &v) const { return Vec4(px-v.px, py-v.py, pz-v.pz, e-v.e); };
+
+  // apply a Lorentz transformation
+  Vec4 Transformed(const TLorentzRotation &L) const {
+    return Vec4(
+        L.XX()*px + L.XY()*py + L.XZ()*pz + L.XT()*e,
+        L.YX()*px + L.YY()*py + L.YZ()*pz + L.YT()*e,
+        L.ZX()*px + L.ZY()*py + L.ZZ()*pz + L.ZT()*e,
+        L.TX()*px + L.TY()*py + L.TZ()*pz + L.TT()*e
+        );
+  };
+};
+
+#endif
@@ -15,12 +15,22 @@ Double_t WeightsSivers::GetWeight(const Kinematics& kin) const {
         * TMath::Sin(kin.phiH - kin.phiS);
 }
 
+UInt_t WeightsSivers::GetDeps() const {
+    return Kinematics::oSpin | Kinematics::oZ | Kinematics::oPT
+        | Kinematics::oPhiH | Kinematics::oPhiS;
+}
+
 Double_t WeightsCollins::GetWeight(const Kinematics& kin) const {
     return kin.polT * kin.tSpin * kin.depolP1
         * this->Asymmetry(kin.x, kin.z, kin.Q2, kin.pT)
         * TMath::Sin(kin.phiH + kin.phiS);
 }
 
+UInt_t WeightsCollins::GetDeps() const {
+    return Kinematics::oSpin | Kinematics::oDepol | Kinematics::oZ | Kinematics::oPT
+        | Kinematics::oPhiH | Kinematics::oPhiS;
+}
+
 WeightsProduct::WeightsProduct(std::initializer_list<Weights const*> init) {
     for (Weights const* weight : init) {
         weights.push_back(weight);
@@ -35,6 +45,14 @@ Double_t WeightsProduct::GetWeight(const Kinematics& kin) const {
     return product;
 }
 
+UInt_t WeightsProduct::GetDeps() const {
+    UInt_t deps = Kinematics::oDIS;
+    for (auto weight_ptr : weights) {
+        deps |= weight_ptr->GetDeps();
+    }
+    return deps;
+}
+
 WeightsProduct& WeightsProduct::Multiply(Weights const* rhs) {
     WeightsProduct const* rhs_product = dynamic_cast<WeightsProduct const*>(rhs);
     if (rhs_product != nullptr) {
@@ -62,6 +80,14 @@ Double_t WeightsSum::GetWeight(const Kinematics& kin) const {
     return sum;
 }
 
+UInt_t WeightsSum::GetDeps() const {
+    UInt_t deps = Kinematics::oDIS;
+    for (auto weight_ptr : weights) {
+        deps |= weight_ptr->GetDeps();
+    }
+    return deps;
+}
+
 WeightsSum& WeightsSum::Add(Weights const* rhs) {
     WeightsSum const* rhs_sum = dynamic_cast<WeightsSum const*>(rhs);
     if (rhs_sum != nullptr) {
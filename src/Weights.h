@@ -14,6 +14,9 @@ class Weights : public TNamed
     Weights() { }
     // Return how an event should be weighted based on its kinematics.
     virtual Double_t GetWeight(const Kinematics&) const = 0;
+    // Return the observable groups read by `GetWeight` (see `Kinematics::obsGroup_enum`);
+    // the default assumes all of them.
+    virtual UInt_t GetDeps() const { return Kinematics::oAll; }
   private:
   ClassDef(Weights,1);
 };
@@ -26,6 +29,7 @@ class WeightsUniform : public Weights
     Double_t GetWeight(const Kinematics&) const override {
         return weight;
     }
+    UInt_t GetDeps() const override { return Kinematics::oDIS; }
   private:
     Double_t weight;
   ClassDefOverride(WeightsUniform,1);
@@ -36,6 +40,7 @@ class WeightsSivers : public Weights
 {
   public:
     Double_t GetWeight(const Kinematics& kin) const override;
+    UInt_t GetDeps() const override;
     virtual Double_t Asymmetry(Double_t x, Double_t z, Double_t Q2, Double_t pt) const = 0;
   private:
   ClassDefOverride(WeightsSivers,1);
@@ -46,6 +51,7 @@ class WeightsCollins : public Weights
 {
   public:
     Double_t GetWeight(const Kinematics& kin) const override;
+    UInt_t GetDeps() const override;
     virtual Double_t Asymmetry(Double_t x, Double_t z, Double_t Q2, Double_t pt) const = 0;
 
   private:
@@ -59,6 +65,7 @@ class WeightsProduct : public Weights
     WeightsProduct(std::initializer_list<Weights const*> weights);
 
     Double_t GetWeight(const Kinematics& kin) const override;
+    UInt_t GetDeps() const override;
     WeightsProduct& Multiply(Weights const* rhs);
 
   private:
@@ -73,6 +80,7 @@ class WeightsSum : public Weights
     WeightsSum(std::initializer_list<Weights const*> weights);
 
     Double_t GetWeight(const Kinematics& kin) const override;
+    UInt_t GetDeps() const override;
     WeightsSum& Add(Weights const* rhs);
 
   private:
@@ -0,0 +1,198 @@
+#include "ZoneMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include "TMath.h"
+
+ClassImp(ZoneMap)
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+// constructor
+ZoneMap::ZoneMap(TString fileName_)
+  : id("")
+  , numWeightBins(0)
+  , curCluster(-1)
+{
+  this->SetName(fileName_);
+};
+
+
+// start a new zone map
+void ZoneMap::Init(TString id_, TTree *tree, std::vector<TString> quantities_, Int_t numWeightBins_) {
+  id = id_;
+  clusters.clear();
+  const Long64_t entries = tree->GetEntries();
+  auto clusterIt = tree->GetClusterIterator(0);
+  Long64_t start;
+  while( (start=clusterIt()) < entries ) clusters.push_back(start);
+  clusters.push_back(entries);
+  counts.assign(clusters.size()-1, 0);
+  quantities = quantities_;
+  quantityIdx.clear();
+  for(std::size_t q=0; q<quantities.size(); q++) quantityIdx[quantities[q]] = q;
+  // empty ranges, so that clusters where no event has a quantity can be skipped
+  mins.assign(quantities.size(), std::vector<Double_t>(counts.size(), DBL_MAX));
+  maxs.assign(quantities.size(), std::vector<Double_t>(counts.size(), -DBL_MAX));
+  numWeightBins = TMath::Max(numWeightBins_,0);
+  for(auto &w : weights) w.assign(counts.size()*numWeightBins, 0.);
+  curCluster = -1;
+};
+
+void ZoneMap::Count(Long64_t entry) {
+  if(curCluster<0 || entry<clusters[curCluster] || entry>=clusters[curCluster+1])
+    curCluster = FindCluster(entry);
+  if(curCluster>=0) counts[curCluster]++;
+};
+
+// - NaN fails every cut, so it is not filled; infinities are filled as +/-`DBL_MAX`,
+//   the bounds of open-ended cuts
+void ZoneMap::Fill(Int_t q, Double_t value) {
+  if(curCluster<0 || std::isnan(value)) return;
+  value = TMath::Max(TMath::Min(value,DBL_MAX),-DBL_MAX);
+  mins[q][curCluster] = TMath::Min(mins[q][curCluster],value);
+  maxs[q][curCluster] = TMath::Max(maxs[q][curCluster],value);
+};
+
+void ZoneMap::FillWeight(Bool_t jet, Int_t bin, Double_t w) {
+  if(curCluster<0 || bin<0 || bin>=numWeightBins) return;
+  weights[jet?1:0][curCluster*numWeightBins+bin] += w;
+};
+
+
+// accessors
+Int_t ZoneMap::FindCluster(Long64_t entry) {
+  if(clusters.size()<2 || entry<0 || entry>=clusters.back()) return -1;
+  return (Int_t)( std::upper_bound(clusters.begin(), clusters.end(), entry) - clusters.begin() ) - 1;
+};
+
+Bool_t ZoneMap::IsComplete(Long64_t numEntries) {
+  for(Int_t c=0; c<GetNumClusters() && clusters[c]<numEntries; c++) {
+    if(!IsComplete(c)) return false;
+  };
+  return true;
+};
+
+Bool_t ZoneMap::GetRange(Int_t c, TString name, Double_t &min, Double_t &max) {
+  auto it = quantityIdx.find(name);
+  if(it==quantityIdx.end()) return false;
+  min = mins[it->second][c];
+  max = maxs[it->second][c];
+  return true;
+};
+
+
+// sidecar file
+// - format:
+//   id <ID>
+//   clusters <numClusters> <start0> <start1> ... <numEntries>
+//   counts <count0> <count1> ...
+//   weights <numWeightBins>
+//   wTrack <cluster0 bin0> <cluster0 bin1> ... <cluster1 bin0> ...
+//   wJet <cluster0 bin0> ...
+//   <quantity> <min0> <max0> <min1> <max1> ...
+Bool_t ZoneMap::Load() {
+  std::ifstream fin(GetName());
+  if(!fin.is_open()) return false;
+  std::string line, key;
+  Long64_t nClusters = -1;
+  id = "";
+  clusters.clear();
+  counts.clear();
+  quantities.clear();
+  quantityIdx.clear();
+  mins.clear();
+  maxs.clear();
+  numWeightBins = 0;
+  for(auto &w : weights) w.clear();
+  curCluster = -1;
+  Bool_t ok = true;
+  while(ok && std::getline(fin,line)) {
+    if(line.empty() || line[0]=='#') continue;
+    std::stringstream ss(line);
+    ss >> key;
+    if(key=="id") {
+      std::getline(ss >> std::ws, line);
+      id = line;
+      continue;
+    };
+    if(key=="clusters") {
+      ss >> nClusters;
+      if(ss && nClusters>=0) {
+        clusters.resize(nClusters+1);
+        for(Long64_t &v : clusters) ss >> v;
+      };
+    }
+    else if(nClusters<0) ok = false; // the clusters line must come first
+    else if(key=="counts") {
+      counts.resize(nClusters);
+      for(Long64_t &v : counts) ss >> v;
+    }
+    else if(key=="weights") {
+      ss >> numWeightBins;
+      ok = numWeightBins>=0;
+    }
+    else if(key=="wTrack" || key=="wJet") {
+      std::vector<Double_t> &w = weights[key=="wJet"?1:0];
+      w.resize(nClusters*numWeightBins);
+      for(Double_t &v : w) ss >> v;
+    }
+    else {
+      std::vector<Double_t> qMin(nClusters), qMax(nClusters);
+      for(Long64_t c=0; c<nClusters; c++) ss >> qMin[c] >> qMax[c];
+      quantityIdx[key] = quantities.size();
+      quantities.push_back(key);
+      mins.push_back(qMin);
+      maxs.push_back(qMax);
+    };
+    ok = ok && !ss.fail();
+  };
+  if(!ok || id=="" || nClusters<0 || (Long64_t)counts.size()!=nClusters ||
+      (Long64_t)weights[0].size()!=nClusters*numWeightBins || (Long64_t)weights[1].size()!=nClusters*numWeightBins) {
+    cerr << "WARNING: malformed zone map " << GetName() << "; ignoring it" << endl;
+    id = "";
+    return false;
+  };
+  return true;
+};
+
+Bool_t ZoneMap::Save() {
+  gSystem->mkdir(gSystem->DirName(GetName()),true);
+  // write to a temporary file, then rename, so that concurrent runs never read a partial zone map
+  TString tmpName = TString::Format("%s.%d.tmp",GetName(),gSystem->GetPid());
+  std::ofstream fout(tmpName.Data());
+  if(!fout.is_open()) {
+    cerr << "WARNING: cannot write zone map " << GetName() << endl;
+    return false;
+  };
+  fout.precision(17); // exact round trip of the ranges
+  fout << "# sidis-eic zone map: per-cluster ranges of event-level quantities" << endl;
+  fout << "id " << id << endl;
+  fout << "clusters " << counts.size();
+  for(Long64_t v : clusters) fout << " " << v;
+  fout << endl << "counts";
+  for(Long64_t v : counts) fout << " " << v;
+  fout << endl << "weights " << numWeightBins << endl << "wTrack";
+  for(Double_t v : weights[0]) fout << " " << v;
+  fout << endl << "wJet";
+  for(Double_t v : weights[1]) fout << " " << v;
+  fout << endl;
+  for(std::size_t q=0; q<quantities.size(); q++) {
+    fout << quantities[q];
+    for(std::size_t c=0; c<counts.size(); c++) fout << " " << mins[q][c] << " " << maxs[q][c];
+    fout << endl;
+  };
+  fout.close();
+  if(gSystem->Rename(tmpName,GetName())!=0) {
+    cerr << "WARNING: cannot write zone map " << GetName() << endl;
+    gSystem->Unlink(tmpName);
+    return false;
+  };
+  return true;
+};
+
+
+ZoneMap::~ZoneMap() {
+};
@@ -0,0 +1,83 @@
+#ifndef ZoneMap_
+#define ZoneMap_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <vector>
+#include <cfloat>
+
+// ROOT
+#include "TObject.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+/* zone map of one input file: the minimum and maximum of event-level quantities
+ * (e.g., Q2 and x of each recon method) in each cluster of its tree, so that clusters
+ * where no event can be in the bins are skipped without reading them (see
+ * `Analysis::useZoneMap`)
+ * - stored in a sidecar text file; it is only used if its ID (input file UUID and
+ *   size, and the settings which change the quantities) matches
+ * - built while analyzing the file: `Count` each entry read, then `Fill` the
+ *   quantities of its event; a cluster is complete if all of its entries were
+ *   counted, and only complete clusters may be skipped
+ * - also stores the sums of the track and jet weights of each cluster, in bins
+ *   (the recon methods and Q2 ranges, see `Analysis::ZoneMapWeightBin`), so that the total weights
+ *   include the skipped clusters
+ */
+class ZoneMap : public TNamed
+{
+  public:
+    ZoneMap(TString fileName_="zonemap.txt"); // sidecar file name
+    ~ZoneMap();
+
+    // build: start a new zone map, with the clusters of `tree`, and the quantities
+    // `quantities_`, which are then filled by index, and `numWeightBins_` bins of weights
+    void Init(TString id_, TTree *tree, std::vector<TString> quantities_, Int_t numWeightBins_=0);
+    void Count(Long64_t entry); // count an entry of the tree, before filling its quantities
+    void Fill(Int_t q, Double_t value); // fill quantity `q` of the last entry counted
+    // add weight `w` to bin `bin` of the last entry counted, for tracks (`jet==false`) or jets
+    void FillWeight(Bool_t jet, Int_t bin, Double_t w);
+
+    // read and write the sidecar file
+    Bool_t Load();
+    Bool_t Save();
+
+    // accessors
+    TString GetID() { return id; };
+    Int_t GetNumClusters() { return (Int_t) counts.size(); };
+    Int_t FindCluster(Long64_t entry); // -1 if out of range
+    Long64_t GetClusterStart(Int_t c) { return clusters[c]; }; // first entry of cluster `c`
+    Long64_t GetClusterEnd(Int_t c) { return clusters[c+1]; }; // first entry after cluster `c`
+    Bool_t IsComplete(Int_t c) { return counts[c]==clusters[c+1]-clusters[c]; };
+    // true if all clusters with entries before `numEntries` are complete
+    Bool_t IsComplete(Long64_t numEntries);
+    Bool_t HasQuantity(TString name) { return quantityIdx.find(name)!=quantityIdx.end(); };
+    // range of quantity `name` in cluster `c`; if no event of the cluster has it,
+    // `min`>`max`; returns false if there is no such quantity
+    Bool_t GetRange(Int_t c, TString name, Double_t &min, Double_t &max);
+    // sum of the track (`jet==false`) or jet weights in bin `bin` of cluster `c`
+    Int_t GetNumWeightBins() { return numWeightBins; };
+    Double_t GetWeight(Int_t c, Bool_t jet, Int_t bin) { return weights[jet?1:0][c*numWeightBins+bin]; };
+
+  private:
+    TString id;
+    std::vector<Long64_t> clusters; //! first entry of each cluster, then the number of entries
+    std::vector<Long64_t> counts; //! entries counted in each cluster
+    std::vector<TString> quantities; //!
+    std::map<TString,Int_t> quantityIdx; //!
+    std::vector<std::vector<Double_t>> mins; //! [quantity][cluster]
+    std::vector<std::vector<Double_t>> maxs; //!
+    Int_t numWeightBins; //!
+    std::vector<Double_t> weights[2]; //! [track or jet][cluster*numWeightBins+bin]
+    Int_t curCluster; // cluster of the last entry counted
+
+  ClassDefOverride(ZoneMap,1);
+};
+
+#endif